@@ -0,0 +1,27 @@
+#include "AnalysisFifo.h"
+#include <algorithm>
+
+bool AnalysisFifo::push (const Frame& frame) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+        return false;
+
+    frames[static_cast<size_t> (size1 > 0 ? start1 : start2)] = frame;
+    fifo.finishedWrite (1);
+    return true;
+}
+
+int AnalysisFifo::pop (Frame* destination, int maxFrames) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (maxFrames, start1, size1, start2, size2);
+
+    std::copy_n (frames.begin() + start1, size1, destination);
+    std::copy_n (frames.begin() + start2, size2, destination + size1);
+
+    fifo.finishedRead (size1 + size2);
+    return size1 + size2;
+}
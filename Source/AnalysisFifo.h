@@ -0,0 +1,48 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstdint>
+
+/**
+ * Analysis Frame FIFO
+ *
+ * Wait-free single-producer, single-consumer ring of the engine's per-hop
+ * analysis results, so the editor sees every frame (not just whatever was
+ * current when its timer fired) without sharing plain floats across threads.
+ *
+ * The audio thread pushes one frame per analysis hop: a handful of stores,
+ * no locks and no allocation. When the reader falls behind (or no editor is
+ * open) new frames are dropped until it catches up.
+ */
+class AnalysisFifo
+{
+public:
+    struct Frame
+    {
+        float detectedFrequency = 0.0f;     // Hz, 0 when unvoiced
+        float targetFrequency = 0.0f;       // Hz, 0 when not corrected
+        float confidence = 0.0f;            // 0-1
+        float pitchRatio = 1.0f;            // Output / input frequency
+        std::int64_t samplePosition = 0;    // End of the hop, in samples since prepare()
+    };
+
+    // About three seconds of 128-sample hops at 44.1 kHz
+    static constexpr int capacity = 1024;
+
+    AnalysisFifo() = default;
+
+    /** Audio thread. Returns false, dropping the frame, if the ring is full. */
+    bool push (const Frame& frame) noexcept;
+
+    /** Reader thread. Moves up to maxFrames of the oldest frames into destination. */
+    int pop (Frame* destination, int maxFrames) noexcept;
+
+    int getNumReady() const noexcept { return fifo.getNumReady(); }
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<Frame, capacity> frames {};
+
+    JUCE_DECLARE_NON_COPYABLE (AnalysisFifo)
+};
@@ -0,0 +1,214 @@
+#include "CycleResampler.h"
+#include <cmath>
+#include <algorithm>
+
+CycleResampler::CycleResampler()
+{
+}
+
+void CycleResampler::prepare (double sampleRate, int maxBlockSize, int channels)
+{
+    currentSampleRate = sampleRate;
+    preparedBlockSize = juce::jmax (1, maxBlockSize);
+    numChannels = juce::jmax (1, channels);
+
+    // Sized for the lowest frequency any range can select, so
+    // setFrequencyRange() never allocates
+    allocatedMaxPeriod = static_cast<int> (sampleRate / lowestFrequencyHz);
+    updatePeriodRange();
+
+    // The read pointer can trail by the whole window plus a crossfade, and a
+    // chunk is written before it is read
+    int longestDelay = interpolationGuard + maxCrossfadeSamples * 2 + allocatedMaxPeriod;
+    ringSize = juce::nextPowerOfTwo (longestDelay + preparedBlockSize + interpolationGuard);
+    ringMask = ringSize - 1;
+    rings.assign (static_cast<size_t> (getRingStride() * numChannels), 0.0f);
+
+    // Per-sample read positions, shared by every channel
+    readIndices.assign (static_cast<size_t> (preparedBlockSize), 0);
+    readFractions.assign (static_cast<size_t> (preparedBlockSize), 0.0f);
+    fadeIndices.assign (static_cast<size_t> (preparedBlockSize), 0);
+    fadeFractions.assign (static_cast<size_t> (preparedBlockSize), 0.0f);
+    fadeGains.assign (static_cast<size_t> (preparedBlockSize), 0.0f);
+
+    reset();
+}
+
+void CycleResampler::reset()
+{
+    std::fill (rings.begin(), rings.end(), 0.0f);
+    totalSamplesWritten = 0;
+    readPosition = -toFixed (latencySamples);
+    fadePosition = 0;
+    fadeRemaining = 0;
+    fadeLength = 0;
+}
+
+void CycleResampler::setFrequencyRange (float minHz, float maxHz)
+{
+    minFrequencyHz = juce::jmax (lowestFrequencyHz, juce::jmin (minHz, maxHz));
+    maxFrequencyHz = juce::jmax (minFrequencyHz, juce::jmax (minHz, maxHz));
+    updatePeriodRange();
+}
+
+void CycleResampler::updatePeriodRange() noexcept
+{
+    maxPeriodSamples = static_cast<int> (currentSampleRate / minFrequencyHz);
+    if (allocatedMaxPeriod > 0)
+        maxPeriodSamples = juce::jmin (maxPeriodSamples, allocatedMaxPeriod);
+
+    minPeriodSamples = juce::jlimit (1, maxPeriodSamples, static_cast<int> (currentSampleRate / maxFrequencyHz));
+
+    // The old pointer keeps moving toward the write pointer (at most one
+    // sample per sample) while it fades, so the window starts a crossfade
+    // beyond the interpolation guard
+    lowerDelay = interpolationGuard + maxCrossfadeSamples;
+    latencySamples = lowerDelay + maxPeriodSamples / 2;
+}
+
+void CycleResampler::process (const float* const* inputs, float* const* outputs, int channels, int numSamples,
+                              const float* pitchRatios, float detectedPeriod, float confidence,
+                              [[maybe_unused]] const float* analysisInput)
+{
+    if (numSamples <= 0 || inputs == nullptr || outputs == nullptr)
+        return;
+
+    jassert (channels <= numChannels);
+    channels = juce::jmin (channels, numChannels);
+
+    float unity = 1.0f;
+    const float* ratios = pitchRatios != nullptr ? pitchRatios : &unity;
+    int ratioStride = pitchRatios != nullptr ? 1 : 0;
+
+    // The rings are sized for the prepared block; longer calls are split,
+    // which gives the same result since nothing depends on call size
+    for (int offset = 0; offset < numSamples; offset += preparedBlockSize)
+    {
+        int chunk = juce::jmin (preparedBlockSize, numSamples - offset);
+        processChunk (inputs, outputs, channels, offset, chunk,
+                      ratios + offset * ratioStride, ratioStride, detectedPeriod, confidence);
+    }
+}
+
+void CycleResampler::processChunk (const float* const* inputs, float* const* outputs, int channels,
+                                   int offset, int numSamples, const float* pitchRatios, int ratioStride,
+                                   float detectedPeriod, float confidence)
+{
+    // Write the chunk first (at most two runs); reads stay at least
+    // interpolationGuard behind the sample being produced, so this is causal
+    int writePos = static_cast<int> (totalSamplesWritten & ringMask);
+    int firstRun = juce::jmin (numSamples, ringSize - writePos);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        const float* in = inputs[ch] + offset;
+        float* ring = getRing (ch);
+        std::copy_n (in, firstRun, ring + writePos);
+        std::copy_n (in + firstRun, numSamples - firstRun, ring);
+
+        // Mirror the start past the end so every 4-point read is contiguous
+        std::copy_n (ring, interpolationGuard, ring + ringSize);
+    }
+
+    std::int64_t chunkStart = totalSamplesWritten;
+    totalSamplesWritten += numSamples;
+
+    // Unvoiced: hold the current delay (ratio 1), no jumps without a period
+    bool voiced = detectedPeriod > 0.0f && confidence >= 0.2f;
+    int period = juce::jlimit (minPeriodSamples, maxPeriodSamples, juce::roundToInt (detectedPeriod));
+    std::int64_t periodStep = toFixed (period);
+    std::int64_t lowerLimit = toFixed (lowerDelay);
+    std::int64_t upperLimit = toFixed (lowerDelay + maxPeriodSamples);
+
+    // Decision pass, once for all channels: where each output sample is read
+    // from, and how much of the faded-out pointer is mixed in. Positions are
+    // 32.32 fixed point in input samples.
+    int fadeStart = numSamples;
+    int fadeEnd = 0;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (voiced)
+        {
+            // Keep the read pointer inside its window by repeating or
+            // dropping exactly one period, crossfading from the old pointer
+            std::int64_t delay = toFixed (chunkStart + i + 1) - readPosition;
+            bool repeatCycle = delay < lowerLimit;
+            bool dropCycle = delay > upperLimit;
+
+            if (repeatCycle || dropCycle)
+            {
+                fadePosition = readPosition;
+                fadeLength = juce::jlimit (8, maxCrossfadeSamples, period / 4);
+                fadeRemaining = fadeLength;
+                readPosition += repeatCycle ? -periodStep : periodStep;
+            }
+        }
+
+        auto index = static_cast<size_t> (i);
+        readIndices[index] = static_cast<int> ((readPosition >> fractionBits) & ringMask);
+        readFractions[index] = getFraction (readPosition);
+
+        if (fadeRemaining > 0)
+        {
+            fadeIndices[index] = static_cast<int> ((fadePosition >> fractionBits) & ringMask);
+            fadeFractions[index] = getFraction (fadePosition);
+            fadeGains[index] = static_cast<float> (fadeRemaining) / static_cast<float> (fadeLength);
+            fadeStart = juce::jmin (fadeStart, i);
+            fadeEnd = i + 1;
+        }
+        else
+        {
+            fadeGains[index] = 0.0f;
+        }
+
+        // Reading advances by the ratio, writing by one sample
+        std::int64_t step = voiced
+            ? static_cast<std::int64_t> (static_cast<double> (juce::jlimit (0.5f, 2.0f, pitchRatios[i * ratioStride])) * fixedOne)
+            : toFixed (1);
+        readPosition += step;
+
+        if (fadeRemaining > 0)
+        {
+            fadePosition += step;
+            --fadeRemaining;
+        }
+    }
+
+    // Interpolation pass per channel; the crossfade only touches the samples
+    // around a jump (any gap inside the span has a gain of zero)
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        const float* ring = getRing (ch);
+        float* out = outputs[ch] + offset;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto index = static_cast<size_t> (i);
+            out[i] = readInterpolated (ring, readIndices[index], readFractions[index]);
+        }
+
+        for (int i = fadeStart; i < fadeEnd; ++i)
+        {
+            auto index = static_cast<size_t> (i);
+            out[i] += (readInterpolated (ring, fadeIndices[index], fadeFractions[index]) - out[i]) * fadeGains[index];
+        }
+    }
+}
+
+float CycleResampler::readInterpolated (const float* ring, int index, float t) const noexcept
+{
+    // The mirrored tail makes index..index + 2 contiguous; only index - 1 wraps
+    float xm1 = ring[(index - 1) & ringMask];
+    const float* x = ring + index;
+    float x0 = x[0];
+    float x1 = x[1];
+    float x2 = x[2];
+
+    // Catmull-Rom (4-point, 3rd-order Hermite)
+    float c1 = 0.5f * (x1 - xm1);
+    float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+    return ((c3 * t + c2) * t + c1) * t + x0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cstdint>
+#include <vector>
+
+#include "PitchShifter.h"
+
+/**
+ * Cycle Add/Drop Resampling Shifter ("Eco")
+ *
+ * The correction stage described in US Patent 5,973,252 section 3.3: the
+ * input is read back through a fractional read pointer that advances by the
+ * pitch ratio per output sample. Reading faster than the input arrives raises
+ * the pitch, and the gap between read and write pointers shrinks; when it
+ * leaves its window the pointer jumps by exactly one detected period, which
+ * repeats or drops a whole cycle and keeps the output in step with the input.
+ *
+ * Algorithm:
+ * 1. Write each channel into a power-of-two ring
+ * 2. Read at (write - delay) with 4-point Hermite interpolation
+ * 3. delay += 1 - ratio per sample
+ * 4. delay < lower bound: jump back one period (repeat a cycle)
+ *    delay > lower bound + longest period: jump forward one (drop a cycle)
+ * 5. Crossfade the old read pointer into the new one over a short span
+ *
+ * Cost is one interpolated read per sample and channel, a fraction of PSOLA.
+ * The trade-off is that formants move with the pitch, as with any resampler.
+ * Jump decisions are shared by all channels.
+ */
+class CycleResampler : public PitchShifter
+{
+public:
+    CycleResampler();
+    ~CycleResampler() override = default;
+
+    void prepare (double sampleRate, int maxBlockSize, int numChannels = 1) override;
+    void reset() override;
+
+    /** The longest period sets both the delay window and the latency. */
+    void setFrequencyRange (float minHz, float maxHz) override;
+
+    /** analysisInput is not needed: jumps are whole periods, not aligned to peaks. */
+    void process (const float* const* inputs, float* const* outputs, int numChannels, int numSamples,
+                  const float* pitchRatios, float detectedPeriod, float confidence,
+                  const float* analysisInput = nullptr) override;
+
+    /** Average delay: the middle of the read pointer's window. */
+    int getLatencySamples() const noexcept override { return latencySamples; }
+
+private:
+    void processChunk (const float* const* inputs, float* const* outputs, int channels,
+                       int offset, int numSamples, const float* pitchRatios, int ratioStride,
+                       float detectedPeriod, float confidence);
+    void updatePeriodRange() noexcept;
+
+    // 4-point Hermite read from one channel's ring at index + t
+    float readInterpolated (const float* ring, int index, float t) const noexcept;
+
+    // Each ring is followed by a mirror of its first interpolationGuard samples
+    int getRingStride() const noexcept { return ringSize + interpolationGuard; }
+    float* getRing (int channel) noexcept { return rings.data() + channel * getRingStride(); }
+
+    // 32.32 fixed-point positions in input samples
+    static constexpr int fractionBits = 32;
+    static constexpr double fixedOne = 4294967296.0;
+    static std::int64_t toFixed (std::int64_t samples) noexcept { return samples * (std::int64_t { 1 } << fractionBits); }
+    static float getFraction (std::int64_t position) noexcept
+    {
+        return static_cast<float> (static_cast<std::uint32_t> (position)) * static_cast<float> (1.0 / fixedOne);
+    }
+
+    // Input rings (channel-major, power-of-two plus the mirrored guard)
+    std::vector<float> rings;
+    int ringSize = 0;
+    int ringMask = 0;
+    std::int64_t totalSamplesWritten = 0;
+    int numChannels = 1;
+    int preparedBlockSize = 0;
+
+    // Read pointer, and the pointer being faded out after a jump; the delay
+    // is the distance from the write position
+    std::int64_t readPosition = 0;
+    std::int64_t fadePosition = 0;
+    int fadeRemaining = 0;
+    int fadeLength = 0;
+
+    // Per-sample read positions for the current chunk (sized in prepare)
+    std::vector<int> readIndices;
+    std::vector<float> readFractions;
+    std::vector<int> fadeIndices;
+    std::vector<float> fadeFractions;
+    std::vector<float> fadeGains;
+
+    // Delay window
+    int lowerDelay = 0;
+    int maxPeriodSamples = 0;
+    int minPeriodSamples = 0;
+    int allocatedMaxPeriod = 0;
+    int latencySamples = 0;
+
+    double currentSampleRate = 44100.0;
+    float minFrequencyHz = 50.0f;
+    float maxFrequencyHz = 1000.0f;
+
+    // Constants
+    static constexpr int interpolationGuard = 4;      // Hermite reads two samples ahead
+    static constexpr int maxCrossfadeSamples = 64;
+    static constexpr float lowestFrequencyHz = 20.0f; // Matches the detector's floor
+};
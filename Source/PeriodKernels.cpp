@@ -0,0 +1,197 @@
+#include "PeriodKernels.h"
+#include <juce_core/juce_core.h>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#elif JUCE_ARM && (defined (__ARM_NEON__) || defined (__ARM_NEON) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define PROTUNE_PERIOD_KERNELS_NEON 1
+#endif
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define PROTUNE_TARGET_AVX2 __attribute__ ((target ("avx2,fma")))
+#elif JUCE_INTEL && JUCE_MSVC
+ #define PROTUNE_TARGET_AVX2
+#endif
+
+namespace PeriodKernels
+{
+namespace
+{
+// Samples accumulated in float lanes before folding into double
+constexpr int blockLength = 256;
+
+void addScalarTail (Sums& sums, const float* previous, const float* current, int start, int length) noexcept
+{
+    for (int i = start; i < length; ++i)
+    {
+        double p = static_cast<double> (previous[i]);
+        double c = static_cast<double> (current[i]);
+        sums.previousEnergy += p * p;
+        sums.currentEnergy += c * c;
+        sums.correlation += c * p;
+    }
+}
+
+#if JUCE_INTEL
+double horizontalSum (__m128 v) noexcept
+{
+    alignas (16) float lanes[4];
+    _mm_store_ps (lanes, v);
+    return (static_cast<double> (lanes[0]) + static_cast<double> (lanes[1]))
+         + (static_cast<double> (lanes[2]) + static_cast<double> (lanes[3]));
+}
+
+Sums scoreSpansSSE (const float* previous, const float* current, int length) noexcept
+{
+    Sums sums;
+    int i = 0;
+    int vectorEnd = length & ~3;
+
+    while (i < vectorEnd)
+    {
+        int blockEnd = juce::jmin (vectorEnd, i + blockLength);
+        __m128 prevEnergy = _mm_setzero_ps();
+        __m128 currEnergy = _mm_setzero_ps();
+        __m128 correlation = _mm_setzero_ps();
+
+        for (; i < blockEnd; i += 4)
+        {
+            __m128 p = _mm_loadu_ps (previous + i);
+            __m128 c = _mm_loadu_ps (current + i);
+            prevEnergy = _mm_add_ps (prevEnergy, _mm_mul_ps (p, p));
+            currEnergy = _mm_add_ps (currEnergy, _mm_mul_ps (c, c));
+            correlation = _mm_add_ps (correlation, _mm_mul_ps (c, p));
+        }
+
+        sums.previousEnergy += horizontalSum (prevEnergy);
+        sums.currentEnergy += horizontalSum (currEnergy);
+        sums.correlation += horizontalSum (correlation);
+    }
+
+    addScalarTail (sums, previous, current, vectorEnd, length);
+    return sums;
+}
+
+PROTUNE_TARGET_AVX2 double horizontalSum (__m256 v) noexcept
+{
+    return horizontalSum (_mm256_castps256_ps128 (v)) + horizontalSum (_mm256_extractf128_ps (v, 1));
+}
+
+PROTUNE_TARGET_AVX2 Sums scoreSpansAVX2 (const float* previous, const float* current, int length) noexcept
+{
+    Sums sums;
+    int i = 0;
+    int vectorEnd = length & ~7;
+
+    while (i < vectorEnd)
+    {
+        int blockEnd = juce::jmin (vectorEnd, i + blockLength);
+        __m256 prevEnergy = _mm256_setzero_ps();
+        __m256 currEnergy = _mm256_setzero_ps();
+        __m256 correlation = _mm256_setzero_ps();
+
+        for (; i < blockEnd; i += 8)
+        {
+            __m256 p = _mm256_loadu_ps (previous + i);
+            __m256 c = _mm256_loadu_ps (current + i);
+            prevEnergy = _mm256_fmadd_ps (p, p, prevEnergy);
+            currEnergy = _mm256_fmadd_ps (c, c, currEnergy);
+            correlation = _mm256_fmadd_ps (c, p, correlation);
+        }
+
+        sums.previousEnergy += horizontalSum (prevEnergy);
+        sums.currentEnergy += horizontalSum (currEnergy);
+        sums.correlation += horizontalSum (correlation);
+    }
+
+    addScalarTail (sums, previous, current, vectorEnd, length);
+    return sums;
+}
+#endif
+
+#if PROTUNE_PERIOD_KERNELS_NEON
+double horizontalSum (float32x4_t v) noexcept
+{
+    return (static_cast<double> (vgetq_lane_f32 (v, 0)) + static_cast<double> (vgetq_lane_f32 (v, 1)))
+         + (static_cast<double> (vgetq_lane_f32 (v, 2)) + static_cast<double> (vgetq_lane_f32 (v, 3)));
+}
+
+Sums scoreSpansNEON (const float* previous, const float* current, int length) noexcept
+{
+    Sums sums;
+    int i = 0;
+    int vectorEnd = length & ~3;
+
+    while (i < vectorEnd)
+    {
+        int blockEnd = juce::jmin (vectorEnd, i + blockLength);
+        float32x4_t prevEnergy = vdupq_n_f32 (0.0f);
+        float32x4_t currEnergy = vdupq_n_f32 (0.0f);
+        float32x4_t correlation = vdupq_n_f32 (0.0f);
+
+        for (; i < blockEnd; i += 4)
+        {
+            float32x4_t p = vld1q_f32 (previous + i);
+            float32x4_t c = vld1q_f32 (current + i);
+            prevEnergy = vmlaq_f32 (prevEnergy, p, p);
+            currEnergy = vmlaq_f32 (currEnergy, c, c);
+            correlation = vmlaq_f32 (correlation, c, p);
+        }
+
+        sums.previousEnergy += horizontalSum (prevEnergy);
+        sums.currentEnergy += horizontalSum (currEnergy);
+        sums.correlation += horizontalSum (correlation);
+    }
+
+    addScalarTail (sums, previous, current, vectorEnd, length);
+    return sums;
+}
+#endif
+
+using KernelFunction = Sums (*) (const float*, const float*, int) noexcept;
+
+struct Kernel
+{
+    KernelFunction function;
+    const char* name;
+};
+
+Kernel selectKernel() noexcept
+{
+   #if JUCE_INTEL
+    if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3())
+        return { scoreSpansAVX2, "AVX2" };
+
+    return { scoreSpansSSE, "SSE2" };
+   #elif PROTUNE_PERIOD_KERNELS_NEON
+    return { scoreSpansNEON, "NEON" };
+   #else
+    return { scoreSpansReference, "Scalar" };
+   #endif
+}
+
+const Kernel& getActiveKernel() noexcept
+{
+    static const Kernel kernel = selectKernel();
+    return kernel;
+}
+}
+
+Sums scoreSpans (const float* previous, const float* current, int length) noexcept
+{
+    return getActiveKernel().function (previous, current, length);
+}
+
+Sums scoreSpansReference (const float* previous, const float* current, int length) noexcept
+{
+    Sums sums;
+    addScalarTail (sums, previous, current, 0, length);
+    return sums;
+}
+
+const char* getActiveKernelName() noexcept
+{
+    return getActiveKernel().name;
+}
+}
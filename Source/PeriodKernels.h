@@ -0,0 +1,36 @@
+#pragma once
+
+/**
+ * Period Scoring Kernels
+ *
+ * Vectorised inner loop of the patent's decision statistic. For a lag L the
+ * detector compares the newest L samples ("current") with the L samples
+ * before them ("previous"):
+ *
+ *   E(L) = sum(previous^2) + sum(current^2)
+ *   H(L) = sum(current * previous)
+ *
+ * Both spans are walked once with no per-sample branch. Products accumulate
+ * in float SIMD lanes over short blocks that are folded into double, which
+ * keeps results within float rounding of a double-precision loop.
+ *
+ * x86 uses SSE2 with an AVX2/FMA path selected at runtime; ARM uses NEON.
+ */
+namespace PeriodKernels
+{
+    struct Sums
+    {
+        double previousEnergy = 0.0;
+        double currentEnergy = 0.0;
+        double correlation = 0.0;
+    };
+
+    /** Scores two equal-length spans with the fastest kernel this CPU supports. */
+    Sums scoreSpans (const float* previous, const float* current, int length) noexcept;
+
+    /** Scalar double-precision reference, for benchmarks and accuracy checks. */
+    Sums scoreSpansReference (const float* previous, const float* current, int length) noexcept;
+
+    /** Name of the kernel scoreSpans dispatches to ("AVX2", "SSE2", "NEON" or "Scalar"). */
+    const char* getActiveKernelName() noexcept;
+}
@@ -1,4 +1,5 @@
 #include "PitchCorrectionEngine.h"
+#include "PitchTrackFile.h"
 #include <algorithm>
 #include <cmath>
 
@@ -9,6 +10,18 @@ inline int positiveModulo (int value, int modulo) noexcept
     auto remainder = value % modulo;
     return remainder < 0 ? remainder + modulo : remainder;
 }
+
+bool sameSettings (const ScaleMapper::Settings& a, const ScaleMapper::Settings& b) noexcept
+{
+    return a.type == b.type && a.root == b.root && a.customMask == b.customMask
+        && a.transpose == b.transpose && a.detune == b.detune;
+}
+
+bool sameSettings (const RetuneEngine::Settings& a, const RetuneEngine::Settings& b) noexcept
+{
+    return a.retuneSpeedMs == b.retuneSpeedMs && a.vibratoTracking == b.vibratoTracking
+        && a.humanize == b.humanize && a.noteTransition == b.noteTransition;
+}
 }
 
 // Legacy scale mask generation (kept for compatibility)
@@ -51,9 +64,10 @@ PitchCorrectionEngine::AllowedMask PitchCorrectionEngine::Parameters::ScaleSetti
 
 PitchCorrectionEngine::PitchCorrectionEngine()
 {
+    harmonyNotes.fill (-1);
 }
 
-void PitchCorrectionEngine::prepare (double sampleRate, int samplesPerBlock)
+void PitchCorrectionEngine::prepare (double sampleRate, int samplesPerBlock, int maxChannels)
 {
     currentSampleRate = sampleRate;
     maxBlockSize = samplesPerBlock;
@@ -62,11 +76,43 @@ void PitchCorrectionEngine::prepare (double sampleRate, int samplesPerBlock)
     detector.prepare (sampleRate, samplesPerBlock);
     retuneEngine.prepare (sampleRate);
 
-    // Mono buffer for pitch detection (mix down stereo)
-    monoBuffer.setSize (1, samplesPerBlock);
+    // Mono mixdown and per-sample ratios never span more than one hop
+    monoBuffer.setSize (2, maxAnalysisHopSize);
+    hopRatios.assign (static_cast<size_t> (maxAnalysisHopSize), 1.0f);
+
+    // One linked shifter for all channels, plus single-channel PSOLAs for
+    // unlinked Quality mode; every mode is prepared so switching never
+    // allocates, and channel pointers are allocated here so process() never
+    // resizes
+    shifterChannels = juce::jmax (1, maxChannels);
+    psolaShifter.prepare (sampleRate, samplesPerBlock, shifterChannels);
+    cycleResampler.prepare (sampleRate, samplesPerBlock, shifterChannels);
+    spectralShifter.prepare (sampleRate, samplesPerBlock, shifterChannels);
+    channelShifters.resize (static_cast<size_t> (shifterChannels));
+    for (auto& shifter : channelShifters)
+        shifter.prepare (sampleRate, samplesPerBlock, 1);
+    channelPointers.assign (static_cast<size_t> (shifterChannels), nullptr);
+    samplesAnalysed = 0;
+
+    // Bypass delays by the reported latency, so its line covers the longest
+    // any range, shifter and lookahead can report (the lowest range sets
+    // each shifter's; updateComponentSettings() restores the real one)
+    int maxShifterLatency = 0;
+    for (PitchShifter* shifter : { static_cast<PitchShifter*> (&psolaShifter),
+                                   static_cast<PitchShifter*> (&cycleResampler),
+                                   static_cast<PitchShifter*> (&spectralShifter) })
+    {
+        shifter->setFrequencyRange (0.0f, 0.0f);
+        maxShifterLatency = juce::jmax (maxShifterLatency, shifter->getLatencySamples());
+    }
+
+    auto maxLookahead = static_cast<int> (std::ceil (maxLookaheadSeconds * sampleRate / analysisHopSize)) * analysisHopSize;
+    bypassDelay.setSize (shifterChannels, maxShifterLatency + maxLookahead + juce::jmax (1, samplesPerBlock));
+    bypassDelay.clear();
+    bypassWritePosition = 0;
 
-    // Prepare at least 2 shifters (stereo)
-    ensureShifterChannels (2);
+    // The delay line follows the new channel count and sample rate
+    setLookahead (getLookaheadSamples());
 
     updateComponentSettings();
 }
@@ -76,7 +122,10 @@ void PitchCorrectionEngine::reset()
     detector.reset();
     retuneEngine.reset();
 
-    for (auto& shifter : shifters)
+    psolaShifter.reset();
+    cycleResampler.reset();
+    spectralShifter.reset();
+    for (auto& shifter : channelShifters)
         shifter.reset();
 
     lastDetectedFrequency = 0.0f;
@@ -84,35 +133,174 @@ void PitchCorrectionEngine::reset()
     lastDetectionConfidence = 0.0f;
     lastPitchRatio = 1.0f;
     heldMidiNote = -1;
+    harmonyNotes.fill (-1);
+    numPendingMidiEvents = 0;
+    nextMidiEvent = 0;
+
+    for (auto& voice : harmonyVoices)
+        voice.gain = 0.0f;
+
+    setShifterHarmonyVoices();
+
+    hopPosition = 0;
+    currentFrame = {};
+
+    lookaheadDelay.clear();
+    lookaheadPosition = 0;
+    lookaheadPriming = getLookaheadSamples();
+    bypassDelay.clear();
+    bypassWritePosition = 0;
+    std::fill (lookaheadFrames.begin(), lookaheadFrames.end(), PitchDetector::Result {});
+}
+
+void PitchCorrectionEngine::setAnalysisHopSize (int hopSize)
+{
+    analysisHopSize = juce::jlimit (minAnalysisHopSize, maxAnalysisHopSize, hopSize);
+    hopPosition = juce::jmin (hopPosition, analysisHopSize - 1);
 }
 
 void PitchCorrectionEngine::setParameters (const Parameters& newParams)
 {
+    // Only components whose inputs changed are touched, so an unchanged
+    // snapshot costs a few comparisons and never restarts detector tracking
+    const Parameters previous = params;
     params = newParams;
-    updateComponentSettings();
+
+    if (params.inputType != previous.inputType
+        || params.rangeLowHz != previous.rangeLowHz
+        || params.rangeHighHz != previous.rangeHighHz
+        || params.tracking != previous.tracking)
+        updateDetectorSettings();
+
+    if (params.shifterMode != previous.shifterMode || params.linkChannels != previous.linkChannels)
+        updateShifterSelection();
+
+    updateScaleSettings();
+    updateRetuneSettings();
 }
 
 void PitchCorrectionEngine::updateComponentSettings()
 {
-    // Update pitch detector
-    detector.setInputType (params.inputType);
-    detector.setFrequencyRange (params.rangeLowHz, params.rangeHighHz);
-    detector.setTracking (params.tracking);
+    updateDetectorSettings();
+    updateShifterSelection();
+    updateScaleSettings();
+    updateRetuneSettings();
+}
+
+void PitchCorrectionEngine::setPitchTrack (const PitchTrackFile* track, std::int64_t startSample)
+{
+    jassert (track == nullptr || (track->getSettings().hopSize == analysisHopSize && startSample % analysisHopSize == 0));
+    pitchTrack = track;
+    pitchTrackStart = startSample;
+}
+
+void PitchCorrectionEngine::setLookahead (int lookaheadSamples)
+{
+    auto maxHops = static_cast<int> (std::ceil (maxLookaheadSeconds * currentSampleRate / analysisHopSize));
+    lookaheadHops = juce::jlimit (0, maxHops, (lookaheadSamples + analysisHopSize - 1) / analysisHopSize);
+
+    pitchRefiner.prepare (currentSampleRate, analysisHopSize, lookaheadHops);
+    lookaheadFrames.assign (static_cast<size_t> (pitchRefiner.getWindowSize()), PitchDetector::Result {});
+    lookaheadDelay.setSize (shifterChannels + 1, juce::jmax (1, getLookaheadSamples()));
+    lookaheadDelay.clear();
+    lookaheadPosition = 0;
+    lookaheadPriming = getLookaheadSamples();
+}
 
-    // Update scale mapper
+int PitchCorrectionEngine::getDelaySamples() const noexcept
+{
+    // A pitch track already holds the future, so only detection delays
+    return pitchTrack == nullptr ? getLookaheadSamples() : 0;
+}
+
+void PitchCorrectionEngine::configureDetector (PitchDetector& target, const Parameters& parameters)
+{
+    // The input type sets the range; the legacy range only overrides it once
+    // moved off its defaults
+    const Parameters defaultParams;
+    target.setInputType (parameters.inputType);
+    if (std::abs (parameters.rangeLowHz - defaultParams.rangeLowHz) >= 1.0e-3f
+        || std::abs (parameters.rangeHighHz - defaultParams.rangeHighHz) >= 1.0e-3f)
+        target.setFrequencyRange (parameters.rangeLowHz, parameters.rangeHighHz);
+    target.setTracking (parameters.tracking);
+}
+
+ScaleMapper::Settings PitchCorrectionEngine::makeScaleSettings (const Parameters& parameters)
+{
     ScaleMapper::Settings scaleSettings;
 
     // Convert legacy scale type to new enum
-    scaleSettings.type = static_cast<ScaleMapper::ScaleType> (static_cast<int> (params.scale.type));
-    scaleSettings.root = params.scale.root;
-    scaleSettings.customMask = params.customScaleMask;
-    scaleSettings.transpose = params.transpose;
-    scaleSettings.detune = params.detune;
-    scaleMapper.setSettings (scaleSettings);
-
-    // Update retune engine
-    RetuneEngine::Settings retuneSettings;
+    scaleSettings.type = static_cast<ScaleMapper::ScaleType> (static_cast<int> (parameters.scale.type));
+    scaleSettings.root = parameters.scale.root;
+    scaleSettings.customMask = parameters.customScaleMask;
+    scaleSettings.transpose = parameters.transpose;
+    scaleSettings.detune = parameters.detune;
+    return scaleSettings;
+}
+
+void PitchCorrectionEngine::updateDetectorSettings()
+{
+    configureDetector (detector, params);
+
+    // The shifters' buffers and latency follow the same range
+    psolaShifter.setFrequencyRange (detector.getMinFrequency(), detector.getMaxFrequency());
+    cycleResampler.setFrequencyRange (detector.getMinFrequency(), detector.getMaxFrequency());
+    spectralShifter.setFrequencyRange (detector.getMinFrequency(), detector.getMaxFrequency());
+    for (auto& shifter : channelShifters)
+        shifter.setFrequencyRange (detector.getMinFrequency(), detector.getMaxFrequency());
+}
+
+void PitchCorrectionEngine::updateShifterSelection()
+{
+    // A newly selected shifter starts from a clean state
+    PitchShifter* selectedShifter = &psolaShifter;
+    if (params.shifterMode == ShifterMode::Eco)
+        selectedShifter = &cycleResampler;
+    else if (params.shifterMode == ShifterMode::Spectral)
+        selectedShifter = &spectralShifter;
+
+    // Only PSOLA places pitch marks, so only Quality mode can be unlinked
+    bool selectedUnlinked = selectedShifter == &psolaShifter && ! params.linkChannels;
+
+    if (selectedShifter != activeShifter || selectedUnlinked != shiftUnlinked)
+    {
+        if (selectedUnlinked)
+            for (auto& shifter : channelShifters)
+                shifter.reset();
+        else
+            selectedShifter->reset();
+
+        activeShifter = selectedShifter;
+        shiftUnlinked = selectedUnlinked;
+        setShifterHarmonyVoices();
+    }
+}
+
+void PitchCorrectionEngine::setShifterHarmonyVoices() noexcept
+{
+    if (shiftUnlinked)
+    {
+        for (auto& shifter : channelShifters)
+            shifter.setHarmonyVoices (harmonyVoices.data(), maxHarmonyVoices);
+    }
+    else
+    {
+        activeShifter->setHarmonyVoices (harmonyVoices.data(), maxHarmonyVoices);
+    }
+}
+
+void PitchCorrectionEngine::updateScaleSettings()
+{
+    auto scaleSettings = makeScaleSettings (params);
+
+    if (! sameSettings (scaleSettings, scaleMapper.getSettings()))
+        scaleMapper.setSettings (scaleSettings);
+}
+
+void PitchCorrectionEngine::updateRetuneSettings()
+{
     const Parameters defaultParams;
+    RetuneEngine::Settings retuneSettings;
     float retuneSpeedMs = params.retuneSpeedMs;
     if (std::abs (retuneSpeedMs - defaultParams.retuneSpeedMs) < 1.0e-3f)
         retuneSpeedMs = params.speed;
@@ -123,48 +311,363 @@ void PitchCorrectionEngine::updateComponentSettings()
     if (std::abs (noteTransition - defaultParams.noteTransition) < 1.0e-3f)
         noteTransition = params.transition;
     retuneSettings.noteTransition = noteTransition;
-    retuneEngine.setSettings (retuneSettings);
+
+    if (! sameSettings (retuneSettings, retuneEngine.getSettings()))
+        retuneEngine.setSettings (retuneSettings);
 }
 
 void PitchCorrectionEngine::pushMidi (const juce::MidiBuffer& midiMessages)
 {
+    // Note events are queued with their sample positions, moved later by
+    // any lookahead delay so they stay with the audio they came with, and
+    // applied as process() reaches them; anything else MIDI-wise is ignored
     for (const auto metadata : midiMessages)
     {
         const auto& m = metadata.getMessage();
+        MidiEvent event;
+        event.samplePosition = metadata.samplePosition + getDelaySamples();
+
         if (m.isNoteOn())
-            heldMidiNote = m.getNoteNumber();
+            event.type = MidiEvent::Type::NoteOn;
         else if (m.isNoteOff())
+            event.type = MidiEvent::Type::NoteOff;
+        else if (m.isAllNotesOff() || m.isAllSoundOff())
+            event.type = MidiEvent::Type::AllNotesOff;
+        else
+            continue;
+
+        event.note = m.getNoteNumber();
+
+        // A full queue applies its earliest event now to make room, so
+        // that one event is early rather than the newest by a whole delay
+        if (numPendingMidiEvents == maxPendingMidiEvents)
         {
-            if (heldMidiNote == m.getNoteNumber())
-                heldMidiNote = -1;
+            applyMidiEvent (pendingMidiEvents[0]);
+            std::move (pendingMidiEvents.begin() + 1, pendingMidiEvents.end(), pendingMidiEvents.begin());
+            --numPendingMidiEvents;
         }
+
+        pendingMidiEvents[static_cast<size_t> (numPendingMidiEvents++)] = event;
     }
 }
 
+void PitchCorrectionEngine::applyMidiEvent (const MidiEvent& event)
+{
+    if (event.type == MidiEvent::Type::NoteOn)
+    {
+        heldMidiNote = event.note;
+
+        // Take a free harmony slot (age 0), or the one holding the oldest note
+        auto age = [this] (int v)
+        {
+            auto index = static_cast<size_t> (v);
+            return harmonyNotes[index] < 0 ? 0u : harmonyNoteOrder[index];
+        };
+
+        int slot = 0;
+        for (int v = 1; v < maxHarmonyVoices; ++v)
+            if (age (v) < age (slot))
+                slot = v;
+
+        for (int v = 0; v < maxHarmonyVoices; ++v)
+            if (harmonyNotes[static_cast<size_t> (v)] == event.note)
+                slot = v;
+
+        harmonyNotes[static_cast<size_t> (slot)] = event.note;
+        harmonyNoteOrder[static_cast<size_t> (slot)] = ++harmonyNoteCounter;
+    }
+    else if (event.type == MidiEvent::Type::NoteOff)
+    {
+        if (heldMidiNote == event.note)
+            heldMidiNote = -1;
+
+        for (auto& note : harmonyNotes)
+            if (note == event.note)
+                note = -1;
+    }
+    else
+    {
+        heldMidiNote = -1;
+        harmonyNotes.fill (-1);
+    }
+}
+
+int PitchCorrectionEngine::applyMidiEventsUpTo (int samplePosition, int numSamples)
+{
+    // Events past the end of the block land on its last sample, unless
+    // they are waiting for delayed audio
+    bool delayed = getDelaySamples() > 0;
+    auto eventPosition = [delayed, numSamples] (const MidiEvent& event)
+    {
+        return delayed ? event.samplePosition : juce::jmin (event.samplePosition, numSamples - 1);
+    };
+
+    bool applied = false;
+
+    while (nextMidiEvent < numPendingMidiEvents)
+    {
+        const auto& event = pendingMidiEvents[static_cast<size_t> (nextMidiEvent)];
+        if (eventPosition (event) > samplePosition)
+            break;
+
+        applyMidiEvent (event);
+        ++nextMidiEvent;
+        applied = true;
+    }
+
+    // Retarget from the current frame's detection right away rather than at
+    // the next hop, so a note lands on its own sample
+    if (applied && params.midiEnabled)
+        updateTarget (currentFrame);
+    else if (applied && params.harmonyEnabled)
+        updateHarmonyVoices (currentFrame.detection);
+
+    return nextMidiEvent < numPendingMidiEvents
+        ? juce::jmin (eventPosition (pendingMidiEvents[static_cast<size_t> (nextMidiEvent)]), numSamples)
+        : numSamples;
+}
+
 void PitchCorrectionEngine::process (juce::AudioBuffer<float>& buffer)
 {
     if (buffer.getNumChannels() == 0 || buffer.getNumSamples() == 0)
         return;
 
     int numSamples = buffer.getNumSamples();
-    int numChannels = buffer.getNumChannels();
 
-    // Bypass mode - just return input unchanged
+    // The bypass line is fed every block, so switching Bypass on is aligned
+    // from its first sample
+    for (int start = 0; start < numSamples; start += juce::jmax (1, maxBlockSize))
+        processBypassDelay (buffer, start, juce::jmin (juce::jmax (1, maxBlockSize), numSamples - start));
+
+    // Bypass mode - the input delayed by the reported latency, so host delay
+    // compensation keeps it aligned (held notes still update, as their
+    // delayed audio goes by)
     if (params.bypass)
+    {
+        nextMidiEvent = 0;
+        while (nextMidiEvent < numPendingMidiEvents
+               && pendingMidiEvents[static_cast<size_t> (nextMidiEvent)].samplePosition < numSamples)
+            applyMidiEvent (pendingMidiEvents[static_cast<size_t> (nextMidiEvent++)]);
+
+        carryMidiEvents (numSamples);
         return;
+    }
+
+    // Channels beyond those prepared pass through unprocessed
+    jassert (buffer.getNumChannels() <= shifterChannels);
+
+    // Split the block at analysis hop boundaries so detection cost and
+    // results do not depend on the host block size, and at MIDI events so
+    // each note changes the target on its own sample
+    nextMidiEvent = 0;
+    int position = 0;
+    while (position < numSamples)
+    {
+        int nextEvent = applyMidiEventsUpTo (position, numSamples);
+        int segmentLength = juce::jmin (numSamples - position, analysisHopSize - hopPosition, nextEvent - position);
+        processSegment (buffer, position, segmentLength);
+        position += segmentLength;
+    }
+
+    carryMidiEvents (numSamples);
+}
+
+void PitchCorrectionEngine::carryMidiEvents (int numSamples)
+{
+    // Events still ahead of the delayed audio move on to the next block
+    int numCarried = 0;
+    for (int i = nextMidiEvent; i < numPendingMidiEvents; ++i)
+    {
+        auto event = pendingMidiEvents[static_cast<size_t> (i)];
+        event.samplePosition -= numSamples;
+        pendingMidiEvents[static_cast<size_t> (numCarried++)] = event;
+    }
+
+    numPendingMidiEvents = numCarried;
+}
 
-    // Mix down to mono for pitch detection
-    monoBuffer.setSize (1, numSamples, false, false, true);
-    monoBuffer.clear();
+void PitchCorrectionEngine::processBypassDelay (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    // The line holds the latest input; bypassed, the block is replaced by the
+    // input from getLatencySamples() ago. The line is at least the longest
+    // latency plus a block, so the read never reaches what this call wrote
+    // beyond it.
+    int numChannels = juce::jmin (buffer.getNumChannels(), shifterChannels);
+    int size = bypassDelay.getNumSamples();
+    int writeRun = juce::jmin (numSamples, size - bypassWritePosition);
+    int readPosition = ((bypassWritePosition - getLatencySamples()) % size + size) % size;
+    int readRun = juce::jmin (numSamples, size - readPosition);
 
     for (int ch = 0; ch < numChannels; ++ch)
-        monoBuffer.addFrom (0, 0, buffer, ch, 0, numSamples, 1.0f / numChannels);
+    {
+        auto* samples = buffer.getWritePointer (ch, startSample);
+        auto* line = bypassDelay.getWritePointer (ch);
+        juce::FloatVectorOperations::copy (line + bypassWritePosition, samples, writeRun);
+        juce::FloatVectorOperations::copy (line, samples + writeRun, numSamples - writeRun);
 
-    // Detect pitch
-    auto detectionResult = detector.process (monoBuffer.getReadPointer (0), numSamples);
+        if (params.bypass)
+        {
+            juce::FloatVectorOperations::copy (samples, line + readPosition, readRun);
+            juce::FloatVectorOperations::copy (samples + readRun, line, numSamples - readRun);
+        }
+    }
 
-    lastDetectedFrequency = detectionResult.frequency;
-    lastDetectionConfidence = detectionResult.confidence;
+    bypassWritePosition = (bypassWritePosition + numSamples) % size;
+}
+
+void PitchCorrectionEngine::processSegment (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    int numChannels = juce::jmin (buffer.getNumChannels(), shifterChannels);
+
+    // Mix down to mono for pitch detection (before the channels are shifted in place)
+    monoBuffer.clear (0, 0, numSamples);
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        monoBuffer.addFrom (0, 0, buffer, ch, startSample, numSamples, 1.0f / static_cast<float> (buffer.getNumChannels()));
+
+    // Looking ahead, the shifter gets the input from getDelaySamples() ago
+    // while the detector gets it now. The delay is whole hops and segments
+    // never cross a hop, so a segment never wraps the delay line.
+    const float* shifterMono = monoBuffer.getReadPointer (0);
+    if (getDelaySamples() > 0)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* samples = buffer.getWritePointer (ch, startSample);
+            auto* delayed = lookaheadDelay.getWritePointer (ch, lookaheadPosition);
+            std::swap_ranges (samples, samples + numSamples, delayed);
+        }
+
+        auto* delayedMono = lookaheadDelay.getWritePointer (shifterChannels, lookaheadPosition);
+        monoBuffer.copyFrom (1, 0, delayedMono, numSamples);
+        std::copy (monoBuffer.getReadPointer (0), monoBuffer.getReadPointer (0) + numSamples, delayedMono);
+        shifterMono = monoBuffer.getReadPointer (1);
+
+        lookaheadPosition = (lookaheadPosition + numSamples) % getDelaySamples();
+    }
+
+    // Until the first decision the shifter and retune sit still, so they
+    // start on the first real input whether the future comes from a stream
+    // (which first delays silence) or a track (which decides at once)
+    if (lookaheadPriming > 0 && pitchTrack != nullptr)
+    {
+        lookaheadPriming = 0;
+        currentFrame = analyseHop();
+    }
+
+    bool priming = lookaheadPriming > 0;
+    if (! priming)
+    {
+        // Per-sample ratio curve from the retune smoother; it runs continuously,
+        // and frames without a correction glide it back to 1 rather than
+        // jumping there
+        retuneEngine.renderRatios (hopRatios.data(), numSamples);
+
+        // Shift all channels in place with one set of pitch marks, taken from
+        // the same mono mix the detector sees; unlinked, each channel takes
+        // its marks from itself (ratio and period still come from the mix)
+        for (int ch = 0; ch < numChannels; ++ch)
+            channelPointers[static_cast<size_t> (ch)] = buffer.getWritePointer (ch, startSample);
+
+        if (shiftUnlinked)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                float* const* channel = channelPointers.data() + ch;
+                channelShifters[static_cast<size_t> (ch)].process (
+                    channel, channel, 1, numSamples, hopRatios.data(),
+                    currentFrame.detection.period, currentFrame.detection.confidence, *channel);
+            }
+        }
+        else
+        {
+            activeShifter->process (
+                channelPointers.data(),
+                channelPointers.data(),
+                numChannels,
+                numSamples,
+                hopRatios.data(),
+                currentFrame.detection.period,
+                currentFrame.detection.confidence,
+                shifterMono
+            );
+        }
+    }
+
+    if (pitchTrack == nullptr)
+        detector.pushSamples (monoBuffer.getReadPointer (0), numSamples);
+
+    hopPosition += numSamples;
+    samplesAnalysed += numSamples;
+    if (priming)
+        lookaheadPriming -= numSamples;
+
+    // A completed hop yields the frame that drives the next one; while
+    // priming, frames only fill the lookahead window
+    if (hopPosition >= analysisHopSize)
+    {
+        hopPosition = 0;
+        if (lookaheadPriming > 0)
+            pushLookaheadFrame (detector.analyse());
+        else
+            currentFrame = analyseHop();
+    }
+}
+
+PitchCorrectionEngine::AnalysisFrame PitchCorrectionEngine::analyseHop()
+{
+    // A cached track's frame i is the hop ending at sample (i + 1) * hop
+    AnalysisFrame frame;
+    if (lookaheadHops > 0)
+        frame.detection = refineHop();
+    else if (pitchTrack != nullptr)
+        frame.detection = pitchTrack->getFrame ((pitchTrackStart + samplesAnalysed) / analysisHopSize - 1).detection;
+    else
+        frame.detection = detector.analyse();
+
+    lastDetectedFrequency = frame.detection.frequency;
+    lastDetectionConfidence = frame.detection.confidence;
+
+    updateTarget (frame);
+
+    AnalysisFifo::Frame published;
+    published.detectedFrequency = lastDetectedFrequency;
+    published.targetFrequency = lastTargetFrequency;
+    published.confidence = lastDetectionConfidence;
+    published.pitchRatio = lastPitchRatio;
+    published.samplePosition = samplesAnalysed;
+    analysisFifo.push (published);
+
+    return frame;
+}
+
+PitchDetector::Result PitchCorrectionEngine::refineHop()
+{
+    if (pitchTrack != nullptr)
+    {
+        // The window around the frame for the next hop, read straight from
+        // the track; before its start and past its end read as unvoiced
+        auto centre = (pitchTrackStart + samplesAnalysed) / analysisHopSize - 1;
+        for (size_t i = 0; i < lookaheadFrames.size(); ++i)
+            lookaheadFrames[i] = pitchTrack->getFrame (centre - lookaheadHops + static_cast<std::int64_t> (i)).detection;
+    }
+    else
+    {
+        // The newest frame is lookaheadHops ahead of the delayed audio
+        pushLookaheadFrame (detector.analyse());
+    }
+
+    return pitchRefiner.refine (lookaheadFrames.data());
+}
+
+void PitchCorrectionEngine::pushLookaheadFrame (const PitchDetector::Result& frame) noexcept
+{
+    std::copy (lookaheadFrames.begin() + 1, lookaheadFrames.end(), lookaheadFrames.begin());
+    lookaheadFrames.back() = frame;
+}
+
+void PitchCorrectionEngine::updateTarget (AnalysisFrame& frame)
+{
+    const auto& detectionResult = frame.detection;
 
     // Map to target note
     float targetFrequency = 0.0f;
@@ -187,50 +690,54 @@ void PitchCorrectionEngine::process (juce::AudioBuffer<float>& buffer)
 
     lastTargetFrequency = targetFrequency;
 
-    // Calculate pitch ratio with retune smoothing
-    float pitchRatio = 1.0f;
-
-    if (detectionResult.voiced && targetFrequency > 0.0f && detectionResult.frequency > 0.0f)
-    {
-        pitchRatio = retuneEngine.process (detectionResult.frequency, targetFrequency, numSamples);
-    }
-
-    lastPitchRatio = pitchRatio;
+    // New target for the retune smoother; the ratio curve itself is rendered
+    // per sample while the next hop is processed
+    frame.corrected = detectionResult.voiced && targetFrequency > 0.0f && detectionResult.frequency > 0.0f;
+    if (frame.corrected)
+        retuneEngine.setTarget (detectionResult.frequency, targetFrequency);
+    else
+        retuneEngine.release();
 
-    // Ensure we have enough shifters
-    ensureShifterChannels (numChannels);
+    lastPitchRatio = frame.corrected ? retuneEngine.getCurrentRatio() : 1.0f;
 
-    // Apply pitch shifting to each channel
-    for (int ch = 0; ch < numChannels; ++ch)
-    {
-        auto* channelData = buffer.getWritePointer (ch);
-        shifters[static_cast<size_t> (ch)].process (
-            channelData,
-            channelData,
-            numSamples,
-            pitchRatio,
-            detectionResult.period,
-            detectionResult.confidence
-        );
-    }
+    updateHarmonyVoices (detectionResult);
 }
 
-void PitchCorrectionEngine::ensureShifterChannels (int numChannels)
+void PitchCorrectionEngine::updateHarmonyVoices (const PitchDetector::Result& detection)
 {
-    if (static_cast<int> (shifters.size()) < numChannels)
+    // Each held note is a voice from the same detection. Within an octave of
+    // the sung pitch it sounds at exactly that note; further out it is
+    // folded by octaves into the shifters' range (ratios 0.5 to 2, which is
+    // what PSOLA's grain arena is sized for), keeping the note name but not
+    // the octave
+    bool voiced = params.harmonyEnabled && detection.voiced && detection.frequency > 0.0f;
+
+    for (int v = 0; v < maxHarmonyVoices; ++v)
     {
-        size_t oldSize = shifters.size();
-        shifters.resize (static_cast<size_t> (numChannels));
+        auto& voice = harmonyVoices[static_cast<size_t> (v)];
+        int note = harmonyNotes[static_cast<size_t> (v)];
 
-        for (size_t i = oldSize; i < shifters.size(); ++i)
-            shifters[i].prepare (currentSampleRate, maxBlockSize);
+        if (voiced && note >= 0)
+        {
+            float ratio = ScaleMapper::midiToFrequency (static_cast<float> (note)) / detection.frequency;
+            while (ratio > 2.0f)
+                ratio *= 0.5f;
+            while (ratio < 0.5f)
+                ratio *= 2.0f;
+
+            voice.ratio = ratio;
+            voice.gain = params.harmonyLevel;
+        }
+        else
+        {
+            voice.gain = 0.0f;
+        }
     }
+
+    setShifterHarmonyVoices();
 }
 
 int PitchCorrectionEngine::getLatencySamples() const noexcept
 {
-    if (shifters.empty())
-        return 0;
-
-    return shifters[0].getLatencySamples();
+    return activeShifter->getLatencySamples() + getDelaySamples();
 }
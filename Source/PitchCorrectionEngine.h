@@ -4,6 +4,7 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
+#include <array>
 #include <limits>
 #include <memory>
 #include <vector>
@@ -13,6 +14,12 @@
 #include "ScaleMapper.h"
 #include "RetuneEngine.h"
 #include "PsolaShifter.h"
+#include "CycleResampler.h"
+#include "SpectralPeakShifter.h"
+#include "AnalysisFifo.h"
+#include "PitchRefiner.h"
+
+class PitchTrackFile;
 
 /**
  * Main Pitch Correction Engine
@@ -25,12 +32,21 @@
  * 2. ScaleMapper: Map to target note based on key/scale/MIDI
  * 3. RetuneEngine: Apply retune speed and humanization
  * 4. PsolaShifter: Pitch shift with natural formant preservation
+ *    (or CycleResampler in Eco mode, SpectralPeakShifter in Spectral mode)
  */
 class PitchCorrectionEngine
 {
 public:
     using AllowedMask = std::uint16_t;
 
+    // Pitch shifting algorithm
+    enum class ShifterMode
+    {
+        Quality,        // PSOLA, formant preserving
+        Eco,            // Cycle add/drop resampling, a fraction of the CPU
+        Spectral        // Peak-locked phase vocoder, constant cost at any ratio
+    };
+
     struct Parameters
     {
         // Input type for frequency range optimization
@@ -55,12 +71,17 @@ public:
         float transition = 0.2f;                    // Alias for noteTransition
         float toleranceCents = 0.0f;                // Deprecated
         float formantPreserve = 1.0f;               // PSOLA always preserves, but kept for UI
-        float rangeLowHz = 80.0f;
-        float rangeHighHz = 1000.0f;
+        float rangeLowHz = 80.0f;                   // Overrides the input type range
+        float rangeHighHz = 800.0f;                 // when moved off these defaults
 
         // Global
+        ShifterMode shifterMode = ShifterMode::Quality;
+        bool linkChannels = true;                   // One set of pitch marks for all channels (Quality)
         bool bypass = false;
         bool midiEnabled = false;                   // Use MIDI notes as target
+        bool harmonyEnabled = false;                // Each held MIDI note adds a voice (octave folded
+                                                    // to within an octave of the input)
+        float harmonyLevel = 0.7f;                  // Harmony voice gain (0-1)
         bool forceCorrection = true;
 
         // Scale settings struct for legacy compatibility
@@ -108,10 +129,20 @@ public:
     PitchCorrectionEngine();
     ~PitchCorrectionEngine() = default;
 
-    void prepare (double sampleRate, int samplesPerBlock);
+    /** Allocates everything process() needs for up to maxChannels channels. */
+    void prepare (double sampleRate, int samplesPerBlock, int maxChannels = 2);
     void reset();
 
+    /**
+     * Applies a parameter snapshot. Components are only updated when the
+     * fields they depend on changed, so this is cheap to call every block.
+     */
     void setParameters (const Parameters& newParams);
+
+    /**
+     * Queues the note events for the next process() call, which applies
+     * each one at its sample position.
+     */
     void pushMidi (const juce::MidiBuffer& midiMessages);
 
     void process (juce::AudioBuffer<float>& buffer);
@@ -121,16 +152,115 @@ public:
     [[nodiscard]] float getLastDetectionConfidence() const noexcept { return lastDetectionConfidence; }
     [[nodiscard]] float getLastPitchRatio() const noexcept { return lastPitchRatio; }
 
+    /**
+     * Every analysis hop's result, published from process() for one reader
+     * on another thread (the editor). Never blocks the audio thread.
+     */
+    [[nodiscard]] AnalysisFifo& getAnalysisFifo() noexcept { return analysisFifo; }
+
+    /** Current input-to-output delay; follows the active input type range. */
     [[nodiscard]] int getLatencySamples() const noexcept;
 
+    /**
+     * Detection runs once every hopSize samples regardless of the host block
+     * size; each frame sets the retune target and the smoothed ratio is
+     * rendered per sample in between.
+     * Clamped to [minAnalysisHopSize, maxAnalysisHopSize].
+     */
+    void setAnalysisHopSize (int hopSize);
+    [[nodiscard]] int getAnalysisHopSize() const noexcept { return analysisHopSize; }
+
+    static constexpr int defaultAnalysisHopSize = 128;
+    static constexpr int minAnalysisHopSize = 16;
+    static constexpr int maxAnalysisHopSize = 1024;
+
+    /**
+     * Offline: takes each hop's detection from a whole-file analysis instead
+     * of running the detector. startSample is where this engine's input
+     * starts in the analysed file, on the hop grid. The track must have been
+     * analysed with this hop size and the same detection settings (see
+     * PitchTrackFile::Settings::hasSameDetection), and outlive its use;
+     * nullptr goes back to detecting.
+     */
+    void setPitchTrack (const PitchTrackFile* track, std::int64_t startSample = 0);
+
+    /**
+     * Offline quality: each hop's decision also sees lookaheadSamples of
+     * later analysis (see PitchRefiner). Without a pitch track the audio and
+     * MIDI wait in a delay line while detection runs ahead, which adds to
+     * getLatencySamples(); with one the future is already on disk and nothing
+     * is delayed. Rounded up to whole hops, at most maxLookaheadSeconds; 0 is
+     * the realtime behaviour. Allocates, so call it after prepare() and
+     * setAnalysisHopSize(), never during process().
+     */
+    void setLookahead (int lookaheadSamples);
+    [[nodiscard]] int getLookaheadSamples() const noexcept { return lookaheadHops * analysisHopSize; }
+
+    static constexpr double maxLookaheadSeconds = 1.0;
+
+    /**
+     * How parameters map onto the detector and the scale mapper; shared
+     * with offline analysis so it detects and maps exactly as the engine does.
+     */
+    static void configureDetector (PitchDetector& detector, const Parameters& params);
+    static ScaleMapper::Settings makeScaleSettings (const Parameters& params);
+
 private:
+    // Result of one analysis hop: detection, and whether it set a retune target
+    struct AnalysisFrame
+    {
+        PitchDetector::Result detection;
+        bool corrected = false;
+    };
+
+    // A note event queued by pushMidi() for the next process() call
+    struct MidiEvent
+    {
+        enum class Type
+        {
+            NoteOn,
+            NoteOff,
+            AllNotesOff
+        };
+
+        int samplePosition = 0;
+        Type type = Type::NoteOn;
+        int note = 0;
+    };
+
     void updateComponentSettings();
+    void updateDetectorSettings();
+    void updateShifterSelection();
+    void setShifterHarmonyVoices() noexcept;
+    void updateScaleSettings();
+    void updateRetuneSettings();
+    void updateHarmonyVoices (const PitchDetector::Result& detection);
+    void applyMidiEvent (const MidiEvent& event);
+    int applyMidiEventsUpTo (int samplePosition, int numSamples);
+    void carryMidiEvents (int numSamples);
+    AnalysisFrame analyseHop();
+    PitchDetector::Result refineHop();
+    void pushLookaheadFrame (const PitchDetector::Result& frame) noexcept;
+    int getDelaySamples() const noexcept;
+    void updateTarget (AnalysisFrame& frame);
+    void processBypassDelay (juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void processSegment (juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
 
     // New modular components
     PitchDetector detector;
     ScaleMapper scaleMapper;
     RetuneEngine retuneEngine;
-    std::vector<PsolaShifter> shifters;  // One per channel
+    PsolaShifter psolaShifter;            // Linked across all channels
+    CycleResampler cycleResampler;
+    SpectralPeakShifter spectralShifter;
+    PitchShifter* activeShifter = &psolaShifter;
+
+    // Unlinked Quality mode: one single-channel PSOLA per channel, each
+    // placing pitch marks on its own channel (dual-mono or wide stereo)
+    std::vector<PsolaShifter> channelShifters;
+    bool shiftUnlinked = false;
+    int shifterChannels = 1;
+    std::vector<float*> channelPointers;  // Per-segment channel pointers, sized in prepare()
 
     // Parameters
     Parameters params;
@@ -140,15 +270,60 @@ private:
     // MIDI state
     int heldMidiNote = -1;
 
+    // Timestamped note events for the current block and, with lookahead,
+    // those waiting for their delayed audio (fixed capacity, so queueing
+    // never allocates): a block's worth plus the most a MIDI cable carries,
+    // about a thousand notes a second, over the longest lookahead
+    static constexpr int maxPendingMidiEvents = 256 + static_cast<int> (1000 * maxLookaheadSeconds);
+    std::array<MidiEvent, maxPendingMidiEvents> pendingMidiEvents {};
+    int numPendingMidiEvents = 0;
+    int nextMidiEvent = 0;
+
+    // Harmony voice pool: one slot per held note (-1 = free), the oldest note
+    // is replaced once every slot is taken. Every voice is synthesised by the
+    // active shifter from the same detection and analysis.
+    static constexpr int maxHarmonyVoices = PitchShifter::maxHarmonyVoices;
+    std::array<int, maxHarmonyVoices> harmonyNotes;
+    std::array<std::uint32_t, maxHarmonyVoices> harmonyNoteOrder {};
+    std::uint32_t harmonyNoteCounter = 0;
+    std::array<PitchShifter::HarmonyVoice, maxHarmonyVoices> harmonyVoices {};
+
     // Telemetry
     float lastDetectedFrequency = 0.0f;
     float lastTargetFrequency = 0.0f;
     float lastDetectionConfidence = 0.0f;
     float lastPitchRatio = 1.0f;
+    AnalysisFifo analysisFifo;
+    std::int64_t samplesAnalysed = 0;   // Since prepare(); timestamps the frames
 
-    // Analysis buffer for mono mixdown
+    // Analysis buffer for mono mixdown, one hop at a time; channel 1 holds
+    // the delayed mix the shifter sees while looking ahead
     juce::AudioBuffer<float> monoBuffer;
 
-    // Ensure enough shifters for channels
-    void ensureShifterChannels (int numChannels);
+    // Fixed-hop analysis: frames arrive every analysisHopSize samples and set
+    // the retune target; hopRatios holds the per-sample curve for a segment
+    int analysisHopSize = defaultAnalysisHopSize;
+    int hopPosition = 0;
+    AnalysisFrame currentFrame;
+    std::vector<float> hopRatios;
+
+    // Bypass line: the input delayed by getLatencySamples(), long enough
+    // for the longest latency plus a block
+    juce::AudioBuffer<float> bypassDelay;
+    int bypassWritePosition = 0;
+
+    // Cached analysis standing in for the detector (offline only)
+    const PitchTrackFile* pitchTrack = nullptr;
+    std::int64_t pitchTrackStart = 0;
+
+    // Lookahead (offline only): the last shifterChannels + 1 channels of
+    // audio (mono mix last) wait in lookaheadDelay while detection runs
+    // ahead; lookaheadFrames holds the raw frames around the one being
+    // decided, oldest first
+    PitchRefiner pitchRefiner;
+    int lookaheadHops = 0;
+    juce::AudioBuffer<float> lookaheadDelay;
+    int lookaheadPosition = 0;
+    int lookaheadPriming = 0;           // Samples until the first decision
+    std::vector<PitchDetector::Result> lookaheadFrames;
 };
@@ -1,4 +1,6 @@
 #include "PitchDetector.h"
+#include "PeriodKernels.h"
+#include "WindowTables.h"
 #include <cmath>
 #include <algorithm>
 #include <numeric>
@@ -11,58 +13,37 @@ void PitchDetector::prepare (double sr, [[maybe_unused]] int maxBlockSize)
 {
     sampleRate = sr;
 
-    // Analysis window: 4 periods at minimum frequency
-    int maxPeriod = static_cast<int> (sampleRate / minFreqHz);
-    analysisWindowSize = maxPeriod * 4;
+    // Buffers are sized for the lowest frequency any range can select; the
+    // active analysis window follows the range without reallocating
+    int maxPeriod = static_cast<int> (sampleRate / lowestFrequencyHz);
+    maxAnalysisWindowSize = maxPeriod * 4;
+    updateAnalysisWindow();
 
     // Input buffer: hold enough for analysis
-    inputBuffer.assign (static_cast<size_t> (analysisWindowSize * 2), 0.0f);
+    inputBuffer.assign (static_cast<size_t> (maxAnalysisWindowSize * 2), 0.0f);
     inputWritePos = 0;
 
-    // Downsampled buffer
-    int downsampledSize = analysisWindowSize / downsampleFactor + filterTaps;
-    downsampledBuffer.assign (static_cast<size_t> (downsampledSize), 0.0f);
+    // Downsampled history covers the largest analysis window at the decimated rate
+    downsampledHistorySize = maxAnalysisWindowSize / downsampleFactor;
+    downsampledBuffer.assign (static_cast<size_t> (downsampledHistorySize * 2), 0.0f);
+    decimatorDelay.assign (static_cast<size_t> (filterTaps * 2), 0.0f);
 
-    // Design decimation filter (windowed sinc)
-    decimationFilter.resize (filterTaps);
-    float cutoff = 1.0f / (2.0f * downsampleFactor);
-    int halfTaps = filterTaps / 2;
+    // Decimation filter taps are shared by every instance
+    decimationFilter = WindowTables::getInstance().getDecimationFilter();
 
-    for (int n = 0; n < filterTaps; ++n)
-    {
-        float x = static_cast<float> (n - halfTaps);
-        float window = 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi *
-                                                 static_cast<float> (n) / static_cast<float> (filterTaps - 1));
-        float sinc;
-        if (std::abs (x) < 1e-6f)
-            sinc = 2.0f * cutoff;
-        else
-            sinc = std::sin (juce::MathConstants<float>::twoPi * cutoff * x) /
-                   (juce::MathConstants<float>::pi * x);
-        decimationFilter[static_cast<size_t> (n)] = window * sinc;
-    }
+    // Allocate analysis frame and score buffers
+    analysisFrame.assign (static_cast<size_t> (maxAnalysisWindowSize), 0.0f);
+    // Coarse lags reach the lowest frequency at the downsampled rate
+    int maxCoarseLag = maxPeriod / downsampleFactor;
+    coarseScores.resize (static_cast<size_t> (maxCoarseLag + 1));
+    fineScores.resize (static_cast<size_t> (maxAnalysisWindowSize / 2));
 
-    // Normalize filter
-    float sum = std::accumulate (decimationFilter.begin(), decimationFilter.end(), 0.0f);
-    if (std::abs (sum) > 1e-6f)
-    {
-        for (auto& c : decimationFilter)
-            c /= sum;
-    }
+    // One-pole DC blocker at ~5 Hz so the running sums see a zero-mean signal
+    dcBlockerCoeff = static_cast<float> (1.0 - juce::MathConstants<double>::twoPi * 5.0 / sampleRate);
+    trackingResyncInterval = static_cast<int> (sampleRate);
 
-    // Analysis window (Hanning)
-    analysisWindow.resize (static_cast<size_t> (analysisWindowSize));
-    for (int i = 0; i < analysisWindowSize; ++i)
-    {
-        analysisWindow[static_cast<size_t> (i)] = 0.5f *
-            (1.0f - std::cos (juce::MathConstants<float>::twoPi *
-                               static_cast<float> (i) / static_cast<float> (analysisWindowSize - 1)));
-    }
-
-    // Allocate score buffers
-    int maxCoarseLag = 120;  // Cover down to ~50Hz at downsampled rate
-    coarseScores.resize (static_cast<size_t> (maxCoarseLag));
-    fineScores.resize (static_cast<size_t> (analysisWindowSize / 2));
+    // Resolve the SIMD kernel here: the first CPU feature query allocates
+    PeriodKernels::getActiveKernelName();
 
     reset();
 }
@@ -71,28 +52,94 @@ void PitchDetector::reset()
 {
     std::fill (inputBuffer.begin(), inputBuffer.end(), 0.0f);
     inputWritePos = 0;
+    std::fill (downsampledBuffer.begin(), downsampledBuffer.end(), 0.0f);
+    std::fill (decimatorDelay.begin(), decimatorDelay.end(), 0.0f);
+    downsampledWritePos = 0;
+    decimatorWritePos = 0;
+    decimatorPhase = 0;
     lastPeriod = 0.0f;
     lastConfidence = 0.0f;
     stableFrameCount = 0;
+    dcBlockerLastInput = 0.0f;
+    dcBlockerLastOutput = 0.0f;
+    trackingLocked = false;
+    samplesSinceCheck = 0;
+    samplesSinceResync = 0;
 }
 
 PitchDetector::Result PitchDetector::process (const float* input, int numSamples)
 {
-    Result result;
+    if (input == nullptr || numSamples <= 0)
+        return {};
+
+    pushSamples (input, numSamples);
+    return analyse();
+}
 
+void PitchDetector::pushSamples (const float* input, int numSamples)
+{
     if (input == nullptr || numSamples <= 0)
-        return result;
+        return;
 
-    // Accumulate input into circular buffer
+    // Accumulate input into circular buffer, keeping the tracked sums current
     int bufferSize = static_cast<int> (inputBuffer.size());
     for (int i = 0; i < numSamples; ++i)
     {
-        inputBuffer[static_cast<size_t> (inputWritePos)] = input[i];
+        float x = input[i] - dcBlockerLastInput + dcBlockerCoeff * dcBlockerLastOutput;
+        dcBlockerLastInput = input[i];
+        dcBlockerLastOutput = x;
+
+        inputBuffer[static_cast<size_t> (inputWritePos)] = x;
         inputWritePos = (inputWritePos + 1) % bufferSize;
+        pushDecimator (x);
+
+        if (trackingLocked)
+        {
+            updateTrackedSums();
+            ++samplesSinceResync;
+
+            if (++samplesSinceCheck >= trackingCheckInterval)
+            {
+                samplesSinceCheck = 0;
+                if (! rollTrackedWindow())
+                    trackingLocked = false;
+            }
+        }
     }
+}
+
+PitchDetector::Result PitchDetector::analyse()
+{
+    if (trackingLocked)
+    {
+        // Periodically recompute the sums so rounding error cannot accumulate
+        if (samplesSinceResync >= trackingResyncInterval)
+        {
+            samplesSinceResync = 0;
+            for (int i = 0; i < numTrackedLags; ++i)
+                trackedScores[static_cast<size_t> (i)] = scoreFromHistory (trackedBaseLag + i);
+        }
+
+        auto result = trackPeriod();
+        if (trackingLocked)
+            return result;
+    }
+
+    // Tracking lost (or disabled): full coarse + fine search
+    auto result = searchPeriod();
+
+    if (trackingModeEnabled && result.voiced)
+        seedTracking (result.period);
+
+    return result;
+}
+
+PitchDetector::Result PitchDetector::searchPeriod()
+{
+    Result result;
 
     // Extract analysis frame (WITHOUT windowing - important for periodicity detection)
-    std::vector<float> analysisFrame (static_cast<size_t> (analysisWindowSize));
+    int bufferSize = static_cast<int> (inputBuffer.size());
     for (int i = 0; i < analysisWindowSize; ++i)
     {
         int idx = ((inputWritePos - analysisWindowSize + i) % bufferSize + bufferSize) % bufferSize;
@@ -100,17 +147,17 @@ PitchDetector::Result PitchDetector::process (const float* input, int numSamples
     }
 
     // Remove DC offset
-    float mean = std::accumulate (analysisFrame.begin(), analysisFrame.end(), 0.0f) /
+    auto frameEnd = analysisFrame.begin() + analysisWindowSize;
+    float mean = std::accumulate (analysisFrame.begin(), frameEnd, 0.0f) /
                  static_cast<float> (analysisWindowSize);
-    for (auto& s : analysisFrame)
-        s -= mean;
-
-    // Downsample for coarse search
-    downsample (analysisFrame.data(), analysisWindowSize);
+    for (auto it = analysisFrame.begin(); it != frameEnd; ++it)
+        *it -= mean;
 
-    // Coarse search in downsampled domain
-    int downsampledSize = analysisWindowSize / downsampleFactor;
-    int coarseLag = coarseSearch (downsampledBuffer.data(), downsampledSize);
+    // Coarse search over the newest window of the streamed downsampled
+    // history (the DC blocker already keeps it zero-mean)
+    int downsampledWindowSize = analysisWindowSize / downsampleFactor;
+    int coarseLag = coarseSearch (downsampledBuffer.data() + downsampledWritePos + downsampledHistorySize - downsampledWindowSize,
+                                  downsampledWindowSize);
 
     if (coarseLag <= 0)
         return result;  // No pitch detected
@@ -119,9 +166,22 @@ PitchDetector::Result PitchDetector::process (const float* input, int numSamples
     int fullRateLag = coarseLag * downsampleFactor;
     float refinedPeriod = fineSearch (analysisFrame.data(), analysisWindowSize, fullRateLag);
 
+    // Only the lenient coarse test may accept half the period (a strong
+    // second harmonic); fall back to the coarse winner before giving up
+    if (refinedPeriod <= 0.0f && coarseBestLag != coarseLag)
+        refinedPeriod = fineSearch (analysisFrame.data(), analysisWindowSize, coarseBestLag * downsampleFactor);
+
     if (refinedPeriod <= 0.0f)
         return result;
 
+    int periodInt = static_cast<int> (refinedPeriod + 0.5f);
+    return makeResult (refinedPeriod, evaluatePeriod (analysisFrame.data(), analysisWindowSize, periodInt));
+}
+
+PitchDetector::Result PitchDetector::makeResult (float refinedPeriod, const PeriodScore& score)
+{
+    Result result;
+
     // Convert to frequency
     float frequency = static_cast<float> (sampleRate) / refinedPeriod;
 
@@ -130,9 +190,6 @@ PitchDetector::Result PitchDetector::process (const float* input, int numSamples
         return result;
 
     // Calculate confidence
-    int periodInt = static_cast<int> (refinedPeriod + 0.5f);
-    PeriodScore score = evaluatePeriod (analysisFrame.data(), analysisWindowSize, periodInt);
-
     if (score.E < 1e-9)
         return result;
 
@@ -191,11 +248,26 @@ void PitchDetector::setInputType (InputType type)
 
 void PitchDetector::setFrequencyRange (float minHz, float maxHz)
 {
-    minFreqHz = juce::jmax (20.0f, minHz);
-    maxFreqHz = juce::jmin (2000.0f, maxHz);
+    float newMin = juce::jmax (lowestFrequencyHz, minHz);
+    float newMax = juce::jmin (2000.0f, maxHz);
 
-    if (minFreqHz > maxFreqHz)
-        std::swap (minFreqHz, maxFreqHz);
+    if (newMin > newMax)
+        std::swap (newMin, newMax);
+
+    // The tracked lags may now fall outside the range, so re-acquire
+    if (newMin != minFreqHz || newMax != maxFreqHz)
+        trackingLocked = false;
+
+    minFreqHz = newMin;
+    maxFreqHz = newMax;
+    updateAnalysisWindow();
+}
+
+void PitchDetector::updateAnalysisWindow() noexcept
+{
+    // Analysis window: 4 periods at minimum frequency, within what prepare() allocated
+    int maxPeriod = static_cast<int> (sampleRate / minFreqHz);
+    analysisWindowSize = juce::jmin (maxPeriod * 4, maxAnalysisWindowSize);
 }
 
 void PitchDetector::setTracking (float tracking)
@@ -204,6 +276,14 @@ void PitchDetector::setTracking (float tracking)
     epsilon = juce::jmap (tracking, 0.0f, 1.0f, 0.08f, 0.35f);
 }
 
+void PitchDetector::setTrackingModeEnabled (bool shouldTrack)
+{
+    trackingModeEnabled = shouldTrack;
+
+    if (! shouldTrack)
+        trackingLocked = false;
+}
+
 PitchDetector::PeriodScore PitchDetector::evaluatePeriod (const float* data, int dataSize, int lag)
 {
     PeriodScore score;
@@ -211,26 +291,14 @@ PitchDetector::PeriodScore PitchDetector::evaluatePeriod (const float* data, int
     if (lag <= 0 || lag * 2 >= dataSize)
         return score;
 
-    // Patent's approach: evaluate over 2 periods ending at current position
-    int windowEnd = dataSize;
-    int windowStart = juce::jmax (0, windowEnd - lag * 2);
+    // Patent's approach: evaluate over 2 periods ending at current position,
+    // correlating the newest period with the one before it
+    const float* current = data + dataSize - lag;
+    auto sums = PeriodKernels::scoreSpans (current - lag, current, lag);
 
-    double energy = 0.0;
-    double correlation = 0.0;
-
-    for (int n = windowStart; n < windowEnd; ++n)
-    {
-        double current = static_cast<double> (data[n]);
-        energy += current * current;
-
-        int prevIndex = n - lag;
-        if (prevIndex >= windowStart)
-            correlation += current * static_cast<double> (data[prevIndex]);
-    }
-
-    score.E = energy;
-    score.H = correlation;
-    score.V = energy - 2.0 * correlation;
+    score.E = sums.previousEnergy + sums.currentEnergy;
+    score.H = sums.correlation;
+    score.V = score.E - 2.0 * score.H;
 
     return score;
 }
@@ -240,16 +308,19 @@ float PitchDetector::refineWithQuadratic (int bestLag, const std::vector<PeriodS
     if (bestLag <= 0 || bestLag >= static_cast<int> (scores.size()) - 1)
         return static_cast<float> (bestLag);
 
-    double v1 = scores[static_cast<size_t> (bestLag - 1)].V;
-    double v2 = scores[static_cast<size_t> (bestLag)].V;
-    double v3 = scores[static_cast<size_t> (bestLag + 1)].V;
+    double offset = quadraticOffset (scores[static_cast<size_t> (bestLag - 1)].V,
+                                     scores[static_cast<size_t> (bestLag)].V,
+                                     scores[static_cast<size_t> (bestLag + 1)].V);
+    return static_cast<float> (bestLag) + static_cast<float> (offset);
+}
 
+double PitchDetector::quadraticOffset (double v1, double v2, double v3)
+{
     double denom = v1 - 2.0 * v2 + v3;
     if (std::abs (denom) < 1e-9)
-        return static_cast<float> (bestLag);
+        return 0.0;
 
-    double offset = 0.5 * (v1 - v3) / denom;
-    return static_cast<float> (bestLag) + static_cast<float> (offset);
+    return 0.5 * (v1 - v3) / denom;
 }
 
 int PitchDetector::coarseSearch (const float* downsampledData, int downsampledSize)
@@ -257,7 +328,7 @@ int PitchDetector::coarseSearch (const float* downsampledData, int downsampledSi
     // Determine lag range for coarse search
     double downsampledRate = sampleRate / downsampleFactor;
     int minLag = juce::jmax (2, static_cast<int> (downsampledRate / maxFreqHz));
-    int maxLag = juce::jmin (110, static_cast<int> (downsampledRate / minFreqHz));
+    int maxLag = juce::jmin (static_cast<int> (coarseScores.size()) - 1, static_cast<int> (downsampledRate / minFreqHz));
 
     if (maxLag <= minLag || maxLag >= downsampledSize / 2)
         return -1;
@@ -290,6 +361,8 @@ int PitchDetector::coarseSearch (const float* downsampledData, int downsampledSi
     if (bestLag <= 0 || bestRatio > 0.5)  // 0.5 is more lenient for coarse pass
         return -1;
 
+    coarseBestLag = bestLag;
+
     // Check for octave errors: prefer shorter periods (higher frequencies)
     // If half the period also passes the test, use the shorter period
     if (bestLag > 0)
@@ -356,23 +429,247 @@ float PitchDetector::fineSearch (const float* data, int dataSize, int coarseLag)
     return refineWithQuadratic (bestLag, fineScores);
 }
 
-void PitchDetector::downsample (const float* input, int inputSize)
+void PitchDetector::pushDecimator (float sample) noexcept
 {
-    int outputSize = inputSize / downsampleFactor;
+    decimatorDelay[static_cast<size_t> (decimatorWritePos)] = sample;
+    decimatorDelay[static_cast<size_t> (decimatorWritePos + filterTaps)] = sample;
+    decimatorWritePos = (decimatorWritePos + 1) % filterTaps;
 
-    // Apply filter and decimate
-    for (int n = 0; n < outputSize; ++n)
+    // Only every downsampleFactor-th output survives decimation, so only that
+    // phase is ever filtered
+    if (++decimatorPhase < downsampleFactor)
+        return;
+
+    decimatorPhase = 0;
+
+    // The newest filterTaps inputs are contiguous, oldest first; the
+    // windowed-sinc taps are symmetric so no reversal is needed
+    const float* taps = decimatorDelay.data() + decimatorWritePos;
+    float acc = 0.0f;
+
+    for (int k = 0; k < filterTaps; ++k)
+        acc += taps[k] * decimationFilter[k];
+
+    downsampledBuffer[static_cast<size_t> (downsampledWritePos)] = acc;
+    downsampledBuffer[static_cast<size_t> (downsampledWritePos + downsampledHistorySize)] = acc;
+    downsampledWritePos = (downsampledWritePos + 1) % downsampledHistorySize;
+}
+
+//==============================================================================
+// Tracking mode
+//
+// E(L) covers the newest 2L samples and H(L) correlates the newest L samples with
+// the L before them, exactly as evaluatePeriod does on a frame ending at the
+// write position. Each new sample x[t] therefore updates them as:
+//   E(L) += x[t]^2 - x[t-2L]^2
+//   H(L) += x[t]x[t-L] - x[t-L]x[t-2L]
+//==============================================================================
+
+void PitchDetector::getLagRange (int& minLag, int& maxLag) const
+{
+    minLag = juce::jmax (2, static_cast<int> (sampleRate / maxFreqHz));
+    maxLag = juce::jmin (analysisWindowSize / 2 - 1, static_cast<int> (sampleRate / minFreqHz));
+}
+
+PitchDetector::PeriodScore PitchDetector::scoreFromHistory (int lag) const
+{
+    PeriodScore score;
+
+    int bufferSize = static_cast<int> (inputBuffer.size());
+    if (lag <= 0 || lag * 2 >= bufferSize)
+        return score;
+
+    int idx = (inputWritePos - lag * 2 + bufferSize) % bufferSize;
+    int prevIdx = (idx - lag + bufferSize) % bufferSize;
+
+    double energy = 0.0;
+    double correlation = 0.0;
+
+    for (int n = 0; n < lag * 2; ++n)
+    {
+        double current = static_cast<double> (inputBuffer[static_cast<size_t> (idx)]);
+        energy += current * current;
+
+        if (n >= lag)
+            correlation += current * static_cast<double> (inputBuffer[static_cast<size_t> (prevIdx)]);
+
+        if (++idx == bufferSize)
+            idx = 0;
+        if (++prevIdx == bufferSize)
+            prevIdx = 0;
+    }
+
+    score.E = energy;
+    score.H = correlation;
+    score.V = energy - 2.0 * correlation;
+
+    return score;
+}
+
+void PitchDetector::updateTrackedSums()
+{
+    int bufferSize = static_cast<int> (inputBuffer.size());
+    int newest = inputWritePos - 1;
+    if (newest < 0)
+        newest += bufferSize;
+
+    double x0 = static_cast<double> (inputBuffer[static_cast<size_t> (newest)]);
+
+    for (int i = 0; i < numTrackedLags; ++i)
+    {
+        int lag = trackedBaseLag + i;
+
+        int idx1 = newest - lag;
+        if (idx1 < 0)
+            idx1 += bufferSize;
+        int idx2 = idx1 - lag;
+        if (idx2 < 0)
+            idx2 += bufferSize;
+
+        double x1 = static_cast<double> (inputBuffer[static_cast<size_t> (idx1)]);
+        double x2 = static_cast<double> (inputBuffer[static_cast<size_t> (idx2)]);
+
+        auto& score = trackedScores[static_cast<size_t> (i)];
+        score.E += x0 * x0 - x2 * x2;
+        score.H += x0 * x1 - x1 * x2;
+    }
+}
+
+void PitchDetector::seedTracking (float period)
+{
+    int minLag, maxLag;
+    getLagRange (minLag, maxLag);
+
+    if (maxLag - minLag + 1 < numTrackedLags)
+    {
+        trackingLocked = false;
+        return;
+    }
+
+    int centre = static_cast<int> (period + 0.5f);
+    trackedBaseLag = juce::jlimit (minLag, maxLag - numTrackedLags + 1, centre - numTrackedLags / 2);
+
+    for (int i = 0; i < numTrackedLags; ++i)
+        trackedScores[static_cast<size_t> (i)] = scoreFromHistory (trackedBaseLag + i);
+
+    trackingLocked = true;
+    samplesSinceCheck = 0;
+    samplesSinceResync = 0;
+}
+
+int PitchDetector::findBestTrackedIndex (double& bestRatio) const
+{
+    int bestIndex = -1;
+    bestRatio = 1.0;
+
+    for (int i = 0; i < numTrackedLags; ++i)
+    {
+        const auto& score = trackedScores[static_cast<size_t> (i)];
+        if (score.E < 1e-9)
+            continue;
+
+        double ratio = (score.E - 2.0 * score.H) / score.E;
+        if (ratio < bestRatio)
+        {
+            bestRatio = ratio;
+            bestIndex = i;
+        }
+    }
+
+    return bestIndex;
+}
+
+bool PitchDetector::rollTrackedWindow()
+{
+    int minLag, maxLag;
+    getLagRange (minLag, maxLag);
+
+    for (int roll = 0; roll < maxWindowRolls; ++roll)
     {
-        int inputIdx = n * downsampleFactor;
-        double acc = 0.0;
+        double bestRatio;
+        int bestIndex = findBestTrackedIndex (bestRatio);
+
+        if (bestIndex < 0)
+            return false;
+
+        // Minimum is inside the window: nothing to do
+        if (bestIndex > 0 && bestIndex < numTrackedLags - 1)
+            return true;
 
-        for (int k = 0; k < filterTaps; ++k)
+        // Minimum sits on the edge: recentre the window around it
+        int newBase = juce::jlimit (minLag, maxLag - numTrackedLags + 1,
+                                    trackedBaseLag + bestIndex - numTrackedLags / 2);
+        int shift = newBase - trackedBaseLag;
+
+        // Pinned against the range limit - the edge really is the minimum
+        if (shift == 0)
+            return true;
+
+        std::array<PeriodScore, numTrackedLags> rolled;
+        for (int i = 0; i < numTrackedLags; ++i)
         {
-            int sampleIdx = inputIdx - filterTaps / 2 + k;
-            float sample = (sampleIdx >= 0 && sampleIdx < inputSize) ? input[sampleIdx] : 0.0f;
-            acc += sample * static_cast<double> (decimationFilter[static_cast<size_t> (k)]);
+            int oldIndex = i + shift;
+            rolled[static_cast<size_t> (i)] = (oldIndex >= 0 && oldIndex < numTrackedLags)
+                ? trackedScores[static_cast<size_t> (oldIndex)]
+                : scoreFromHistory (newBase + i);
         }
 
-        downsampledBuffer[static_cast<size_t> (n)] = static_cast<float> (acc);
+        trackedScores = rolled;
+        trackedBaseLag = newBase;
     }
+
+    return false;
+}
+
+PitchDetector::Result PitchDetector::trackPeriod()
+{
+    if (! rollTrackedWindow())
+    {
+        trackingLocked = false;
+        return {};
+    }
+
+    double bestRatio;
+    int bestIndex = findBestTrackedIndex (bestRatio);
+
+    if (bestIndex <= 0 || bestIndex >= numTrackedLags - 1 || bestRatio > epsilon)
+    {
+        trackingLocked = false;
+        return {};
+    }
+
+    for (auto& score : trackedScores)
+        score.V = score.E - 2.0 * score.H;
+
+    double offset = quadraticOffset (trackedScores[static_cast<size_t> (bestIndex - 1)].V,
+                                     trackedScores[static_cast<size_t> (bestIndex)].V,
+                                     trackedScores[static_cast<size_t> (bestIndex + 1)].V);
+    float refinedPeriod = static_cast<float> (trackedBaseLag + bestIndex) + static_cast<float> (offset);
+
+    // Octave-up check: if half the period is also periodic, the pitch jumped up
+    int minLag, maxLag;
+    getLagRange (minLag, maxLag);
+    int halfLag = static_cast<int> (refinedPeriod * 0.5f + 0.5f);
+
+    if (halfLag >= minLag)
+    {
+        for (int lag = halfLag - 1; lag <= halfLag + 1; ++lag)
+        {
+            auto halfScore = scoreFromHistory (lag);
+            if (halfScore.E > 1e-9 && halfScore.V / halfScore.E <= epsilon)
+            {
+                trackingLocked = false;
+                return {};
+            }
+        }
+    }
+
+    int periodIndex = juce::jlimit (0, numTrackedLags - 1,
+                                    static_cast<int> (refinedPeriod + 0.5f) - trackedBaseLag);
+    auto result = makeResult (refinedPeriod, trackedScores[static_cast<size_t> (periodIndex)]);
+
+    if (! result.voiced)
+        trackingLocked = false;
+
+    return result;
 }
@@ -5,6 +5,8 @@
 #include <vector>
 #include <array>
 
+#include "WindowTables.h"
+
 /**
  * Cycle-Based Pitch Detector
  *
@@ -12,10 +14,13 @@
  * Uses autocorrelation-derived decision statistics for fast, accurate pitch detection.
  *
  * Algorithm:
- * 1. Coarse search: Downsample by 8, evaluate V(L) = E(L) - 2H(L) for L=2..110
- * 2. Fine search: Track N=8 candidates at full rate around coarse estimate
- * 3. Quadratic interpolation for sub-sample precision
- * 4. Voicing decision based on periodicity threshold
+ * 1. Coarse search: Downsample by 8, evaluate V(L) = E(L) - 2H(L) over the lags of the
+ *    selected frequency range
+ * 2. Fine search: Evaluate full-rate lags around the coarse estimate
+ * 3. Tracking mode: Keep running E/H sums for N=8 lags around the locked period,
+ *    updated per incoming sample; fall back to 1-2 only when tracking is lost
+ * 4. Quadratic interpolation for sub-sample precision
+ * 5. Voicing decision based on periodicity threshold
  *
  * Key equations from patent:
  *   E(L) = sum of squared samples over 2 periods
@@ -59,10 +64,23 @@ public:
      */
     Result process (const float* input, int numSamples);
 
+    /**
+     * Streaming split of process(): pushSamples() feeds the history (and the
+     * tracked sums) without searching, analyse() returns a result for
+     * everything pushed so far. Lets the caller run detection on its own hop
+     * independent of the host block size.
+     */
+    void pushSamples (const float* input, int numSamples);
+    Result analyse();
+
     // Configuration
     void setInputType (InputType type);
     void setFrequencyRange (float minHz, float maxHz);
     void setTracking (float tracking);  // 0-1: 0 = strict, 1 = relaxed
+    void setTrackingModeEnabled (bool shouldTrack);
+
+    bool isTrackingModeEnabled() const noexcept { return trackingModeEnabled; }
+    bool isTrackingLocked() const noexcept { return trackingLocked; }
 
     InputType getInputType() const noexcept { return inputType; }
     float getMinFrequency() const noexcept { return minFreqHz; }
@@ -79,6 +97,13 @@ private:
 
     PeriodScore evaluatePeriod (const float* data, int dataSize, int lag);
     float refineWithQuadratic (int bestLag, const std::vector<PeriodScore>& scores);
+    static double quadraticOffset (double v1, double v2, double v3);
+
+    // Shared tail of both search paths: range check, confidence and hysteresis
+    Result makeResult (float refinedPeriod, const PeriodScore& score);
+
+    // Full coarse + fine search over the latest analysis frame
+    Result searchPeriod();
 
     // Coarse search with downsampling
     int coarseSearch (const float* downsampledData, int downsampledSize);
@@ -86,26 +111,63 @@ private:
     // Fine search around coarse estimate
     float fineSearch (const float* data, int dataSize, int coarseLag);
 
-    // Downsampling
-    void downsample (const float* input, int inputSize);
+    // Streaming decimate-by-8: filters each new sample into the delay line and
+    // emits one downsampled value every downsampleFactor inputs
+    void pushDecimator (float sample) noexcept;
+
+    // Resizes the active analysis window to the current range (no allocation)
+    void updateAnalysisWindow() noexcept;
+
+    // Tracking mode (patent section 3.2)
+    void getLagRange (int& minLag, int& maxLag) const;
+    PeriodScore scoreFromHistory (int lag) const;
+    void updateTrackedSums();
+    void seedTracking (float period);
+    int findBestTrackedIndex (double& bestRatio) const;
+    bool rollTrackedWindow();
+    Result trackPeriod();
 
     // Input buffer (circular)
     std::vector<float> inputBuffer;
     int inputWritePos = 0;
 
-    // Downsampled buffer for coarse search
+    // Downsampled history for coarse search. Each value is written twice, one
+    // history length apart, so the newest values are always contiguous from
+    // downsampledWritePos
     std::vector<float> downsampledBuffer;
-    static constexpr int downsampleFactor = 8;
-
-    // Decimation filter coefficients
-    std::vector<float> decimationFilter;
-    static constexpr int filterTaps = 33;
+    int downsampledHistorySize = 0;
+    int downsampledWritePos = 0;
+    static constexpr int downsampleFactor = WindowTables::decimationFactor;
+
+    // Decimation filter (shared table) and mirrored delay line (same layout)
+    const float* decimationFilter = nullptr;
+    std::vector<float> decimatorDelay;
+    int decimatorWritePos = 0;
+    int decimatorPhase = 0;
+    static constexpr int filterTaps = WindowTables::decimationTaps;
+
+    // DC blocker applied before samples enter the history
+    float dcBlockerCoeff = 0.9995f;
+    float dcBlockerLastInput = 0.0f;
+    float dcBlockerLastOutput = 0.0f;
 
     // Tracking state
     float lastPeriod = 0.0f;
     float lastConfidence = 0.0f;
     int stableFrameCount = 0;
 
+    // Tracking mode: running E(L)/H(L) for numTrackedLags consecutive lags
+    static constexpr int numTrackedLags = 8;
+    static constexpr int trackingCheckInterval = 32;   // Samples between window checks
+    static constexpr int maxWindowRolls = 4;           // Rolls per check before giving up
+    std::array<PeriodScore, numTrackedLags> trackedScores;
+    int trackedBaseLag = 0;                             // Lag held in trackedScores[0]
+    bool trackingModeEnabled = true;
+    bool trackingLocked = false;
+    int samplesSinceCheck = 0;
+    int samplesSinceResync = 0;
+    int trackingResyncInterval = 44100;                 // Recompute sums to bound drift
+
     // Configuration
     double sampleRate = 44100.0;
     InputType inputType = InputType::AltoTenor;
@@ -113,11 +175,14 @@ private:
     float maxFreqHz = 800.0f;
     float epsilon = 0.15f;  // Tracking parameter (lower = stricter)
 
-    // Analysis window
+    // Analysis window: active size follows minFreqHz, buffers hold the largest
+    static constexpr float lowestFrequencyHz = 20.0f;
     int analysisWindowSize = 0;
-    std::vector<float> analysisWindow;
+    int maxAnalysisWindowSize = 0;
 
-    // Scratch buffers
+    // Scratch buffers (sized in prepare so process() never allocates)
+    std::vector<float> analysisFrame;
     std::vector<PeriodScore> coarseScores;
+    int coarseBestLag = -1;             // Coarse winner before the octave check
     std::vector<PeriodScore> fineScores;
 };
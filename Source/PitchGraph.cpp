@@ -0,0 +1,172 @@
+#include "PitchGraph.h"
+#include <cmath>
+
+namespace
+{
+// One pixel wide span from the previous column's y to this one's, so the
+// trace stays connected through fast glides
+void drawTrace (juce::Graphics& g, int x, float previousY, float y, float thickness)
+{
+    if (y < 0.0f)
+        return;
+
+    float top = previousY >= 0.0f ? juce::jmin (previousY, y) : y;
+    float bottom = previousY >= 0.0f ? juce::jmax (previousY, y) : y;
+    g.fillRect (juce::Rectangle<float> (static_cast<float> (x), top - thickness * 0.5f, 1.0f, bottom - top + thickness));
+}
+}
+
+PitchGraph::PitchGraph()
+{
+    setOpaque (true);
+}
+
+void PitchGraph::resized()
+{
+    allocateHistory();
+}
+
+void PitchGraph::allocateHistory()
+{
+    // Physical pixels, so the trace stays sharp on high-density displays
+    history = juce::Image (juce::Image::RGB,
+                           juce::jmax (1, juce::roundToInt (static_cast<float> (getWidth()) * historyScale)),
+                           juce::jmax (1, juce::roundToInt (static_cast<float> (getHeight()) * historyScale)),
+                           false);
+    completedColumns.assign (static_cast<size_t> (history.getWidth()), {});
+    clearHistory();
+}
+
+void PitchGraph::clearHistory()
+{
+    juce::Graphics g (history);
+    drawColumnBackground (g, 0, history.getWidth());
+
+    currentColumn = -1;
+    pendingColumn = {};
+    numCompletedColumns = 0;
+    previousDetectedY = -1.0f;
+    previousTargetY = -1.0f;
+}
+
+void PitchGraph::pushFrames (const AnalysisFifo::Frame* frames, int numFrames, double sampleRate)
+{
+    if (history.isNull() || numFrames <= 0)
+        return;
+
+    int width = history.getWidth();
+    samplesPerColumn = (sampleRate > 0.0 ? sampleRate : 44100.0) * secondsVisible / width;
+
+    auto completeColumn = [this, width] (const Column& column)
+    {
+        completedColumns[static_cast<size_t> (numCompletedColumns % width)] = column;
+        ++numCompletedColumns;
+    };
+
+    for (int i = 0; i < numFrames; ++i)
+    {
+        const auto& frame = frames[i];
+
+        // Positions restart when the engine is prepared again
+        if (frame.samplePosition <= lastSamplePosition)
+            clearHistory();
+        lastSamplePosition = frame.samplePosition;
+
+        auto column = static_cast<std::int64_t> (static_cast<double> (frame.samplePosition) / samplesPerColumn);
+        if (currentColumn < 0)
+            currentColumn = column;
+
+        // Moving on completes the current column, and leaves any skipped
+        // ones (dropped frames, bypass) empty
+        if (column > currentColumn)
+        {
+            completeColumn (pendingColumn);
+
+            auto numEmpty = juce::jmin (column - currentColumn - 1, static_cast<std::int64_t> (width));
+            for (std::int64_t c = 0; c < numEmpty; ++c)
+                completeColumn ({});
+
+            currentColumn = column;
+        }
+
+        pendingColumn.frame = frame;
+        pendingColumn.hasFrame = true;
+    }
+
+    if (numCompletedColumns > 0)
+    {
+        scrollAndDraw();
+        repaint();
+    }
+}
+
+void PitchGraph::scrollAndDraw()
+{
+    int width = history.getWidth();
+    int height = history.getHeight();
+    int numNew = juce::jmin (numCompletedColumns, width);
+
+    if (numNew < width)
+        history.moveImageSection (0, 0, numNew, 0, width - numNew, height);
+
+    juce::Graphics g (history);
+    int x = width - numNew;
+    drawColumnBackground (g, x, numNew);
+
+    for (int i = numCompletedColumns - numNew; i < numCompletedColumns; ++i)
+    {
+        const auto& column = completedColumns[static_cast<size_t> (i % width)];
+        const auto& frame = column.frame;
+        float detectedY = column.hasFrame && frame.detectedFrequency > 0.0f ? frequencyToY (frame.detectedFrequency) : -1.0f;
+        float targetY = column.hasFrame && frame.targetFrequency > 0.0f ? frequencyToY (frame.targetFrequency) : -1.0f;
+
+        // Target underneath, detected on top
+        g.setColour (targetColor);
+        drawTrace (g, x, previousTargetY, targetY, 2.0f * historyScale);
+        g.setColour (detectedColor);
+        drawTrace (g, x, previousDetectedY, detectedY, historyScale);
+
+        previousDetectedY = detectedY;
+        previousTargetY = targetY;
+        ++x;
+    }
+
+    numCompletedColumns = 0;
+}
+
+void PitchGraph::drawColumnBackground (juce::Graphics& g, int x, int numColumns) const
+{
+    g.setColour (backgroundColor);
+    g.fillRect (x, 0, numColumns, history.getHeight());
+
+    // A line at every C
+    g.setColour (gridColor);
+    for (float note = lowestNote; note <= highestNote; note += 12.0f)
+        g.fillRect (x, juce::roundToInt (noteToY (note)), numColumns, juce::jmax (1, juce::roundToInt (historyScale)));
+}
+
+float PitchGraph::frequencyToY (float frequency) const noexcept
+{
+    return noteToY (69.0f + 12.0f * std::log2 (frequency / 440.0f));
+}
+
+float PitchGraph::noteToY (float note) const noexcept
+{
+    float proportion = (note - lowestNote) / (highestNote - lowestNote);
+    float y = (1.0f - proportion) * static_cast<float> (history.getHeight() - 1);
+    return juce::jlimit (0.0f, static_cast<float> (history.getHeight() - 1), y);
+}
+
+void PitchGraph::paint (juce::Graphics& g)
+{
+    // The history is kept at the display's scale, like the editor's cached
+    // background; a new scale starts it afresh
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (scale != historyScale)
+    {
+        historyScale = scale;
+        allocateHistory();
+    }
+
+    g.drawImageTransformed (history, juce::AffineTransform::scale (1.0f / historyScale));
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+#include <vector>
+
+#include "AnalysisFifo.h"
+
+/**
+ * Scrolling Pitch Graph
+ *
+ * Detected (white) and target (accent) pitch over the last few seconds, on a
+ * log-frequency axis with a line at every C.
+ *
+ * The history lives in an image that is only ever added to: each batch of
+ * analysis frames completes some number of columns (one column per fixed
+ * span of samples, so the speed follows time rather than the timer), the
+ * image is shifted left by that many pixels and only the new columns are
+ * drawn. The image is in physical pixels (one column per pixel), so
+ * paint() is a single blit scaled down to the component.
+ */
+class PitchGraph : public juce::Component
+{
+public:
+    PitchGraph();
+
+    /** Adds frames in order (GUI thread); repaints only if a column completed. */
+    void pushFrames (const AnalysisFifo::Frame* frames, int numFrames, double sampleRate);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    // A completed column: the newest frame that fell into it, if any
+    struct Column
+    {
+        AnalysisFifo::Frame frame;
+        bool hasFrame = false;
+    };
+
+    void allocateHistory();
+    void clearHistory();
+    void scrollAndDraw();
+    void drawColumnBackground (juce::Graphics& g, int x, int numColumns) const;
+    float frequencyToY (float frequency) const noexcept;
+    float noteToY (float note) const noexcept;
+
+    juce::Image history;
+    float historyScale = 1.0f;          // Physical pixels per logical pixel
+
+    // Column being filled, and the columns completed since the last scroll:
+    // a ring with one slot per pixel column, so after more than a full
+    // width only the newest are kept
+    double samplesPerColumn = 0.0;
+    std::int64_t currentColumn = -1;
+    Column pendingColumn;
+    std::vector<Column> completedColumns;
+    int numCompletedColumns = 0;
+    std::int64_t lastSamplePosition = -1;
+
+    // Where the previous column's lines ended (-1 = unvoiced), for continuity
+    float previousDetectedY = -1.0f;
+    float previousTargetY = -1.0f;
+
+    // Colors
+    juce::Colour backgroundColor { 25, 30, 40 };
+    juce::Colour gridColor { 45, 52, 65 };
+    juce::Colour detectedColor { juce::Colours::white.withAlpha (0.85f) };
+    juce::Colour targetColor { 0, 180, 255 };
+
+    // Constants
+    static constexpr double secondsVisible = 5.0;
+    static constexpr float lowestNote = 36.0f;      // C2
+    static constexpr float highestNote = 84.0f;     // C6
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchGraph)
+};
@@ -0,0 +1,144 @@
+#include "PitchRefiner.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Notes within this of each other are the same note (vibrato included)
+constexpr float sameNoteSemitones = 1.0f;
+}
+
+void PitchRefiner::prepare (double newSampleRate, int hopSize, int newContextHops)
+{
+    sampleRate = newSampleRate;
+    contextHops = juce::jmax (0, newContextHops);
+
+    auto toHops = [this, hopSize] (double seconds)
+    {
+        return juce::jmax (1, static_cast<int> (std::round (seconds * sampleRate / hopSize)));
+    };
+
+    maxOctaveErrorHops = toHops (maxOctaveErrorSeconds);
+    maxGapHops = toHops (maxGapSeconds);
+    maxOnsetHops = toHops (maxOnsetSeconds);
+
+    voicedNotes.assign (static_cast<size_t> (getWindowSize()), 0.0f);
+}
+
+float PitchRefiner::frequencyToNote (float frequency) noexcept
+{
+    return 69.0f + 12.0f * std::log2 (frequency / 440.0f);
+}
+
+PitchDetector::Result PitchRefiner::refine (const PitchDetector::Result* window) noexcept
+{
+    int size = getWindowSize();
+    int centre = contextHops;
+
+    // Median note of the voiced frames, the reference for octave errors
+    int numVoiced = 0;
+    for (int i = 0; i < size; ++i)
+        if (window[i].voiced && window[i].frequency > 0.0f)
+            voicedNotes[static_cast<size_t> (numVoiced++)] = frequencyToNote (window[i].frequency);
+
+    float median = 0.0f;
+    if (numVoiced > 0)
+    {
+        auto middle = voicedNotes.begin() + numVoiced / 2;
+        std::nth_element (voicedNotes.begin(), middle, voicedNotes.begin() + numVoiced);
+        median = *middle;
+    }
+
+    if (window[centre].voiced && window[centre].frequency > 0.0f)
+        return fixOctave (window, centre, median);
+
+    // Unvoiced: the nearest voiced frames either side
+    int before = -1;
+    for (int i = centre - 1; i >= 0 && centre - i <= maxGapHops; --i)
+    {
+        if (window[i].voiced && window[i].frequency > 0.0f)
+        {
+            before = i;
+            break;
+        }
+    }
+
+    int after = -1;
+    for (int i = centre + 1; i < size && i - centre <= juce::jmax (maxGapHops, maxOnsetHops); ++i)
+    {
+        if (window[i].voiced && window[i].frequency > 0.0f)
+        {
+            after = i;
+            break;
+        }
+    }
+
+    if (after < 0)
+        return window[centre];
+
+    auto next = fixOctave (window, after, median);
+
+    // A dropout inside a note: glide across it in log frequency
+    if (before >= 0 && after - before - 1 <= maxGapHops)
+    {
+        auto previous = fixOctave (window, before, median);
+        if (std::abs (frequencyToNote (next.frequency) - frequencyToNote (previous.frequency)) <= sameNoteSemitones)
+        {
+            auto position = static_cast<float> (centre - before) / static_cast<float> (after - before);
+            PitchDetector::Result bridged;
+            bridged.frequency = previous.frequency * std::pow (next.frequency / previous.frequency, position);
+            bridged.period = static_cast<float> (sampleRate) / bridged.frequency;
+            bridged.confidence = juce::jmin (previous.confidence, next.confidence);
+            bridged.voiced = true;
+            return bridged;
+        }
+    }
+
+    // Just before a note: start it now
+    if (after - centre <= maxOnsetHops && isSustained (window, after))
+        return next;
+
+    return window[centre];
+}
+
+PitchDetector::Result PitchRefiner::fixOctave (const PitchDetector::Result* window, int index, float median) const noexcept
+{
+    auto frame = window[index];
+    auto offset = frequencyToNote (frame.frequency) - median;
+    auto octaves = static_cast<int> (std::round (offset / 12.0f));
+
+    if (octaves == 0 || std::abs (offset - 12.0f * static_cast<float> (octaves)) > sameNoteSemitones)
+        return frame;
+
+    // Frames around this one at the same octave from the median: a long
+    // run is a real leap, a short one a misread
+    auto sameOctave = [&] (int i)
+    {
+        return window[i].voiced && window[i].frequency > 0.0f
+            && std::abs (frequencyToNote (window[i].frequency) - median - 12.0f * static_cast<float> (octaves)) <= sameNoteSemitones;
+    };
+
+    int run = 1;
+    for (int i = index - 1; i >= 0 && sameOctave (i); --i)
+        ++run;
+    for (int i = index + 1; i < getWindowSize() && sameOctave (i); ++i)
+        ++run;
+
+    if (run > maxOctaveErrorHops)
+        return frame;
+
+    auto scale = std::exp2 (static_cast<float> (-octaves));
+    frame.frequency *= scale;
+    frame.period /= scale;
+    return frame;
+}
+
+bool PitchRefiner::isSustained (const PitchDetector::Result* window, int index) const noexcept
+{
+    // Voiced for maxOnsetHops, or as far as the window reaches
+    for (int i = index; i < juce::jmin (index + maxOnsetHops, getWindowSize()); ++i)
+        if (! window[i].voiced)
+            return false;
+
+    return true;
+}
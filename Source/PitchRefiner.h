@@ -0,0 +1,62 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+#include "PitchDetector.h"
+
+/**
+ * Lookahead Pitch Refiner
+ *
+ * Decides a hop's pitch from the detector's frames either side of it, for
+ * offline renders that can afford to wait for the future. A realtime
+ * detector only sees the past, so it:
+ *
+ * - misreads a few frames an octave out now and then. A frame an octave
+ *   from the median of its neighbourhood, for less than
+ *   maxOctaveErrorSeconds, is folded back; a held octave leap is kept.
+ * - drops out for a frame or two mid-note, which lets the correction go.
+ *   Gaps up to maxGapSeconds between matching pitches are bridged.
+ * - reports a note some milliseconds after it starts. Up to
+ *   maxOnsetSeconds before a sustained note, frames take its pitch, so
+ *   the correction is in place for its first cycles.
+ *
+ * refine() only reads the window it is given, so a stream (the engine
+ * delaying its audio) and a whole-file track decide exactly the same.
+ */
+class PitchRefiner
+{
+public:
+    PitchRefiner() = default;
+
+    /** contextHops frames either side of the one being decided; allocates. */
+    void prepare (double sampleRate, int hopSize, int contextHops);
+
+    int getContextHops() const noexcept { return contextHops; }
+    int getWindowSize() const noexcept { return 2 * contextHops + 1; }
+
+    /**
+     * The decision for the middle frame of window: getWindowSize() frames,
+     * oldest first. Frames before the start or past the end are unvoiced.
+     */
+    PitchDetector::Result refine (const PitchDetector::Result* window) noexcept;
+
+    static constexpr double maxOctaveErrorSeconds = 0.04;
+    static constexpr double maxGapSeconds = 0.03;
+    static constexpr double maxOnsetSeconds = 0.015;    // The detector locks on within about 12 ms
+
+private:
+    PitchDetector::Result fixOctave (const PitchDetector::Result* window, int index, float median) const noexcept;
+    bool isSustained (const PitchDetector::Result* window, int index) const noexcept;
+    static float frequencyToNote (float frequency) noexcept;
+
+    double sampleRate = 44100.0;
+    int contextHops = 0;
+    int maxOctaveErrorHops = 0;
+    int maxGapHops = 0;
+    int maxOnsetHops = 0;
+
+    std::vector<float> voicedNotes;     // Scratch for the median, sized in prepare()
+
+    JUCE_DECLARE_NON_COPYABLE (PitchRefiner)
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * Pitch Shifter Interface
+ *
+ * Common interface for the engine's shifters, so the algorithm can be chosen
+ * per instance:
+ * - PsolaShifter: pitch-synchronous overlap-add, formant preserving
+ * - CycleResampler: fractional-rate resampling that adds or drops whole
+ *   cycles (patent section 3.3), a fraction of the CPU at some formant cost
+ * - SpectralPeakShifter: peak-locked phase vocoder; formants move with
+ *   the pitch, and like PSOLA it takes harmony voices
+ *
+ * All implementations process linked multichannel audio (one set of
+ * decisions for every channel), take one pitch ratio per sample, never
+ * allocate after prepare() and report a latency that follows the frequency
+ * range.
+ *
+ * Shifters that can reuse their analysis for extra synthesis streams also
+ * take harmony voices, which are mixed into the output.
+ */
+class PitchShifter
+{
+public:
+    /** An extra synthesis stream: a ratio to the input pitch and a gain (0 = off). */
+    struct HarmonyVoice
+    {
+        float ratio = 1.0f;
+        float gain = 0.0f;
+    };
+
+    static constexpr int maxHarmonyVoices = 4;
+
+    virtual ~PitchShifter() = default;
+
+    /** Allocates everything process() needs for up to numChannels channels. */
+    virtual void prepare (double sampleRate, int maxBlockSize, int numChannels) = 0;
+    virtual void reset() = 0;
+
+    /** Pitch range to shift within; never allocates. */
+    virtual void setFrequencyRange (float minHz, float maxHz) = 0;
+
+    /**
+     * Shifts numChannels channels in place or out of place.
+     *
+     * @param pitchRatios One ratio per sample, or nullptr for unity
+     * @param detectedPeriod Current detected pitch period in samples (0 if unvoiced)
+     * @param confidence Detection confidence (0-1)
+     * @param analysisInput Signal the shift decisions are based on, e.g. the
+     *                      mono sum the detector saw; nullptr uses the mean
+     *                      of the channels
+     */
+    virtual void process (const float* const* inputs, float* const* outputs, int numChannels, int numSamples,
+                          const float* pitchRatios, float detectedPeriod, float confidence,
+                          const float* analysisInput = nullptr) = 0;
+
+    /** Input-to-output delay in samples for the current frequency range. */
+    virtual int getLatencySamples() const noexcept = 0;
+
+    /**
+     * Sets the harmony voices (at most maxHarmonyVoices) mixed in from the
+     * next process() call on; gain changes are faded. Never allocates.
+     * Shifters without harmony support ignore this.
+     */
+    virtual void setHarmonyVoices (const HarmonyVoice* /*voices*/, int /*numVoices*/) noexcept {}
+    virtual bool supportsHarmony() const noexcept { return false; }
+};
@@ -0,0 +1,303 @@
+#include "PitchTrackFile.h"
+#include <cstring>
+
+namespace
+{
+const char magic[4] = { 'P', 'T', 'R', 'K' };
+constexpr int numFramesOffset = 16;
+
+// Fields are decoded from the map byte by byte, so neither alignment nor
+// the host's byte order matters
+std::int32_t readInt (const std::uint8_t* data, int offset) noexcept
+{
+    return static_cast<std::int32_t> (juce::ByteOrder::littleEndianInt (data + offset));
+}
+
+std::int64_t readInt64 (const std::uint8_t* data, int offset) noexcept
+{
+    return static_cast<std::int64_t> (juce::ByteOrder::littleEndianInt64 (data + offset));
+}
+
+float readFloat (const std::uint8_t* data, int offset) noexcept
+{
+    auto bits = juce::ByteOrder::littleEndianInt (data + offset);
+    float value;
+    std::memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+double readDouble (const std::uint8_t* data, int offset) noexcept
+{
+    auto bits = juce::ByteOrder::littleEndianInt64 (data + offset);
+    double value;
+    std::memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+}
+
+//==============================================================================
+PitchTrackFile::Settings PitchTrackFile::Settings::fromParameters (const PitchCorrectionEngine::Parameters& params,
+                                                                   double sampleRate, int hopSize)
+{
+    // The range in effect comes from the detector itself, so the legacy
+    // range override resolves the same way it does in the engine
+    PitchDetector detector;
+    PitchCorrectionEngine::configureDetector (detector, params);
+
+    Settings settings;
+    settings.sampleRate = sampleRate;
+    settings.hopSize = hopSize;
+    settings.inputType = params.inputType;
+    settings.minFrequency = detector.getMinFrequency();
+    settings.maxFrequency = detector.getMaxFrequency();
+    settings.tracking = params.tracking;
+    settings.scale = PitchCorrectionEngine::makeScaleSettings (params);
+    return settings;
+}
+
+bool PitchTrackFile::Settings::hasSameDetection (const Settings& other) const noexcept
+{
+    return sampleRate == other.sampleRate && hopSize == other.hopSize && inputType == other.inputType
+        && minFrequency == other.minFrequency && maxFrequency == other.maxFrequency && tracking == other.tracking;
+}
+
+PitchTrackFile::Source PitchTrackFile::Source::fromFile (const juce::File& file, std::int64_t lengthInSamples, int numChannels)
+{
+    Source source;
+    source.lengthInSamples = lengthInSamples;
+    source.numChannels = numChannels;
+    source.fileSize = file.getSize();
+    source.modificationTime = file.getLastModificationTime().toMilliseconds();
+    return source;
+}
+
+bool PitchTrackFile::Source::operator== (const Source& other) const noexcept
+{
+    return lengthInSamples == other.lengthInSamples && numChannels == other.numChannels
+        && fileSize == other.fileSize && modificationTime == other.modificationTime;
+}
+
+//==============================================================================
+PitchTrackFile::Writer::Writer (std::unique_ptr<juce::FileOutputStream> outputStream, const Settings& settings, const Source& source)
+    : stream (std::move (outputStream))
+{
+    if (stream == nullptr || stream->failedToOpen())
+        return;
+
+    // The frame count stays -1 (incomplete) until finish()
+    ok = stream->write (magic, sizeof (magic))
+      && stream->writeInt (static_cast<int> (formatVersion))
+      && stream->writeInt (headerSize)
+      && stream->writeInt (recordSize)
+      && stream->writeInt64 (-1)
+      && stream->writeDouble (settings.sampleRate)
+      && stream->writeInt (settings.hopSize)
+      && stream->writeInt (static_cast<int> (settings.inputType))
+      && stream->writeFloat (settings.minFrequency)
+      && stream->writeFloat (settings.maxFrequency)
+      && stream->writeFloat (settings.tracking)
+      && stream->writeInt (static_cast<int> (settings.scale.type))
+      && stream->writeInt (settings.scale.root)
+      && stream->writeInt (settings.scale.customMask)
+      && stream->writeInt (settings.scale.transpose)
+      && stream->writeFloat (settings.scale.detune)
+      && stream->writeInt64 (source.lengthInSamples)
+      && stream->writeInt (source.numChannels)
+      && stream->writeInt (0)
+      && stream->writeInt64 (source.fileSize)
+      && stream->writeInt64 (source.modificationTime)
+      && stream->writeRepeatedByte (0, static_cast<size_t> (headerSize - 104));
+}
+
+bool PitchTrackFile::Writer::write (const Frame& frame)
+{
+    const auto& detection = frame.detection;
+    ok = ok
+      && stream->writeFloat (detection.frequency)
+      && stream->writeFloat (detection.period)
+      && stream->writeFloat (detection.confidence)
+      && stream->writeFloat (frame.deviationCents)
+      && stream->writeShort (static_cast<short> (frame.targetNote))
+      && stream->writeByte (detection.voiced ? 1 : 0)
+      && stream->writeByte (0);
+
+    ++numFrames;
+    return ok;
+}
+
+bool PitchTrackFile::Writer::finish()
+{
+    ok = ok
+      && stream->setPosition (numFramesOffset)
+      && stream->writeInt64 (numFrames);
+
+    if (ok)
+    {
+        stream->flush();
+        ok = stream->getStatus().wasOk();
+    }
+
+    return ok;
+}
+
+//==============================================================================
+void PitchTrackFile::Analyser::prepare (const PitchCorrectionEngine::Parameters& params, double sampleRate, int hopSize)
+{
+    settings = Settings::fromParameters (params, sampleRate, hopSize);
+
+    // Same order as the engine: prepare, then configure
+    detector.prepare (sampleRate, hopSize);
+    PitchCorrectionEngine::configureDetector (detector, params);
+    scaleMapper.setSettings (settings.scale);
+
+    monoBuffer.setSize (1, hopSize);
+    hopPosition = 0;
+}
+
+bool PitchTrackFile::Analyser::process (const juce::AudioBuffer<float>& block, Writer& writer)
+{
+    int numChannels = block.getNumChannels();
+    int position = 0;
+
+    while (position < block.getNumSamples())
+    {
+        // The engine's mono mix, hop by hop
+        int numSamples = juce::jmin (block.getNumSamples() - position, settings.hopSize - hopPosition);
+        monoBuffer.clear (0, 0, numSamples);
+        for (int ch = 0; ch < numChannels; ++ch)
+            monoBuffer.addFrom (0, 0, block, ch, position, numSamples, 1.0f / static_cast<float> (numChannels));
+
+        detector.pushSamples (monoBuffer.getReadPointer (0), numSamples);
+        hopPosition += numSamples;
+        position += numSamples;
+
+        if (hopPosition < settings.hopSize)
+            continue;
+
+        hopPosition = 0;
+
+        Frame frame;
+        frame.detection = detector.analyse();
+        if (frame.detection.voiced && frame.detection.frequency > 0.0f)
+        {
+            auto mapResult = scaleMapper.map (frame.detection.frequency);
+            frame.targetNote = mapResult.targetNoteNumber;
+            frame.deviationCents = mapResult.deviationCents;
+        }
+
+        if (! writer.write (frame))
+            return false;
+    }
+
+    return true;
+}
+
+bool PitchTrackFile::Analyser::processTail (int numChannels, Writer& writer)
+{
+    juce::AudioBuffer<float> silence (juce::jmax (1, numChannels), settings.hopSize);
+    silence.clear();
+
+    for (auto remaining = juce::roundToInt (tailSeconds * settings.sampleRate); remaining > 0; remaining -= settings.hopSize)
+        if (! process (silence, writer))
+            return false;
+
+    return true;
+}
+
+//==============================================================================
+juce::Result PitchTrackFile::open (const juce::File& file)
+{
+    close();
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const std::uint8_t*> (mapped->getData());
+    auto size = static_cast<std::int64_t> (mapped->getSize());
+    auto name = file.getFullPathName();
+
+    if (data == nullptr || size < headerSize || std::memcmp (data, magic, sizeof (magic)) != 0)
+        return juce::Result::fail ("not a pitch track: " + name);
+
+    auto version = static_cast<std::uint32_t> (readInt (data, 4));
+    if (version != formatVersion || readInt (data, 8) != headerSize || readInt (data, 12) != recordSize)
+        return juce::Result::fail ("pitch track version " + juce::String (version) + ", expected "
+                                   + juce::String (formatVersion) + ": " + name);
+
+    auto count = readInt64 (data, numFramesOffset);
+    if (count < 0)
+        return juce::Result::fail ("incomplete pitch track: " + name);
+    if (count > (size - headerSize) / recordSize)
+        return juce::Result::fail ("truncated pitch track: " + name);
+
+    settings.sampleRate = readDouble (data, 24);
+    settings.hopSize = readInt (data, 32);
+    settings.inputType = static_cast<PitchDetector::InputType> (readInt (data, 36));
+    settings.minFrequency = readFloat (data, 40);
+    settings.maxFrequency = readFloat (data, 44);
+    settings.tracking = readFloat (data, 48);
+    settings.scale.type = static_cast<ScaleMapper::ScaleType> (readInt (data, 52));
+    settings.scale.root = readInt (data, 56);
+    settings.scale.customMask = static_cast<ScaleMapper::NoteMask> (readInt (data, 60));
+    settings.scale.transpose = readInt (data, 64);
+    settings.scale.detune = readFloat (data, 68);
+
+    source.lengthInSamples = readInt64 (data, 72);
+    source.numChannels = readInt (data, 80);
+    source.fileSize = readInt64 (data, 88);
+    source.modificationTime = readInt64 (data, 96);
+
+    if (settings.hopSize <= 0 || settings.sampleRate <= 0.0)
+        return juce::Result::fail ("not a pitch track: " + name);
+
+    map = std::move (mapped);
+    records = data + headerSize;
+    numFrames = count;
+    return juce::Result::ok();
+}
+
+void PitchTrackFile::close()
+{
+    map.reset();
+    records = nullptr;
+    numFrames = 0;
+}
+
+PitchTrackFile::Frame PitchTrackFile::getFrame (std::int64_t index) const noexcept
+{
+    Frame frame;
+    if (index < 0 || index >= numFrames)
+        return frame;
+
+    auto* record = records + index * recordSize;
+    frame.detection.frequency = readFloat (record, 0);
+    frame.detection.period = readFloat (record, 4);
+    frame.detection.confidence = readFloat (record, 8);
+    frame.deviationCents = readFloat (record, 12);
+    frame.targetNote = static_cast<std::int16_t> (juce::ByteOrder::littleEndianShort (record + 16));
+    frame.detection.voiced = (record[18] & 1) != 0;
+    return frame;
+}
+
+bool PitchTrackFile::writeCsv (juce::OutputStream& stream) const
+{
+    bool ok = stream.writeText ("frame,sample,seconds,f0_hz,period_samples,confidence,voiced,"
+                                "target_note,target_name,deviation_cents\n", false, false, nullptr);
+
+    for (std::int64_t i = 0; i < numFrames && ok; ++i)
+    {
+        auto frame = getFrame (i);
+        auto sample = (i + 1) * settings.hopSize;
+        bool hasTarget = frame.targetNote >= 0;
+
+        juce::String line;
+        line << i << ',' << sample << ',' << juce::String (static_cast<double> (sample) / settings.sampleRate, 6)
+             << ',' << juce::String (frame.detection.frequency, 3) << ',' << juce::String (frame.detection.period, 3)
+             << ',' << juce::String (frame.detection.confidence, 4) << ',' << (frame.detection.voiced ? 1 : 0)
+             << ',' << (hasTarget ? juce::String (frame.targetNote) : juce::String())
+             << ',' << (hasTarget ? ScaleMapper::midiToNoteName (frame.targetNote) : juce::String())
+             << ',' << (hasTarget ? juce::String (frame.deviationCents, 2) : juce::String()) << '\n';
+
+        ok = stream.writeText (line, false, false, nullptr);
+    }
+
+    return ok;
+}
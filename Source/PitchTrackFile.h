@@ -0,0 +1,150 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cstdint>
+#include <memory>
+
+#include "PitchCorrectionEngine.h"
+
+/**
+ * Pitch Track File
+ *
+ * A whole file's per-hop analysis: the detector's result and the scale
+ * target for every analysis hop, stored so offline tools can try other
+ * retune settings on the same take without detecting it again.
+ *
+ * Binary layout, little-endian throughout: a headerSize-byte header
+ * (settings and the analysed file's fingerprint), then one recordSize-byte
+ * record per hop, record i covering the hop that ends at sample
+ * (i + 1) * hopSize. Readers map the file and decode records in place, so
+ * opening an hour of analysis reads nothing up front. Any layout change
+ * bumps formatVersion, and readers refuse other versions.
+ */
+class PitchTrackFile
+{
+public:
+    static constexpr std::uint32_t formatVersion = 1;
+    static constexpr int headerSize = 128;
+    static constexpr int recordSize = 20;
+
+    // What the analysis depended on. The detection fields decide whether a
+    // track can stand in for the detector; the scale only sets each frame's
+    // target note and deviation.
+    struct Settings
+    {
+        double sampleRate = 44100.0;
+        int hopSize = PitchCorrectionEngine::defaultAnalysisHopSize;
+        PitchDetector::InputType inputType = PitchDetector::InputType::AltoTenor;
+        float minFrequency = 0.0f;          // Detector range in effect
+        float maxFrequency = 0.0f;
+        float tracking = 0.5f;
+        ScaleMapper::Settings scale;
+
+        /** The engine's settings for these parameters. */
+        static Settings fromParameters (const PitchCorrectionEngine::Parameters& params, double sampleRate,
+                                        int hopSize = PitchCorrectionEngine::defaultAnalysisHopSize);
+
+        bool hasSameDetection (const Settings& other) const noexcept;
+    };
+
+    // The analysed audio file, to tell when a track is out of date
+    struct Source
+    {
+        std::int64_t lengthInSamples = 0;
+        int numChannels = 0;
+        std::int64_t fileSize = 0;
+        std::int64_t modificationTime = 0;  // Milliseconds since 1970
+
+        static Source fromFile (const juce::File& file, std::int64_t lengthInSamples, int numChannels);
+
+        bool operator== (const Source& other) const noexcept;
+        bool operator!= (const Source& other) const noexcept { return ! operator== (other); }
+    };
+
+    struct Frame
+    {
+        PitchDetector::Result detection;
+        int targetNote = -1;                // MIDI note, -1 when unvoiced
+        float deviationCents = 0.0f;        // Detected pitch relative to the target note
+    };
+
+    /** Streams frames to a new file; the frame count goes in on finish(). */
+    class Writer
+    {
+    public:
+        Writer (std::unique_ptr<juce::FileOutputStream> stream, const Settings& settings, const Source& source);
+
+        bool write (const Frame& frame);
+        bool finish();
+
+    private:
+        std::unique_ptr<juce::FileOutputStream> stream;
+        std::int64_t numFrames = 0;
+        bool ok = false;
+
+        JUCE_DECLARE_NON_COPYABLE (Writer)
+    };
+
+    /**
+     * Runs detection and scale mapping exactly as the engine does, without
+     * shifting, so a render driven by the track matches one that detected
+     * for itself sample for sample.
+     */
+    class Analyser
+    {
+    public:
+        Analyser() = default;
+
+        void prepare (const PitchCorrectionEngine::Parameters& params, double sampleRate,
+                      int hopSize = PitchCorrectionEngine::defaultAnalysisHopSize);
+        const Settings& getSettings() const noexcept { return settings; }
+
+        /** Writes a frame for every hop the block completes. */
+        bool process (const juce::AudioBuffer<float>& block, Writer& writer);
+
+        /**
+         * Runs on through tailSeconds of silence, as a render does to flush
+         * the shifter's latency, so the track covers every hop a render of
+         * the file reaches.
+         */
+        bool processTail (int numChannels, Writer& writer);
+
+        static constexpr double tailSeconds = 0.25;     // Longer than any shifter's latency
+
+    private:
+        Settings settings;
+        PitchDetector detector;
+        ScaleMapper scaleMapper;
+        juce::AudioBuffer<float> monoBuffer;
+        int hopPosition = 0;
+
+        JUCE_DECLARE_NON_COPYABLE (Analyser)
+    };
+
+    PitchTrackFile() = default;
+
+    /** Maps a track; fails for a missing, truncated or other-version file. */
+    juce::Result open (const juce::File& file);
+    void close();
+
+    bool isOpen() const noexcept { return records != nullptr; }
+    const Settings& getSettings() const noexcept { return settings; }
+    const Source& getSource() const noexcept { return source; }
+    std::int64_t getNumFrames() const noexcept { return numFrames; }
+
+    /** A frame decoded from the map; frames past either end read as unvoiced. */
+    Frame getFrame (std::int64_t index) const noexcept;
+
+    /** One line per frame, with a header row; for spreadsheets and scripts. */
+    bool writeCsv (juce::OutputStream& stream) const;
+
+private:
+    std::unique_ptr<juce::MemoryMappedFile> map;
+    const std::uint8_t* records = nullptr;
+    std::int64_t numFrames = 0;
+    Settings settings;
+    Source source;
+
+    JUCE_DECLARE_NON_COPYABLE (PitchTrackFile)
+};
@@ -5,7 +5,7 @@
 namespace
 {
 constexpr int windowWidth = 600;
-constexpr int windowHeight = 450;
+constexpr int windowHeight = 480;
 
 static const juce::StringArray noteNames { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
 }
@@ -38,6 +38,9 @@ ProTuneAudioProcessorEditor::ProTuneAudioProcessorEditor (ProTuneAudioProcessor&
     inputPitchLabel.setText ("No pitch detected", juce::dontSendNotification);
     addAndMakeVisible (inputPitchLabel);
 
+    // Pitch history
+    addAndMakeVisible (pitchGraph);
+
     // Input Type selector
     inputTypeSelector.addItemList ({ "Soprano", "Alto/Tenor", "Low Male", "Instrument", "Bass Inst." }, 1);
     inputTypeSelector.setColour (juce::ComboBox::backgroundColourId, meterBgColor);
@@ -115,12 +118,59 @@ ProTuneAudioProcessorEditor::ProTuneAudioProcessorEditor (ProTuneAudioProcessor&
     transposeAttachment = std::make_unique<SliderAttachment> (vts, "transpose", transposeSlider);
     detuneAttachment = std::make_unique<SliderAttachment> (vts, "detune", detuneSlider);
 
+    setOpaque (true);
     setSize (windowWidth, windowHeight);
+    analysisFrames.resize (AnalysisFifo::capacity);
+
+    // With no editor open the FIFO filled up and then kept its oldest
+    // frames, seconds old by now; discard them so the graph starts current
+    processor.getAnalysisFifo().pop (analysisFrames.data(), static_cast<int> (analysisFrames.size()));
     startTimerHz (30);
 }
 
 void ProTuneAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    // Static layers come from the cache; only the indicator is drawn live
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (backgroundLayer.isNull() || scale != backgroundScale)
+        renderBackgroundLayer (scale);
+
+    g.drawImageTransformed (backgroundLayer, juce::AffineTransform::scale (1.0f / backgroundScale));
+
+    // Deviation indicator
+    float indicatorX = getIndicatorX();
+    paintedIndicatorX = indicatorX;
+
+    if (indicatorX >= 0.0f)
+    {
+        // Color based on deviation
+        juce::Colour indicatorColor;
+        float absDeviation = std::abs (juce::jlimit (-50.0f, 50.0f, displayedDeviation));
+        if (absDeviation < 10.0f)
+            indicatorColor = juce::Colour::fromRGB (0, 255, 100);  // Green
+        else if (absDeviation < 25.0f)
+            indicatorColor = juce::Colour::fromRGB (255, 255, 0);  // Yellow
+        else
+            indicatorColor = juce::Colour::fromRGB (255, 80, 80);  // Red
+
+        g.setColour (indicatorColor);
+        g.fillEllipse (indicatorX - 8, deviationBarBounds.getCentreY() - 8, 16, 16);
+        g.setColour (juce::Colours::white);
+        g.drawEllipse (indicatorX - 8, deviationBarBounds.getCentreY() - 8, 16, 16, 2.0f);
+    }
+}
+
+void ProTuneAudioProcessorEditor::renderBackgroundLayer (float scale)
+{
+    backgroundScale = scale;
+    backgroundLayer = juce::Image (juce::Image::RGB,
+                                   juce::jmax (1, juce::roundToInt (static_cast<float> (getWidth()) * scale)),
+                                   juce::jmax (1, juce::roundToInt (static_cast<float> (getHeight()) * scale)),
+                                   false);
+
+    juce::Graphics g (backgroundLayer);
+    g.addTransform (juce::AffineTransform::scale (scale));
+
     // Background
     g.fillAll (bgColor);
 
@@ -137,14 +187,13 @@ void ProTuneAudioProcessorEditor::paint (juce::Graphics& g)
     g.drawText ("ProTune", header.withTrimmedRight (100).withTrimmedLeft (20), juce::Justification::centredLeft);
 
     // Pitch meter area (left side)
-    auto meterArea = juce::Rectangle<float> (20, 60, 260, 200);
     g.setColour (meterBgColor);
-    g.fillRoundedRectangle (meterArea, 10.0f);
+    g.fillRoundedRectangle (meterBounds, 10.0f);
     g.setColour (accentColor.withAlpha (0.5f));
-    g.drawRoundedRectangle (meterArea, 10.0f, 2.0f);
+    g.drawRoundedRectangle (meterBounds, 10.0f, 2.0f);
 
     // Cents deviation bar (horizontal)
-    auto barArea = meterArea.reduced (20).removeFromBottom (40);
+    auto barArea = deviationBarBounds;
     g.setColour (juce::Colour::fromRGB (40, 45, 55));
     g.fillRoundedRectangle (barArea, 5.0f);
 
@@ -160,28 +209,6 @@ void ProTuneAudioProcessorEditor::paint (juce::Graphics& g)
         g.drawLine (x, barY + 5, x, barY + 5 + tickHeight, tick == 0 ? 2.0f : 1.0f);
     }
 
-    // Deviation indicator
-    if (displayedTargetHz > 0.0f)
-    {
-        float deviation = juce::jlimit (-50.0f, 50.0f, displayedDeviation);
-        float indicatorX = barCenterX + (deviation / 50.0f) * (barArea.getWidth() * 0.4f);
-
-        // Color based on deviation
-        juce::Colour indicatorColor;
-        float absDeviation = std::abs (deviation);
-        if (absDeviation < 10.0f)
-            indicatorColor = juce::Colour::fromRGB (0, 255, 100);  // Green
-        else if (absDeviation < 25.0f)
-            indicatorColor = juce::Colour::fromRGB (255, 255, 0);  // Yellow
-        else
-            indicatorColor = juce::Colour::fromRGB (255, 80, 80);  // Red
-
-        g.setColour (indicatorColor);
-        g.fillEllipse (indicatorX - 8, barArea.getCentreY() - 8, 16, 16);
-        g.setColour (juce::Colours::white);
-        g.drawEllipse (indicatorX - 8, barArea.getCentreY() - 8, 16, 16, 2.0f);
-    }
-
     // Cents labels
     g.setColour (juce::Colours::grey);
     g.setFont (juce::Font (juce::FontOptions (10.0f)));
@@ -191,20 +218,41 @@ void ProTuneAudioProcessorEditor::paint (juce::Graphics& g)
                 juce::Justification::centred);
 
     // Control panel background (right side)
-    auto controlArea = juce::Rectangle<float> (300, 60, 280, 200);
     g.setColour (meterBgColor.withAlpha (0.5f));
-    g.fillRoundedRectangle (controlArea, 10.0f);
+    g.fillRoundedRectangle (controlBounds, 10.0f);
+
+    // Pitch graph frame
+    g.setColour (meterBgColor);
+    g.fillRoundedRectangle (graphPanelBounds, 10.0f);
+    g.setColour (accentColor.withAlpha (0.3f));
+    g.drawRoundedRectangle (graphPanelBounds, 10.0f, 1.0f);
 
     // Bottom control strip background
-    auto stripArea = juce::Rectangle<float> (20, 330, static_cast<float> (getWidth() - 40), 100);
     g.setColour (meterBgColor.withAlpha (0.3f));
-    g.fillRoundedRectangle (stripArea, 10.0f);
+    g.fillRoundedRectangle (stripBounds, 10.0f);
+}
+
+float ProTuneAudioProcessorEditor::getIndicatorX() const
+{
+    if (displayedTargetHz <= 0.0f)
+        return -1.0f;
+
+    float deviation = juce::jlimit (-50.0f, 50.0f, displayedDeviation);
+    return deviationBarBounds.getCentreX() + (deviation / 50.0f) * (deviationBarBounds.getWidth() * 0.4f);
 }
 
 void ProTuneAudioProcessorEditor::resized()
 {
     auto bounds = getLocalBounds();
 
+    // Panels behind the controls; the cached layer is redrawn to match
+    meterBounds = juce::Rectangle<float> (20, 60, 260, 200);
+    deviationBarBounds = meterBounds.reduced (20).removeFromBottom (40);
+    controlBounds = juce::Rectangle<float> (300, 60, 280, 200);
+    graphPanelBounds = juce::Rectangle<float> (20, 270, static_cast<float> (getWidth() - 40), 90);
+    stripBounds = juce::Rectangle<float> (20, 370, static_cast<float> (getWidth() - 40), 100);
+    backgroundLayer = {};
+
     // Header
     auto headerArea = bounds.removeFromTop (45);
     bypassButton.setBounds (headerArea.removeFromRight (100).reduced (10, 8));
@@ -255,9 +303,11 @@ void ProTuneAudioProcessorEditor::resized()
     retuneSpeedLabel.setBounds (rightArea.removeFromTop (20));
     retuneSpeedSlider.setBounds (rightArea.removeFromTop (80).withSizeKeepingCentre (100, 80));
 
+    // Pitch graph, inset from its frame
+    pitchGraph.setBounds (graphPanelBounds.reduced (8.0f, 6.0f).toNearestInt());
+
     // Bottom control strip
-    bounds.removeFromTop (30);
-    auto stripArea = bounds.removeFromTop (100).reduced (20, 10);
+    auto stripArea = stripBounds.toNearestInt().reduced (0, 10);
     auto sliderWidth = stripArea.getWidth() / 5;
 
     auto makeSliderArea = [&] () -> juce::Rectangle<int>
@@ -288,8 +338,16 @@ void ProTuneAudioProcessorEditor::resized()
 
 void ProTuneAudioProcessorEditor::timerCallback()
 {
-    auto detected = processor.getLastDetectedFrequency();
-    auto target = processor.getLastTargetFrequency();
+    // Take every frame published since the last tick; the newest drives
+    // the meter
+    int numFrames = processor.getAnalysisFifo().pop (analysisFrames.data(), static_cast<int> (analysisFrames.size()));
+    if (numFrames > 0)
+        latestFrame = analysisFrames[static_cast<size_t> (numFrames - 1)];
+
+    pitchGraph.pushFrames (analysisFrames.data(), numFrames, processor.getSampleRate());
+
+    auto detected = latestFrame.detectedFrequency;
+    auto target = latestFrame.targetFrequency;
 
     // Smooth the display values
     constexpr float smoothing = 0.25f;
@@ -331,7 +389,11 @@ void ProTuneAudioProcessorEditor::timerCallback()
         inputPitchLabel.setText ("No pitch detected", juce::dontSendNotification);
     }
 
-    repaint();
+    // Only the deviation bar needs repainting, and only when the indicator
+    // moved by a visible amount (labels repaint themselves on a text change)
+    float indicatorX = getIndicatorX();
+    if ((indicatorX < 0.0f) != (paintedIndicatorX < 0.0f) || std::abs (indicatorX - paintedIndicatorX) >= 0.5f)
+        repaint (deviationBarBounds.expanded (10.0f).getSmallestIntegerContainer());
 }
 
 void ProTuneAudioProcessorEditor::configureSlider (juce::Slider& slider, const juce::String& suffix)
@@ -2,15 +2,21 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "PitchGraph.h"
 
 /**
  * Auto-Tune Evo Style Plugin Editor
  *
- * Layout (600x450):
+ * Layout (600x480):
  * - Header with title and bypass
  * - Left: Pitch meter with note display and cents deviation bar
  * - Right: Input type, key, scale selectors + retune speed knob
+ * - Middle: Scrolling detected vs target pitch graph
  * - Bottom: Control strip with tracking, humanize, vibrato, transpose, detune
+ *
+ * Everything static is rendered once into a cached image; the timer only
+ * invalidates the deviation bar when the indicator moves, and the graph and
+ * labels repaint themselves when their content changes.
  */
 class ProTuneAudioProcessorEditor : public juce::AudioProcessorEditor,
                                     private juce::Timer
@@ -24,6 +30,8 @@ public:
 
 private:
     void timerCallback() override;
+    void renderBackgroundLayer (float scale);
+    float getIndicatorX() const;
     void configureSlider (juce::Slider& slider, const juce::String& suffix = "");
     void configureLabel (juce::Label& label, float fontSize = 12.0f);
     juce::String frequencyToNoteName (float frequency) const;
@@ -34,6 +42,18 @@ private:
     // Header
     juce::ToggleButton bypassButton { "Bypass" };
 
+    // Panels, set in resized()
+    juce::Rectangle<float> meterBounds;
+    juce::Rectangle<float> deviationBarBounds;
+    juce::Rectangle<float> controlBounds;
+    juce::Rectangle<float> graphPanelBounds;
+    juce::Rectangle<float> stripBounds;
+
+    // Static layers at the display's pixel scale; rebuilt on resize or when
+    // the scale changes
+    juce::Image backgroundLayer;
+    float backgroundScale = 0.0f;
+
     // Pitch display
     juce::Label noteLabel;           // Large note name (e.g., "A4")
     juce::Label frequencyLabel;      // Frequency in Hz
@@ -80,10 +100,17 @@ private:
     std::unique_ptr<SliderAttachment> transposeAttachment;
     std::unique_ptr<SliderAttachment> detuneAttachment;
 
+    // Analysis frames drained from the processor each tick (sized once), and
+    // the newest one seen so far
+    std::vector<AnalysisFifo::Frame> analysisFrames;
+    AnalysisFifo::Frame latestFrame;
+    PitchGraph pitchGraph;
+
     // Smoothed display values
     float displayedDetectedHz = 0.0f;
     float displayedTargetHz = 0.0f;
     float displayedDeviation = 0.0f;
+    float paintedIndicatorX = -1.0f;    // Where the indicator was last drawn (-1 = hidden)
 
     // Colors
     juce::Colour bgColor { 18, 22, 30 };
@@ -23,6 +23,11 @@ ProTuneAudioProcessor::ProTuneAudioProcessor()
     vibratoParam = parameters.getRawParameterValue ("vibrato");
     formantParam = parameters.getRawParameterValue ("formant");
     midiParam = parameters.getRawParameterValue ("midiEnabled");
+    shifterModeParam = parameters.getRawParameterValue ("shifterMode");
+    stereoLinkParam = parameters.getRawParameterValue ("stereoLink");
+    harmonyParam = parameters.getRawParameterValue ("harmonyEnabled");
+    harmonyLevelParam = parameters.getRawParameterValue ("harmonyLevel");
+    offlineLookaheadParam = parameters.getRawParameterValue ("offlineLookahead");
 
     // Legacy parameters (for compatibility)
     speedParam = parameters.getRawParameterValue ("speed");
@@ -34,12 +39,50 @@ ProTuneAudioProcessor::ProTuneAudioProcessor()
     scaleMaskParam = parameters.getRawParameterValue ("scaleMask");
     enharmonicParam = parameters.getRawParameterValue ("enharmonicPref");
     forceCorrectionParam = parameters.getRawParameterValue ("forceCorrection");
+
+    for (auto* parameter : getParameters())
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*> (parameter))
+            parameters.addParameterListener (withID->paramID, this);
+}
+
+ProTuneAudioProcessor::~ProTuneAudioProcessor()
+{
+    cancelPendingUpdate();
+
+    for (auto* parameter : getParameters())
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*> (parameter))
+            parameters.removeParameterListener (withID->paramID, this);
+}
+
+void ProTuneAudioProcessor::parameterChanged (const juce::String&, float)
+{
+    parameterVersion.fetch_add (1);
+}
+
+void ProTuneAudioProcessor::handleAsyncUpdate()
+{
+    // setLatencySamples() notifies the host and listeners synchronously, so
+    // it only ever runs here or in prepareToPlay()
+    setLatencySamples (engineLatency.load());
 }
 
 void ProTuneAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    engine.prepare (sampleRate, samplesPerBlock);
+    engine.prepare (sampleRate, samplesPerBlock,
+                    juce::jmax (getTotalNumInputChannels(), getTotalNumOutputChannels()));
+
+    // Bounces can wait for the future, so only offline renders look ahead
+    // and a live session's latency never changes. Hosts prepare again when
+    // switching to an offline render, which is when the lookahead is read;
+    // the latency reported then includes it, so a host that doesn't re-read
+    // latency at the start of a bounce renders it late by the lookahead.
+    float lookaheadMs = isNonRealtime() && offlineLookaheadParam != nullptr ? offlineLookaheadParam->load() : 0.0f;
+    engine.setLookahead (juce::roundToInt (lookaheadMs * 0.001 * sampleRate));
+
+    appliedParameterVersion = parameterVersion.load();
     updateEngineParameters();
+    engineLatency.store (engine.getLatencySamples());
+    setLatencySamples (engineLatency.load());
 }
 
 void ProTuneAudioProcessor::releaseResources()
@@ -68,15 +111,29 @@ void ProTuneAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce
     for (int channel = getTotalNumInputChannels(); channel < getTotalNumOutputChannels(); ++channel)
         buffer.clear (channel, 0, buffer.getNumSamples());
 
-    updateEngineParameters();
+    // The version is read before the parameters, so a change that lands
+    // while they are being read is picked up on the next block
+    auto version = parameterVersion.load();
+    if (version != appliedParameterVersion)
+    {
+        appliedParameterVersion = version;
+        updateEngineParameters();
+
+        // The latency follows the input type; a change is passed to the
+        // message thread rather than notifying the host from here
+        auto latency = engine.getLatencySamples();
+        if (engineLatency.exchange (latency) != latency)
+            triggerAsyncUpdate();
+    }
+
     engine.pushMidi (midiMessages);
     engine.process (buffer);
 
     // Update telemetry for UI
-    lastDetectedFrequency = engine.getLastDetectedFrequency();
-    lastTargetFrequency = engine.getLastTargetFrequency();
-    lastDetectionConfidence = engine.getLastDetectionConfidence();
-    lastPitchRatio = engine.getLastPitchRatio();
+    lastDetectedFrequency.store (engine.getLastDetectedFrequency(), std::memory_order_relaxed);
+    lastTargetFrequency.store (engine.getLastTargetFrequency(), std::memory_order_relaxed);
+    lastDetectionConfidence.store (engine.getLastDetectionConfidence(), std::memory_order_relaxed);
+    lastPitchRatio.store (engine.getLastPitchRatio(), std::memory_order_relaxed);
 }
 
 juce::AudioProcessorEditor* ProTuneAudioProcessor::createEditor()
@@ -97,7 +154,9 @@ void ProTuneAudioProcessor::setStateInformation (const void* data, int sizeInByt
     if (tree.isValid())
     {
         parameters.replaceState (tree);
-        updateEngineParameters();
+
+        // Applied by the audio thread, which owns the engine
+        parameterVersion.fetch_add (1);
     }
 }
 
@@ -164,6 +223,23 @@ void ProTuneAudioProcessor::updateEngineParameters()
     if (midiParam != nullptr)
         engineParameters.midiEnabled = midiParam->load() > 0.5f;
 
+    // Harmony voices from held MIDI notes
+    if (harmonyParam != nullptr)
+        engineParameters.harmonyEnabled = harmonyParam->load() > 0.5f;
+    if (harmonyLevelParam != nullptr)
+        engineParameters.harmonyLevel = harmonyLevelParam->load();
+
+    // Shifter algorithm
+    if (shifterModeParam != nullptr)
+    {
+        int shifterModeIndex = juce::roundToInt (shifterModeParam->load());
+        engineParameters.shifterMode = static_cast<PitchCorrectionEngine::ShifterMode> (
+            juce::jlimit (0, 2, shifterModeIndex));
+    }
+
+    if (stereoLinkParam != nullptr)
+        engineParameters.linkChannels = stereoLinkParam->load() > 0.5f;
+
     // Note transition (legacy)
     if (transitionParam != nullptr)
         engineParameters.noteTransition = transitionParam->load();
@@ -377,6 +453,34 @@ juce::AudioProcessorValueTreeState::ParameterLayout ProTuneAudioProcessor::creat
     params.push_back (std::make_unique<juce::AudioParameterBool> (
         "midiEnabled", "MIDI Control", false));
 
+    // Harmony: each held MIDI note adds a voice at that pitch, folded by
+    // octaves to within an octave of the input (Quality and Spectral shifters)
+    params.push_back (std::make_unique<juce::AudioParameterBool> (
+        "harmonyEnabled", "Harmony", false));
+    params.push_back (std::make_unique<juce::AudioParameterFloat> (
+        "harmonyLevel", "Harmony Level",
+        juce::NormalisableRange<float> (0.0f, 1.0f, 0.01f), 0.7f));
+
+    // Shifter (Quality = PSOLA, Eco = cycle add/drop resampling for dense
+    // sessions, Spectral = peak-locked phase vocoder)
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        "shifterMode", "Shifter", juce::StringArray { "Quality", "Eco", "Spectral" }, 0));
+
+    // Stereo link: one set of pitch marks for both channels keeps the image
+    // coherent; off, each channel is marked on its own (dual-mono sources,
+    // Quality shifter only)
+    params.push_back (std::make_unique<juce::AudioParameterBool> (
+        "stereoLink", "Stereo Link", true));
+
+    // Offline lookahead (ms): on bounces, pitch decisions also see this far
+    // ahead, fixing octave misreads, dropouts and late onsets. Off by
+    // default: it adds latency at the start of a bounce, which only hosts
+    // that re-read latency then compensate, and a bounce with it no longer
+    // matches playback
+    params.push_back (std::make_unique<juce::AudioParameterFloat> (
+        "offlineLookahead", "Offline Lookahead",
+        juce::NormalisableRange<float> (0.0f, 500.0f, 1.0f), 0.0f));
+
     // === LEGACY PARAMETERS (for preset compatibility) ===
 
     params.push_back (std::make_unique<juce::AudioParameterFloat> (
@@ -3,14 +3,16 @@
 #include <JuceHeader.h>
 #include "PitchCorrectionEngine.h"
 
-class ProTuneAudioProcessor : public juce::AudioProcessor
+class ProTuneAudioProcessor : public juce::AudioProcessor,
+                              private juce::AudioProcessorValueTreeState::Listener,
+                              private juce::AsyncUpdater
 {
 public:
     using ScaleSettings = PitchCorrectionEngine::Parameters::ScaleSettings;
     using AllowedMask = PitchCorrectionEngine::AllowedMask;
 
     ProTuneAudioProcessor();
-    ~ProTuneAudioProcessor() override = default;
+    ~ProTuneAudioProcessor() override;
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
@@ -37,11 +39,14 @@ public:
 
     juce::AudioProcessorValueTreeState& getValueTreeState() { return parameters; }
 
-    // Telemetry for UI
-    float getLastDetectedFrequency() const noexcept { return lastDetectedFrequency; }
-    float getLastTargetFrequency() const noexcept { return lastTargetFrequency; }
-    float getLastDetectionConfidence() const noexcept { return lastDetectionConfidence; }
-    float getLastPitchRatio() const noexcept { return lastPitchRatio; }
+    // Telemetry for UI: the latest values, safe to read from any thread
+    float getLastDetectedFrequency() const noexcept { return lastDetectedFrequency.load (std::memory_order_relaxed); }
+    float getLastTargetFrequency() const noexcept { return lastTargetFrequency.load (std::memory_order_relaxed); }
+    float getLastDetectionConfidence() const noexcept { return lastDetectionConfidence.load (std::memory_order_relaxed); }
+    float getLastPitchRatio() const noexcept { return lastPitchRatio.load (std::memory_order_relaxed); }
+
+    /** Every analysis frame, for a single reader (the editor) to drain. */
+    AnalysisFifo& getAnalysisFifo() noexcept { return engine.getAnalysisFifo(); }
 
     // Scale utilities
     ScaleSettings getScaleSettings() const;
@@ -55,12 +60,24 @@ public:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
 private:
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
     void updateEngineParameters();
 
     juce::AudioProcessorValueTreeState parameters;
     PitchCorrectionEngine engine;
     PitchCorrectionEngine::Parameters engineParameters;
 
+    // Bumped by every parameter change (from any thread); the audio thread
+    // rebuilds the engine snapshot only when it differs from the last one
+    // applied, so an idle block never reads the parameters at all
+    std::atomic<std::uint32_t> parameterVersion { 0 };
+    std::uint32_t appliedParameterVersion = 0;
+
+    // The engine's latency as last seen by the audio thread; a change is
+    // reported to the host from the message thread (handleAsyncUpdate)
+    std::atomic<int> engineLatency { 0 };
+
     // New Auto-Tune Evo style parameters
     std::atomic<float>* inputTypeParam = nullptr;
     std::atomic<float>* retuneSpeedParam = nullptr;
@@ -76,6 +93,11 @@ private:
     std::atomic<float>* vibratoParam = nullptr;
     std::atomic<float>* formantParam = nullptr;
     std::atomic<float>* midiParam = nullptr;
+    std::atomic<float>* shifterModeParam = nullptr;
+    std::atomic<float>* stereoLinkParam = nullptr;
+    std::atomic<float>* harmonyParam = nullptr;
+    std::atomic<float>* harmonyLevelParam = nullptr;
+    std::atomic<float>* offlineLookaheadParam = nullptr;
 
     // Legacy parameters (for preset compatibility)
     std::atomic<float>* speedParam = nullptr;
@@ -89,10 +111,10 @@ private:
     std::atomic<float>* forceCorrectionParam = nullptr;
 
     // Telemetry
-    float lastDetectedFrequency = 0.0f;
-    float lastTargetFrequency = 0.0f;
-    float lastDetectionConfidence = 0.0f;
-    float lastPitchRatio = 1.0f;
+    std::atomic<float> lastDetectedFrequency { 0.0f };
+    std::atomic<float> lastTargetFrequency { 0.0f };
+    std::atomic<float> lastDetectionConfidence { 0.0f };
+    std::atomic<float> lastPitchRatio { 1.0f };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProTuneAudioProcessor)
 };
@@ -1,95 +1,273 @@
 #include "PsolaShifter.h"
 #include <cmath>
 #include <algorithm>
+#include <limits>
 
 PsolaShifter::PsolaShifter()
 {
 }
 
-void PsolaShifter::prepare (double sampleRate, int maxBlockSize)
+void PsolaShifter::prepare (double sampleRate, int maxBlockSize, int channels)
 {
     currentSampleRate = sampleRate;
-
-    // Period range for typical voice: 50 Hz - 1000 Hz
-    maxPeriodSamples = static_cast<int> (sampleRate / 50.0);
-    minPeriodSamples = static_cast<int> (sampleRate / 1000.0);
-
-    // Input buffer: large enough to hold samples for look-back
-    int inputBufferSize = maxPeriodSamples * 8 + maxBlockSize;
-    inputBuffer.assign (static_cast<size_t> (inputBufferSize), 0.0f);
-
-    // Latency
-    latencySamples = maxPeriodSamples * 2;
+    windowTables = &WindowTables::getInstance();
+    preparedBlockSize = juce::jmax (1, maxBlockSize);
+    numChannels = juce::jmax (1, channels);
+
+    // Buffers are sized for the lowest frequency any range can select, so
+    // setFrequencyRange() never allocates
+    allocatedMaxPeriod = static_cast<int> (sampleRate / lowestFrequencyHz);
+    updatePeriodRange();
+
+    // Input buffers: large enough to hold samples for look-back
+    inputBufferSize = allocatedMaxPeriod * 8 + preparedBlockSize;
+    inputBuffers.assign (static_cast<size_t> (inputBufferSize * numChannels), 0.0f);
+    analysisBuffer.assign (static_cast<size_t> (inputBufferSize), 0.0f);
+
+    // Grain slots hold the longest (2-period) grain, per channel
+    grains.capacity = allocatedMaxPeriod * 2;
+    grains.samples.assign (static_cast<size_t> (grains.capacity * maxActiveGrains * numChannels), 0.0f);
+    grains.windows.assign (static_cast<size_t> (grains.capacity * maxActiveGrains), 0.0f);
+
+    // Accumulators cover one block plus the longest grain tail beyond it,
+    // for the lead and every harmony stream
+    outputAccumSize = juce::nextPowerOfTwo (preparedBlockSize + grains.capacity);
+    outputAccum.assign (static_cast<size_t> (outputAccumSize * numChannels * numStreams), 0.0f);
+    windowAccum.assign (static_cast<size_t> (outputAccumSize * numStreams), 0.0f);
+    harmonyGainStep = 1.0f / (harmonyFadeTime * static_cast<float> (sampleRate));
+
+    periodSmoothingCoeff = 1.0f - std::exp (-1.0f / (periodSmoothingTime * static_cast<float> (sampleRate)));
 
     reset();
 }
 
 void PsolaShifter::reset()
 {
-    std::fill (inputBuffer.begin(), inputBuffer.end(), 0.0f);
+    std::fill (inputBuffers.begin(), inputBuffers.end(), 0.0f);
+    std::fill (analysisBuffer.begin(), analysisBuffer.end(), 0.0f);
     inputWritePos = 0;
-    activeGrains.clear();
+    grainHead = 0;
+    numActiveGrains = 0;
+    std::fill (outputAccum.begin(), outputAccum.end(), 0.0f);
+    std::fill (windowAccum.begin(), windowAccum.end(), 0.0f);
+    outputReadPos = 0;
+    accumulatorDirty = false;
+
+    for (auto& harmony : harmonyStreams)
+    {
+        harmony.gain = 0.0f;
+        harmony.grainPhase = 1.0f;
+        harmony.live = false;
+    }
+
+    releasingHarmony = false;
     lastPeriod = 0.0f;
     grainPhase = 0.0f;
-    inputReadPosition = -1.0;
+    hasPitchMark = false;
     totalInputSamples = 0;
     totalOutputSamples = 0;
 }
 
+void PsolaShifter::setFrequencyRange (float minHz, float maxHz)
+{
+    minFrequencyHz = juce::jmax (lowestFrequencyHz, juce::jmin (minHz, maxHz));
+    maxFrequencyHz = juce::jmax (minFrequencyHz, juce::jmax (minHz, maxHz));
+    updatePeriodRange();
+}
+
+void PsolaShifter::updatePeriodRange() noexcept
+{
+    maxPeriodSamples = static_cast<int> (currentSampleRate / minFrequencyHz);
+    if (allocatedMaxPeriod > 0)
+        maxPeriodSamples = juce::jmin (maxPeriodSamples, allocatedMaxPeriod);
+
+    minPeriodSamples = juce::jlimit (1, maxPeriodSamples, static_cast<int> (currentSampleRate / maxFrequencyHz));
+
+    // Output runs a constant two longest periods behind the input: enough for
+    // a whole grain to be read before its first sample is due
+    latencySamples = maxPeriodSamples * 2;
+}
+
+void PsolaShifter::setHarmonyVoices (const HarmonyVoice* voices, int numVoices) noexcept
+{
+    for (int v = 0; v < maxHarmonyVoices; ++v)
+    {
+        auto& harmony = harmonyStreams[static_cast<size_t> (v)];
+
+        if (voices != nullptr && v < numVoices)
+        {
+            harmony.ratio = juce::jlimit (0.5f, 2.0f, voices[v].ratio);
+            harmony.targetGain = juce::jmax (0.0f, voices[v].gain);
+        }
+        else
+        {
+            harmony.targetGain = 0.0f;
+        }
+    }
+}
+
 void PsolaShifter::process (const float* input, float* output, int numSamples,
                             float pitchRatio, float detectedPeriod, float confidence)
 {
-    if (numSamples <= 0 || output == nullptr)
+    processInternal (input != nullptr ? &input : nullptr, &output, 1, numSamples, input,
+                     &pitchRatio, 0, detectedPeriod, confidence);
+}
+
+void PsolaShifter::process (const float* input, float* output, int numSamples,
+                            const float* pitchRatios, float detectedPeriod, float confidence)
+{
+    if (pitchRatios == nullptr)
+        process (input, output, numSamples, 1.0f, detectedPeriod, confidence);
+    else
+        processInternal (input != nullptr ? &input : nullptr, &output, 1, numSamples, input,
+                         pitchRatios, 1, detectedPeriod, confidence);
+}
+
+void PsolaShifter::process (const float* const* inputs, float* const* outputs, int channels, int numSamples,
+                            const float* pitchRatios, float detectedPeriod, float confidence,
+                            const float* analysisInput)
+{
+    float unity = 1.0f;
+    processInternal (inputs, outputs, channels, numSamples, analysisInput,
+                     pitchRatios != nullptr ? pitchRatios : &unity, pitchRatios != nullptr ? 1 : 0,
+                     detectedPeriod, confidence);
+}
+
+void PsolaShifter::processInternal (const float* const* inputs, float* const* outputs, int channels,
+                                    int numSamples, const float* analysisInput,
+                                    const float* pitchRatios, int ratioStride,
+                                    float detectedPeriod, float confidence)
+{
+    if (numSamples <= 0 || outputs == nullptr)
         return;
 
-    // Clamp pitch ratio
-    pitchRatio = juce::jlimit (0.5f, 2.0f, pitchRatio);
+    // Channels beyond those prepared are left untouched
+    jassert (channels <= numChannels);
+    channels = juce::jmin (channels, numChannels);
 
-    int inputBufSize = static_cast<int> (inputBuffer.size());
+    // The rings are sized for the prepared block; longer calls are split,
+    // which gives the same result since nothing depends on call size
+    for (int offset = 0; offset < numSamples; offset += preparedBlockSize)
+    {
+        int chunk = juce::jmin (preparedBlockSize, numSamples - offset);
+        processChunk (inputs, outputs, channels, offset, chunk,
+                      analysisInput != nullptr ? analysisInput + offset : nullptr,
+                      pitchRatios + offset * ratioStride, ratioStride, detectedPeriod, confidence);
+    }
+}
 
-    // Write input to circular buffer
-    if (input != nullptr)
+void PsolaShifter::processChunk (const float* const* inputs, float* const* outputs, int channels,
+                                 int offset, int numSamples, const float* analysisInput,
+                                 const float* pitchRatios, int ratioStride,
+                                 float detectedPeriod, float confidence)
+{
+    // Write input to the circular buffers (at most two runs each)
+    if (inputs != nullptr)
     {
-        for (int i = 0; i < numSamples; ++i)
+        int firstRun = juce::jmin (numSamples, inputBufferSize - inputWritePos);
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            const float* in = inputs[ch] + offset;
+            float* ring = getInputBuffer (ch);
+            std::copy_n (in, firstRun, ring + inputWritePos);
+            std::copy_n (in + firstRun, numSamples - firstRun, ring);
+        }
+
+        // Pitch marks come from the analysis signal: the caller's mono sum,
+        // or the mean of the channels
+        if (analysisInput != nullptr)
         {
-            inputBuffer[static_cast<size_t> (inputWritePos)] = input[i];
-            inputWritePos = (inputWritePos + 1) % inputBufSize;
+            std::copy_n (analysisInput, firstRun, analysisBuffer.data() + inputWritePos);
+            std::copy_n (analysisInput + firstRun, numSamples - firstRun, analysisBuffer.data());
         }
+        else
+        {
+            float gain = 1.0f / static_cast<float> (channels);
+            for (int i = 0; i < numSamples; ++i)
+            {
+                float sum = 0.0f;
+                for (int ch = 0; ch < channels; ++ch)
+                    sum += inputs[ch][offset + i];
+
+                analysisBuffer[static_cast<size_t> ((inputWritePos + i) % inputBufferSize)] = sum * gain;
+            }
+        }
+
+        inputWritePos = (inputWritePos + numSamples) % inputBufferSize;
         totalInputSamples += numSamples;
     }
 
-    // Clear output
-    std::fill (output, output + numSamples, 0.0f);
-
-    // If unvoiced or no pitch detected, pass through
+    // If unvoiced or no pitch detected, pass through with the same delay the
+    // grains get, so switching between the two stays time-aligned
     if (detectedPeriod <= 0.0f || confidence < 0.2f)
     {
-        if (input != nullptr)
+        int start = totalInputSamples - numSamples - latencySamples;
+        start = ((start % inputBufferSize) + inputBufferSize) % inputBufferSize;
+        int firstRun = juce::jmin (numSamples, inputBufferSize - start);
+
+        for (int ch = 0; ch < channels; ++ch)
         {
-            for (int i = 0; i < numSamples; ++i)
-                output[i] = input[i];
+            float* out = outputs[ch] + offset;
+            if (inputs == nullptr)
+            {
+                std::fill (out, out + numSamples, 0.0f);
+                continue;
+            }
+
+            const float* ring = getInputBuffer (ch);
+            std::copy_n (ring + start, firstRun, out);
+            std::copy_n (ring, numSamples - firstRun, out + firstRun);
+        }
+
+        // Sounding harmony voices fade out over harmonyFadeTime on grains at
+        // the last voiced period; only then is everything dropped
+        if (lastPeriod > 0.0f && isHarmonySounding())
+        {
+            releaseHarmony (outputs, channels, offset, numSamples);
+
+            if (isHarmonySounding())
+            {
+                totalOutputSamples += numSamples;
+                return;
+            }
         }
+
+        releasingHarmony = false;
         lastPeriod = 0.0f;
         grainPhase = 0.0f;
-        inputReadPosition = -1.0;
-        activeGrains.clear();
+        grainHead = 0;
+        numActiveGrains = 0;
+        clearAccumulator();
+
+        for (auto& harmony : harmonyStreams)
+        {
+            harmony.gain = 0.0f;
+            harmony.live = false;
+        }
+
         totalOutputSamples += numSamples;
         return;
     }
 
-    // Smooth period
-    float period = juce::jlimit (static_cast<float> (minPeriodSamples),
-                                  static_cast<float> (maxPeriodSamples),
-                                  detectedPeriod);
+    // Smooth period (per sample below, so the result does not depend on call size)
+    float targetPeriod = juce::jlimit (static_cast<float> (minPeriodSamples),
+                                       static_cast<float> (maxPeriodSamples),
+                                       detectedPeriod);
 
+    // A voice that was fading out carries on (the lead starts afresh)
+    releasingHarmony = false;
+
+    // Spawn on the first voiced sample
     if (lastPeriod <= 0.0f)
-        lastPeriod = period;
-    else
-        lastPeriod = lastPeriod * 0.9f + period * 0.1f;
+    {
+        lastPeriod = targetPeriod;
+        grainPhase = 1.0f;
+        hasPitchMark = false;
 
-    period = lastPeriod;
-    int periodInt = juce::jmax (minPeriodSamples, static_cast<int> (period + 0.5f));
-    int grainSize = periodInt * 2;
+        for (auto& harmony : harmonyStreams)
+            harmony.grainPhase = 1.0f;
+    }
 
     // ============================================================================
     // FORMANT-PRESERVING PSOLA - Duration-Preserving Pitch Shift
@@ -97,9 +275,9 @@ void PsolaShifter::process (const float* input, float* output, int numSamples,
     //
     // For realtime pitch correction with duration preservation:
     //
-    // Keep the analysis read position moving in real time (1 sample out per 1 sample in)
-    // so grain contents are not time-scaled (formants stay put). Pitch shifting is
-    // achieved only by changing the spacing of synthesis grains.
+    // Keep the analysis read position moving in real time (1 sample out per 1 sample in,
+    // latencySamples behind) so grain contents are not time-scaled (formants stay put).
+    // Pitch shifting is achieved only by changing the spacing of synthesis grains.
     //
     // For pitch UP (pitchRatio > 1):
     //   - Place grains closer together (period / pitchRatio)
@@ -108,141 +286,371 @@ void PsolaShifter::process (const float* input, float* output, int numSamples,
     // For pitch DOWN (pitchRatio < 1):
     //   - Place grains further apart
     //   - This skips cycles to lower the pitch
+    //
+    // The schedule below runs once; every channel gets the same grains.
+    // Harmony streams run their own schedules over the same pitch marks.
     // ============================================================================
 
-    float outputHop = period / pitchRatio;  // Grain output spacing
-    float phaseIncrement = 1.0f / outputHop;
+    for (int outSample = 0; outSample < numSamples; ++outSample)
+    {
+        lastPeriod += (targetPeriod - lastPeriod) * periodSmoothingCoeff;
+        float period = lastPeriod;
+        int periodInt = juce::jmax (minPeriodSamples, static_cast<int> (period + 0.5f));
+
+        // Grain output spacing is period / pitchRatio, so each output sample
+        // advances the spawn phase by pitchRatio / period
+        float pitchRatio = juce::jlimit (0.5f, 2.0f, pitchRatios[outSample * ratioStride]);
+        grainPhase += pitchRatio / period;
+
+        while (grainPhase >= 1.0f)
+        {
+            grainPhase -= 1.0f;
+
+            int slot = acquireGrain (channels, numSamples, outSample, periodInt, period);
+            if (slot >= 0)
+                addGrainToAccumulator (channels, slot, 0, outSample, leadStream);
+        }
+
+        scheduleHarmony (channels, numSamples, outSample, periodInt, period);
+    }
+
+    readAccumulator (outputs, channels, offset, numSamples);
+
+    retireFinishedGrains (totalOutputSamples + numSamples);
+    totalOutputSamples += numSamples;
+}
+
+void PsolaShifter::scheduleHarmony (int channels, int chunkSize, int outSample, int periodInt, float period)
+{
+    for (int v = 0; v < maxHarmonyVoices; ++v)
+    {
+        auto& harmony = harmonyStreams[static_cast<size_t> (v)];
+        if (harmony.gain <= 0.0f && getHarmonyTarget (harmony) <= 0.0f)
+            continue;
+
+        harmony.grainPhase += harmony.ratio / period;
+
+        while (harmony.grainPhase >= 1.0f)
+        {
+            harmony.grainPhase -= 1.0f;
+
+            int slot = acquireGrain (channels, chunkSize, outSample, periodInt, period);
+            if (slot >= 0)
+            {
+                addGrainToAccumulator (channels, slot, 0, outSample, 1 + v);
+                harmony.live = true;
+            }
+        }
+    }
+}
 
-    // Initialize input read position to current block start
-    if (inputReadPosition < 0.0)
+void PsolaShifter::releaseHarmony (float* const* outputs, int channels, int offset, int numSamples)
+{
+    // The lead is passed through dry meanwhile; its grains are dropped, and
+    // it spawns at once if the input turns voiced again
+    if (! releasingHarmony)
     {
-        inputReadPosition = static_cast<double> (totalInputSamples - numSamples);
+        releasingHarmony = true;
+        clearStream (leadStream);
         grainPhase = 1.0f;
     }
 
-    int outputBlockStart = totalOutputSamples;
-
+    int periodInt = juce::jmax (minPeriodSamples, static_cast<int> (lastPeriod + 0.5f));
     for (int outSample = 0; outSample < numSamples; ++outSample)
+        scheduleHarmony (channels, numSamples, outSample, periodInt, lastPeriod);
+
+    readAccumulator (outputs, channels, offset, numSamples);
+    retireFinishedGrains (totalOutputSamples + numSamples);
+}
+
+bool PsolaShifter::isHarmonySounding() const noexcept
+{
+    for (const auto& harmony : harmonyStreams)
+        if (harmony.live && harmony.gain > 0.0f)
+            return true;
+
+    return false;
+}
+
+int PsolaShifter::acquireGrain (int channels, int chunkSize, int outSample, int periodInt, float period)
+{
+    int grainSize = periodInt * 2;
+    int oldestAvailable = totalInputSamples - inputBufferSize;
+
+    // Grains may only use input up to the current sample, so the
+    // output does not depend on how the caller splits its blocks
+    int newestAvailable = totalInputSamples - chunkSize + outSample + 1;
+    int minCenter = oldestAvailable + grainSize / 2;
+    int maxCenter = newestAvailable - grainSize / 2;
+
+    if (maxCenter < minCenter)
+        return -1;
+
+    // A grain starting at this output sample is centred grainSize / 2
+    // later, which maps to that point latencySamples back in the input
+    int inputCenter = newestAvailable - latencySamples + grainSize / 2;
+    inputCenter = findPitchMark (juce::jlimit (minCenter, maxCenter, inputCenter), periodInt, period, minCenter, maxCenter);
+    int inputStart = inputCenter - grainSize / 2;
+
+    int outputPosition = totalOutputSamples + outSample;
+    retireFinishedGrains (outputPosition);
+
+    if (inputStart < oldestAvailable)
+        return -1;
+
+    // A cycle another stream already extracted is shared
+    for (int i = numActiveGrains - 1; i >= 0; --i)
+    {
+        int slot = getGrainSlot (i);
+        if (grains.centerPositions[static_cast<size_t> (slot)] == inputCenter
+            && grains.lengths[static_cast<size_t> (slot)] == grainSize)
+            return slot;
+    }
+
+    // Every grain is overlap-added when it is spawned, so a full arena can
+    // drop its oldest slot (only the lead alone never fills it)
+    if (numActiveGrains == maxActiveGrains)
     {
-        // Advance input read position in real time to preserve formants
-        inputReadPosition += 1.0;
+        grainHead = (grainHead + 1) % maxActiveGrains;
+        --numActiveGrains;
+    }
 
-        // Grain spawn phase
-        grainPhase += phaseIncrement;
+    spawnGrain (channels, inputStart, grainSize, inputCenter, outputPosition + grainSize / 2, period);
+    return getGrainSlot (numActiveGrains - 1);
+}
 
-        while (grainPhase >= 1.0f)
-        {
-            grainPhase -= 1.0f;
+void PsolaShifter::spawnGrain (int channels, int inputStart, int length, int inputCenter,
+                               int outputPosition, float period)
+{
+    jassert (numActiveGrains < maxActiveGrains && length <= grains.capacity);
 
-            int oldestAvailable = totalInputSamples - inputBufSize;
+    int slot = getGrainSlot (numActiveGrains++);
+    auto index = static_cast<size_t> (slot);
+    grains.lengths[index] = length;
+    grains.centerPositions[index] = inputCenter;
+    grains.outputPositions[index] = outputPosition;
+    grains.periods[index] = period;
 
-            int minCenter = oldestAvailable + grainSize / 2;
-            int maxCenter = totalInputSamples - grainSize / 2;
+    float* window = grains.windows.data() + slot * grains.capacity;
+    windowTables->fillHann (window, length);
 
-            if (maxCenter < minCenter)
-                continue;
+    // Copy straight out of each input ring (at most two runs), then window
+    int start = ((inputStart % inputBufferSize) + inputBufferSize) % inputBufferSize;
+    int firstRun = juce::jmin (length, inputBufferSize - start);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        const float* ring = getInputBuffer (ch);
+        float* samples = getGrainSamples (ch, slot);
+        std::copy_n (ring + start, firstRun, samples);
+        std::copy_n (ring, length - firstRun, samples + firstRun);
+        juce::FloatVectorOperations::multiply (samples, window, length);
+    }
+}
 
-            int inputCenter = static_cast<int> (inputReadPosition + 0.5);
-            inputCenter = juce::jlimit (minCenter, maxCenter, inputCenter);
-            inputCenter = alignToPeak (inputCenter, juce::jmax (1, periodInt / 2), minCenter, maxCenter);
-            int inputStart = inputCenter - grainSize / 2;
+void PsolaShifter::addGrainToAccumulator (int channels, int slot, int firstIndex, int outputOffset, int stream)
+{
+    int length = grains.lengths[static_cast<size_t> (slot)] - firstIndex;
+    if (length <= 0)
+        return;
+
+    const float* window = grains.windows.data() + slot * grains.capacity + firstIndex;
 
-            if (inputStart >= oldestAvailable)
+    // At most two contiguous runs around the end of the ring
+    int mask = outputAccumSize - 1;
+    int start = (outputReadPos + outputOffset) & mask;
+    int firstRun = juce::jmin (length, outputAccumSize - start);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        const float* samples = getGrainSamples (ch, slot) + firstIndex;
+        float* accum = getOutputAccum (stream, ch);
+        juce::FloatVectorOperations::add (accum + start, samples, firstRun);
+        juce::FloatVectorOperations::add (accum, samples + firstRun, length - firstRun);
+    }
+
+    float* windowSum = getWindowAccum (stream);
+    juce::FloatVectorOperations::add (windowSum + start, window, firstRun);
+    juce::FloatVectorOperations::add (windowSum, window + firstRun, length - firstRun);
+
+    accumulatorDirty = true;
+}
+
+void PsolaShifter::readAccumulator (float* const* outputs, int channels, int offset, int numSamples)
+{
+    int written = 0;
+
+    while (written < numSamples)
+    {
+        int run = juce::jmin (numSamples - written, outputAccumSize - outputReadPos);
+        float* windowSum = getWindowAccum (leadStream) + outputReadPos;
+
+        // While harmony is released the lead stream is empty and the output
+        // already holds the dry input
+        if (! releasingHarmony)
+        {
+            for (int ch = 0; ch < channels; ++ch)
             {
-                Grain grain;
-                grain.samples.resize (static_cast<size_t> (grainSize));
-                grain.window.resize (static_cast<size_t> (grainSize));
-                grain.outputPosition = outputBlockStart + outSample;
-                grain.centerPosition = inputCenter;
-                grain.period = period;
-
-                for (int i = 0; i < grainSize; ++i)
-                {
-                    int bufIdx = (inputStart + i) % inputBufSize;
-                    if (bufIdx < 0) bufIdx += inputBufSize;
-
-                    float sample = inputBuffer[static_cast<size_t> (bufIdx)];
-                    float window = getHannWindow (i, grainSize);
-                    grain.window[static_cast<size_t> (i)] = window;
-                    grain.samples[static_cast<size_t> (i)] = sample * window;
-                }
-
-                activeGrains.push_back (std::move (grain));
+                float* accum = getOutputAccum (leadStream, ch) + outputReadPos;
+                float* dest = outputs[ch] + offset + written;
+
+                // Select the divisor rather than the division so the loop vectorises
+                for (int i = 0; i < run; ++i)
+                    dest[i] = accum[i] / (windowSum[i] > 1.0e-6f ? windowSum[i] : 1.0f);
+
+                juce::FloatVectorOperations::clear (accum, run);
             }
+
+            juce::FloatVectorOperations::clear (windowSum, run);
         }
 
-        // Overlap-add
-        float outValue = 0.0f;
-        float windowSum = 0.0f;
-        int currentOutputIdx = outputBlockStart + outSample;
+        mixHarmony (outputs, channels, offset + written, run);
 
-        for (auto& grain : activeGrains)
+        written += run;
+        outputReadPos = (outputReadPos + run) & (outputAccumSize - 1);
+    }
+
+    // A voice that has faded out starts over on its next note
+    for (int v = 0; v < maxHarmonyVoices; ++v)
+    {
+        auto& harmony = harmonyStreams[static_cast<size_t> (v)];
+        if (harmony.live && harmony.gain <= 0.0f && getHarmonyTarget (harmony) <= 0.0f)
+        {
+            clearStream (1 + v);
+            harmony.live = false;
+            harmony.grainPhase = 1.0f;
+        }
+    }
+}
+
+void PsolaShifter::mixHarmony (float* const* outputs, int channels, int offset, int run)
+{
+    for (int v = 0; v < maxHarmonyVoices; ++v)
+    {
+        auto& harmony = harmonyStreams[static_cast<size_t> (v)];
+        float targetGain = getHarmonyTarget (harmony);
+        if (! harmony.live)
         {
-            int grainLen = static_cast<int> (grain.samples.size());
-            int grainStart = grain.outputPosition - grainLen / 2;
-            int relIdx = currentOutputIdx - grainStart;
+            // Nothing to hear yet, but the fade still runs
+            harmony.gain = targetGain > harmony.gain
+                ? juce::jmin (targetGain, harmony.gain + harmonyGainStep * static_cast<float> (run))
+                : juce::jmax (targetGain, harmony.gain - harmonyGainStep * static_cast<float> (run));
+            continue;
+        }
+
+        int stream = 1 + v;
+        float* windowSum = getWindowAccum (stream) + outputReadPos;
+        float startGain = harmony.gain;
 
-            if (relIdx >= 0 && relIdx < grainLen)
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            float* accum = getOutputAccum (stream, ch) + outputReadPos;
+            float* dest = outputs[ch] + offset;
+            float gain = startGain;
+
+            for (int i = 0; i < run; ++i)
             {
-                outValue += grain.samples[static_cast<size_t> (relIdx)];
-                windowSum += grain.window[static_cast<size_t> (relIdx)];
+                gain = targetGain > gain ? juce::jmin (targetGain, gain + harmonyGainStep)
+                                         : juce::jmax (targetGain, gain - harmonyGainStep);
+                dest[i] += gain * accum[i] / (windowSum[i] > 1.0e-6f ? windowSum[i] : 1.0f);
             }
+
+            juce::FloatVectorOperations::clear (accum, run);
+            harmony.gain = gain;
         }
 
-        if (windowSum > 1.0e-6f)
-            outValue /= windowSum;
+        juce::FloatVectorOperations::clear (windowSum, run);
+    }
+}
+
+void PsolaShifter::clearStream (int stream)
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::clear (getOutputAccum (stream, ch), outputAccumSize);
+
+    juce::FloatVectorOperations::clear (getWindowAccum (stream), outputAccumSize);
+}
 
-        output[outSample] = outValue;
+void PsolaShifter::clearAccumulator()
+{
+    if (accumulatorDirty)
+    {
+        std::fill (outputAccum.begin(), outputAccum.end(), 0.0f);
+        std::fill (windowAccum.begin(), windowAccum.end(), 0.0f);
+        accumulatorDirty = false;
     }
+}
 
-    // Cleanup finished grains
-    int blockEnd = totalOutputSamples + numSamples;
-    while (!activeGrains.empty())
+void PsolaShifter::retireFinishedGrains (int outputPosition) noexcept
+{
+    // Grains retire in spawn order from the head of the ring
+    while (numActiveGrains > 0)
     {
-        auto& front = activeGrains.front();
-        int grainLen = static_cast<int> (front.samples.size());
-        int grainEnd = front.outputPosition + grainLen / 2;
-        if (grainEnd <= blockEnd)
-            activeGrains.pop_front();
-        else
+        auto front = static_cast<size_t> (grainHead);
+        if (grains.outputPositions[front] + grains.lengths[front] / 2 > outputPosition)
             break;
+
+        grainHead = (grainHead + 1) % maxActiveGrains;
+        --numActiveGrains;
     }
+}
 
-    totalOutputSamples += numSamples;
+int PsolaShifter::getGrainSlot (int index) const noexcept
+{
+    return (grainHead + index) % maxActiveGrains;
 }
 
-float PsolaShifter::getHannWindow (int index, int size) const
+int PsolaShifter::findPitchMark (int target, int periodInt, float period, int minCenter, int maxCenter)
 {
-    if (size <= 1)
-        return 1.0f;
+    // Once a mark is placed, the next ones follow a whole number of periods
+    // on and are not realigned. Searching for the peak every cycle picks
+    // between similar maxima differently from cycle to cycle, which leaves
+    // the output rough (and a few cycles periodic) at short periods.
+    if (hasPitchMark)
+    {
+        double cycles = std::round ((target - lastPitchMark) / period);
+        double predicted = lastPitchMark + cycles * period;
+        int mark = static_cast<int> (std::round (predicted));
+
+        if (std::abs (cycles) <= maxPredictedCycles && mark >= minCenter && mark <= maxCenter)
+        {
+            lastPitchMark = predicted;
+            return mark;
+        }
+    }
 
-    float phase = static_cast<float> (index) / static_cast<float> (size - 1);
-    return 0.5f * (1.0f - std::cos (juce::MathConstants<float>::twoPi * phase));
+    // Keep aligning until the peak is on signal, so a phrase that starts
+    // from silence is not held to an arbitrary grid
+    int mark = alignToPeak (target, juce::jmax (1, periodInt / 2), minCenter, maxCenter);
+    lastPitchMark = mark;
+    hasPitchMark = analysisBuffer[static_cast<size_t> (((mark % inputBufferSize) + inputBufferSize) % inputBufferSize)] > 0.0f;
+    return mark;
 }
 
 int PsolaShifter::alignToPeak (int center, int searchRadius, int minCenter, int maxCenter) const
 {
-    if (inputBuffer.empty())
+    if (analysisBuffer.empty())
         return center;
 
-    int inputBufSize = static_cast<int> (inputBuffer.size());
+    int inputBufSize = inputBufferSize;
     int start = juce::jmax (center - searchRadius, minCenter);
     int end = juce::jmin (center + searchRadius, maxCenter);
 
     int bestPos = center;
-    float bestValue = -1.0f;
+    float bestValue = std::numeric_limits<float>::lowest();
 
+    // Signed maximum: the search spans one period, so this finds the same
+    // point in every cycle (an absolute peak could flip polarity between grains)
     for (int pos = start; pos <= end; ++pos)
     {
         int bufIdx = pos % inputBufSize;
         if (bufIdx < 0)
             bufIdx += inputBufSize;
 
-        float sample = inputBuffer[static_cast<size_t> (bufIdx)];
-        float magnitude = std::abs (sample);
-        if (magnitude > bestValue)
+        float sample = analysisBuffer[static_cast<size_t> (bufIdx)];
+        if (sample > bestValue)
         {
-            bestValue = magnitude;
+            bestValue = sample;
             bestPos = pos;
         }
     }
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
-#include <deque>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
 #include <vector>
 
+#include "PitchShifter.h"
+#include "WindowTables.h"
+
 /**
  * PSOLA (Pitch Synchronous Overlap Add) Pitch Shifter
  *
@@ -20,15 +24,25 @@
  *
  * Key advantage: Formants are preserved because we're not modifying the
  * spectral content of each grain, just repositioning them in time.
+ *
+ * Multichannel input is linked: pitch marks and the grain schedule are worked
+ * out once from a single analysis signal and applied to every channel, so a
+ * stereo image stays coherent and only the copy/window/add runs per channel.
+ *
+ * Harmony voices are extra synthesis streams with their own grain spacing
+ * and accumulators. Grains are extracted at the same aligned pitch marks for
+ * every stream, so a stream placing a grain on a cycle that another one
+ * already extracted reuses it; an extra voice costs its overlap-add, not
+ * another analysis.
  */
-class PsolaShifter
+class PsolaShifter : public PitchShifter
 {
 public:
     PsolaShifter();
-    ~PsolaShifter() = default;
+    ~PsolaShifter() override = default;
 
-    void prepare (double sampleRate, int maxBlockSize);
-    void reset();
+    void prepare (double sampleRate, int maxBlockSize, int numChannels = 1) override;
+    void reset() override;
 
     /**
      * Process audio with pitch shifting.
@@ -43,50 +57,167 @@ public:
     void process (const float* input, float* output, int numSamples,
                   float pitchRatio, float detectedPeriod, float confidence);
 
-    int getLatencySamples() const noexcept { return latencySamples; }
+    /**
+     * Same as above with one pitch ratio per sample, so the ratio can glide
+     * smoothly between analysis frames inside a block.
+     */
+    void process (const float* input, float* output, int numSamples,
+                  const float* pitchRatios, float detectedPeriod, float confidence);
+
+    /**
+     * Linked multichannel processing (in place is fine). Pitch marks and grain
+     * timing come from analysisInput, e.g. the mono sum the detector saw; when
+     * it is nullptr the mean of the channels is used.
+     *
+     * @param numChannels Channels to process, at most the number prepared
+     * @param pitchRatios One ratio per sample, or nullptr for unity
+     */
+    void process (const float* const* inputs, float* const* outputs, int numChannels, int numSamples,
+                  const float* pitchRatios, float detectedPeriod, float confidence,
+                  const float* analysisInput = nullptr) override;
+
+    /**
+     * Sets the pitch range to shift within. The longest period sets the
+     * latency (two periods), so a narrow, high range means a short delay.
+     * Never allocates; prepare() sizes everything for down to 20 Hz.
+     */
+    void setFrequencyRange (float minHz, float maxHz) override;
+
+    /** Constant delay from input to output, for both voiced and unvoiced audio. */
+    int getLatencySamples() const noexcept override { return latencySamples; }
+
+    /** Harmony voices fade out over harmonyFadeTime when the input turns unvoiced. */
+    void setHarmonyVoices (const HarmonyVoice* voices, int numVoices) noexcept override;
+    bool supportsHarmony() const noexcept override { return true; }
 
 private:
-    // Grain extraction and synthesis
-    struct Grain
+    // Grain arena: maxActiveGrains fixed slots of `capacity` samples in one
+    // contiguous block, stored structure-of-arrays. Slots are used as a ring
+    // (oldest at grainHead) so spawning is a copy into preallocated memory and
+    // overlap-add reads each grain as one contiguous run.
+    static constexpr int maxActiveGrains = 8;     // Ratio <= 2 keeps at most 5 grains live
+
+    // Output streams: the corrected signal, then the harmony voices
+    static constexpr int leadStream = 0;
+    static constexpr int numStreams = 1 + maxHarmonyVoices;
+
+    struct HarmonyStream
     {
-        std::vector<float> samples;
-        std::vector<float> window;    // Window values for overlap normalization
-        int centerPosition = 0;     // Position in input stream where grain was extracted
-        int outputPosition = 0;     // Target position in output stream
-        float period = 0.0f;        // Pitch period at extraction time
+        float ratio = 1.0f;
+        float targetGain = 0.0f;
+        float gain = 0.0f;              // Ramped toward targetGain while mixing
+        float grainPhase = 1.0f;
+        bool live = false;              // Has grains in its accumulator
     };
 
-    void extractGrain (int centerPos, float period);
-    void synthesizeGrains (float* output, int numSamples);
-    float getHannWindow (int index, int size) const;
+    struct GrainArena
+    {
+        std::vector<float> samples;                         // Windowed grain samples, channel- then slot-major
+        std::vector<float> windows;                         // Window values for overlap normalization (shared)
+        std::array<int, maxActiveGrains> lengths {};
+        std::array<int, maxActiveGrains> centerPositions {};    // Input-stream position of the grain centre
+        std::array<int, maxActiveGrains> outputPositions {};    // Output-stream position of the grain centre
+        std::array<float, maxActiveGrains> periods {};          // Pitch period at extraction time
+        int capacity = 0;                                   // Samples per slot
+    };
+
+    // ratioStride is 0 for a constant ratio, 1 for a per-sample curve
+    void processInternal (const float* const* inputs, float* const* outputs, int channels,
+                          int numSamples, const float* analysisInput,
+                          const float* pitchRatios, int ratioStride,
+                          float detectedPeriod, float confidence);
+    void processChunk (const float* const* inputs, float* const* outputs, int channels,
+                       int offset, int numSamples, const float* analysisInput,
+                       const float* pitchRatios, int ratioStride,
+                       float detectedPeriod, float confidence);
+
+    void scheduleHarmony (int channels, int chunkSize, int outSample, int periodInt, float period);
+    void releaseHarmony (float* const* outputs, int channels, int offset, int numSamples);
+    bool isHarmonySounding() const noexcept;
+    float getHarmonyTarget (const HarmonyStream& harmony) const noexcept
+    {
+        return releasingHarmony ? 0.0f : harmony.targetGain;
+    }
+
+    int acquireGrain (int channels, int chunkSize, int outSample, int periodInt, float period);
+    void spawnGrain (int channels, int inputStart, int length, int inputCenter, int outputPosition, float period);
+    void updatePeriodRange() noexcept;
+    int getGrainSlot (int index) const noexcept;
+    void retireFinishedGrains (int outputPosition) noexcept;
+    void addGrainToAccumulator (int channels, int slot, int firstIndex, int outputOffset, int stream);
+    void readAccumulator (float* const* outputs, int channels, int offset, int numSamples);
+    void mixHarmony (float* const* outputs, int channels, int offset, int run);
+    void clearAccumulator();
+    void clearStream (int stream);
+    int findPitchMark (int target, int periodInt, float period, int minCenter, int maxCenter);
     int alignToPeak (int center, int searchRadius, int minCenter, int maxCenter) const;
 
-    // Input buffer for grain extraction (circular)
-    std::vector<float> inputBuffer;
+    float* getInputBuffer (int channel) noexcept { return inputBuffers.data() + channel * inputBufferSize; }
+    float* getOutputAccum (int stream, int channel) noexcept
+    {
+        return outputAccum.data() + (stream * numChannels + channel) * outputAccumSize;
+    }
+    float* getWindowAccum (int stream) noexcept { return windowAccum.data() + stream * outputAccumSize; }
+    float* getGrainSamples (int channel, int slot) noexcept
+    {
+        return grains.samples.data() + (channel * maxActiveGrains + slot) * grains.capacity;
+    }
+
+    // Input buffers for grain extraction (circular, channel-major), plus the
+    // analysis signal pitch marks are aligned on
+    std::vector<float> inputBuffers;
+    std::vector<float> analysisBuffer;
+    int inputBufferSize = 0;
     int inputWritePos = 0;
-    int inputReadPos = 0;
+    int numChannels = 1;
 
-    // Output accumulator for overlap-add
+    // Grain-major overlap-add: each grain is added once into outputAccum and
+    // its window into windowAccum (power-of-two rings indexed from
+    // outputReadPos = the next output sample), then each block is normalised
+    // and cleared in one pass. outputAccum is per stream and channel; the
+    // window sum is per stream, the same for all channels.
     std::vector<float> outputAccum;
-    int outputWritePos = 0;
+    std::vector<float> windowAccum;
+    int outputAccumSize = 0;
     int outputReadPos = 0;
+    bool accumulatorDirty = false;
 
     // Active grains being synthesized
-    std::deque<Grain> activeGrains;
+    GrainArena grains;
+    int grainHead = 0;
+    int numActiveGrains = 0;
+
+    // Harmony voice pool (stream 1 + index)
+    std::array<HarmonyStream, maxHarmonyVoices> harmonyStreams {};
+    float harmonyGainStep = 0.0f;        // Per-sample gain ramp (full scale in harmonyFadeTime)
+    bool releasingHarmony = false;       // Unvoiced: voices fade out before grains are dropped
+
+    // Shared, immutable Hann tables (resolved in prepare)
+    const WindowTables* windowTables = nullptr;
 
     // Tracking
     double currentSampleRate = 44100.0;
+    int preparedBlockSize = 0;
     int latencySamples = 0;
     int maxPeriodSamples = 0;
     int minPeriodSamples = 0;
+    int allocatedMaxPeriod = 0;
+    float minFrequencyHz = 50.0f;
+    float maxFrequencyHz = 1000.0f;
 
     float lastPeriod = 0.0f;
+    float periodSmoothingCoeff = 0.0f;   // Per-sample one-pole toward the detected period
     float grainPhase = 0.0f;             // Phase accumulator for grain spawning (0-1)
-    double inputReadPosition = 0.0;      // Current read position in input stream
+    double lastPitchMark = 0.0;          // Input position of the last pitch mark, fractional
+    bool hasPitchMark = false;           // False until a mark is aligned to a peak on signal
     int totalInputSamples = 0;           // Total samples written to input buffer
     int totalOutputSamples = 0;          // Total samples output so far
 
     // Constants
     static constexpr int grainOverlapFactor = 2;  // Grains overlap by 50%
     static constexpr float unvoicedBlendTime = 0.01f; // 10ms crossfade for unvoiced
+    static constexpr float periodSmoothingTime = 0.1f; // Period smoother time constant (s)
+    static constexpr float lowestFrequencyHz = 20.0f;  // Matches the detector's floor
+    static constexpr float harmonyFadeTime = 0.01f;    // Harmony voice fade in/out (s)
+    static constexpr double maxPredictedCycles = 8.0;  // Further jumps realign to a peak
 };
@@ -10,8 +10,9 @@ void RetuneEngine::prepare (double sampleRate)
     currentSampleRate = sampleRate;
 
     // Initialize smoothers
-    float retuneTimeSeconds = settings.retuneSpeedMs / 1000.0f;
-    ratioSmoother.reset (sampleRate, juce::jmax (0.001, static_cast<double> (retuneTimeSeconds)));
+    float retuneTimeSeconds = juce::jmax (0.001f, settings.retuneSpeedMs / 1000.0f);
+    ratioRampSamples = juce::jmax (1, juce::roundToInt (retuneTimeSeconds * sampleRate));
+    ratioSmoother.reset (ratioRampSamples);
     ratioSmoother.setCurrentAndTargetValue (1.0f);
 
     targetSmoother.reset (sampleRate, 0.02);  // 20ms for target frequency changes
@@ -28,6 +29,7 @@ void RetuneEngine::reset()
     lastTargetFrequency = 0.0f;
     lastRatio = 1.0f;
     lastTargetNote = -1;
+    samplesSinceTarget = 0;
     vibratoPhase = 0.0f;
     detectedVibratoRate = 0.0f;
     detectedVibratoDepth = 0.0f;
@@ -36,23 +38,37 @@ void RetuneEngine::reset()
 
 void RetuneEngine::setSettings (const Settings& newSettings)
 {
+    // The new retune speed takes effect with the next target
     settings = newSettings;
-
-    // Update smoother time based on retune speed
-    float retuneTimeSeconds = juce::jmax (0.001f, settings.retuneSpeedMs / 1000.0f);
-    ratioSmoother.reset (currentSampleRate, static_cast<double> (retuneTimeSeconds));
 }
 
 float RetuneEngine::process (float detectedFrequency, float targetFrequency, int numSamples)
 {
-    if (detectedFrequency <= 0.0f || targetFrequency <= 0.0f)
+    setTarget (detectedFrequency, targetFrequency);
+
+    if (numSamples > 0)
     {
-        // No valid pitch - maintain last ratio or reset
-        if (numSamples > 0)
-            ratioSmoother.skip (numSamples);
-        return lastRatio;
+        ratioSmoother.skip (numSamples);
+        samplesSinceTarget += numSamples;
     }
 
+    return ratioSmoother.getCurrentValue();
+}
+
+void RetuneEngine::renderRatios (float* destination, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+        destination[i] = ratioSmoother.getNextValue();
+
+    samplesSinceTarget += numSamples;
+}
+
+void RetuneEngine::setTarget (float detectedFrequency, float targetFrequency)
+{
+    // No valid pitch - keep gliding toward the last target
+    if (detectedFrequency <= 0.0f || targetFrequency <= 0.0f)
+        return;
+
     // Detect note transitions
     float transitionFactor = detectNoteTransition (targetFrequency);
 
@@ -73,27 +89,49 @@ float RetuneEngine::process (float detectedFrequency, float targetFrequency, int
     if (transitionFactor > 0.5f)
     {
         // Smooth transition for note changes
-        float transitionTime = juce::jmap (settings.noteTransition, 0.0f, 1.0f, 0.005f, 0.15f);
-        ratioSmoother.reset (currentSampleRate, static_cast<double> (transitionTime));
+        setRatioTarget (ratio, getTransitionSeconds());
     }
     else
     {
         // Normal retune speed for within-note correction
-        float retuneTimeSeconds = juce::jmax (0.001f, settings.retuneSpeedMs / 1000.0f);
-        ratioSmoother.reset (currentSampleRate, static_cast<double> (retuneTimeSeconds));
+        setRatioTarget (ratio, juce::jmax (0.001f, settings.retuneSpeedMs / 1000.0f));
     }
 
-    ratioSmoother.setTargetValue (ratio);
-
-    // Skip samples and get final value
-    ratioSmoother.skip (numSamples);
-    lastRatio = ratioSmoother.getCurrentValue();
-
     // Update state
+    lastRatio = ratio;
     lastDetectedFrequency = detectedFrequency;
     lastTargetFrequency = targetFrequency;
+    samplesSinceTarget = 0;
+}
+
+void RetuneEngine::release()
+{
+    setRatioTarget (1.0f, getTransitionSeconds());
+}
+
+float RetuneEngine::getTransitionSeconds() const noexcept
+{
+    return juce::jmap (settings.noteTransition, 0.0f, 1.0f, 0.005f, 0.15f);
+}
 
-    return lastRatio;
+void RetuneEngine::setRatioTarget (float ratio, float rampSeconds)
+{
+    int rampSamples = juce::jmax (1, juce::roundToInt (rampSeconds * currentSampleRate));
+
+    if (rampSamples == ratioRampSamples && ratio == ratioSmoother.getTargetValue())
+        return;  // Already heading there; restarting would only slow the glide
+
+    // SmoothedValue::reset() snaps to the target, so carry the current value over
+    float current = ratioSmoother.getCurrentValue();
+
+    if (rampSamples != ratioRampSamples)
+    {
+        ratioSmoother.reset (rampSamples);
+        ratioRampSamples = rampSamples;
+    }
+
+    ratioSmoother.setCurrentAndTargetValue (current);
+    ratioSmoother.setTargetValue (ratio);
 }
 
 float RetuneEngine::getNextRatio()
@@ -136,8 +174,8 @@ float RetuneEngine::applyHumanize (float ratio)
     // Add subtle random micro-timing and pitch variations
     // Humanize adds natural imperfection to the robotic correction
 
-    // Slow LFO for drift (0.5-2 Hz)
-    humanizePhase += 1.5f / static_cast<float> (currentSampleRate) * 256.0f;
+    // Slow LFO for drift (0.5-2 Hz), advanced by the samples since the last target
+    humanizePhase += 1.5f / static_cast<float> (currentSampleRate) * static_cast<float> (samplesSinceTarget);
     if (humanizePhase > juce::MathConstants<float>::twoPi)
         humanizePhase -= juce::MathConstants<float>::twoPi;
 
@@ -33,12 +33,33 @@ public:
     void reset();
 
     /**
-     * Process pitch correction for one block.
+     * Sets a new correction target, typically once per analysis frame. The
+     * smoothed ratio carries on from where it is; nothing snaps.
      *
      * @param detectedFrequency Current detected pitch
      * @param targetFrequency Target pitch from scale mapper
-     * @param numSamples Number of samples in block
-     * @return Smoothed pitch ratio (output/input frequency ratio)
+     */
+    void setTarget (float detectedFrequency, float targetFrequency);
+
+    /**
+     * Glides the ratio back to 1 (no correction) over the note transition
+     * time, for frames with nothing to correct toward. The next setTarget()
+     * glides on from wherever this got to.
+     */
+    void release();
+
+    /**
+     * Renders the smoothed pitch ratio (output/input frequency ratio) for the
+     * next numSamples samples, one value per sample. The curve depends only
+     * on when setTarget() was called, not on how rendering is split.
+     */
+    void renderRatios (float* destination, int numSamples) noexcept;
+
+    /**
+     * Process pitch correction for one block: setTarget() followed by
+     * advancing numSamples.
+     *
+     * @return Smoothed pitch ratio at the end of the block
      */
     float process (float detectedFrequency, float targetFrequency, int numSamples);
 
@@ -47,6 +68,8 @@ public:
      */
     float getNextRatio();
 
+    float getCurrentRatio() const noexcept { return ratioSmoother.getCurrentValue(); }
+
     void setSettings (const Settings& newSettings);
     const Settings& getSettings() const noexcept { return settings; }
 
@@ -54,9 +77,12 @@ private:
     Settings settings;
     double currentSampleRate = 44100.0;
 
-    // Smoothing
+    // Smoothing. The ramp length is only changed through setRatioTarget(),
+    // which keeps the current value (SmoothedValue::reset() would snap it)
     juce::SmoothedValue<float> ratioSmoother;
     juce::SmoothedValue<float> targetSmoother;
+    int ratioRampSamples = 0;
+    int samplesSinceTarget = 0;         // Advances the humanize LFO between targets
 
     // State tracking
     float lastDetectedFrequency = 0.0f;
@@ -74,6 +100,8 @@ private:
     juce::Random random;
 
     // Helpers
+    void setRatioTarget (float ratio, float rampSeconds);
+    float getTransitionSeconds() const noexcept;
     float applyVibratoTracking (float detectedFreq, float targetFreq);
     float applyHumanize (float ratio);
     float detectNoteTransition (float targetFreq);
@@ -0,0 +1,347 @@
+#include "SpectralPeakShifter.h"
+#include <cmath>
+#include <algorithm>
+
+SpectralPeakShifter::SpectralPeakShifter()
+{
+}
+
+void SpectralPeakShifter::prepare (double sampleRate, int /*maxBlockSize*/, int channels)
+{
+    currentSampleRate = sampleRate;
+    numChannels = juce::jmax (1, channels);
+
+    // Frames between ~25 ms and ~100 ms; one FFT object per order so that
+    // setFrequencyRange() can switch without allocating
+    minFftOrder = juce::jmax (6, static_cast<int> (std::floor (std::log2 (sampleRate * 0.025))));
+    maxFftOrder = juce::jmax (minFftOrder, static_cast<int> (std::floor (std::log2 (sampleRate * 0.1))));
+    maxFftSize = 1 << maxFftOrder;
+
+    ffts.clear();
+    for (int order = 0; order <= maxFftOrder; ++order)
+        ffts.push_back (order >= minFftOrder ? std::make_unique<juce::dsp::FFT> (order) : nullptr);
+
+    inputRings.assign (static_cast<size_t> (maxFftSize * numChannels), 0.0f);
+    outputRings.assign (static_cast<size_t> (maxFftSize * numChannels), 0.0f);
+    spectra.assign (static_cast<size_t> (maxFftSize * 2 * numChannels), 0.0f);
+    synthesisFrame.assign (static_cast<size_t> (maxFftSize * 2), 0.0f);
+    window.assign (static_cast<size_t> (maxFftSize + 1), 0.0f);
+    power.assign (static_cast<size_t> (maxFftSize / 2 + 1), 0.0f);
+
+    // Peaks are at least three bins apart
+    maxPeaks = maxFftSize / 4 + 1;
+    peakBins.assign (static_cast<size_t> (maxPeaks), 0);
+    peakFrequencies.assign (static_cast<size_t> (maxPeaks), 0.0f);
+    regionStarts.assign (static_cast<size_t> (maxPeaks + 1), 0);
+    previousPeakBins.assign (static_cast<size_t> (maxPeaks), 0);
+    peakPhases.assign (static_cast<size_t> (maxPeaks * numStreams), 0.0f);
+    previousPeakPhases.assign (static_cast<size_t> (maxPeaks * numStreams), 0.0f);
+    peakShifts.assign (static_cast<size_t> (maxPeaks * numStreams), 0);
+    rotationsRe.assign (static_cast<size_t> (maxPeaks * numStreams), 0.0f);
+    rotationsIm.assign (static_cast<size_t> (maxPeaks * numStreams), 0.0f);
+
+    fftOrder = -1;
+    setFrequencyRange (minFrequencyHz, maxFrequencyHz);
+    reset();
+}
+
+void SpectralPeakShifter::reset()
+{
+    std::fill (inputRings.begin(), inputRings.end(), 0.0f);
+    std::fill (outputRings.begin(), outputRings.end(), 0.0f);
+    std::fill (previousPeakPhases.begin(), previousPeakPhases.end(), 0.0f);
+    ringPos = 0;
+    hopCounter = 0;
+    numPeaks = 0;
+    numPreviousPeaks = 0;
+}
+
+void SpectralPeakShifter::setFrequencyRange (float minHz, float maxHz)
+{
+    minFrequencyHz = juce::jmax (lowestFrequencyHz, juce::jmin (minHz, maxHz));
+    maxFrequencyHz = juce::jmax (minFrequencyHz, juce::jmax (minHz, maxHz));
+
+    if (ffts.empty())
+        return;
+
+    // Three periods of the lowest frequency resolve neighbouring harmonics
+    double longestPeriod = currentSampleRate / minFrequencyHz;
+    int order = static_cast<int> (std::ceil (std::log2 (3.0 * longestPeriod)));
+    setFftOrder (juce::jlimit (minFftOrder, maxFftOrder, order));
+}
+
+void SpectralPeakShifter::setFftOrder (int order)
+{
+    if (order == fftOrder)
+        return;
+
+    fftOrder = order;
+    fftSize = 1 << order;
+    hopSize = fftSize / overlapFactor;
+
+    // Periodic Hann: the first fftSize points of a symmetric fftSize + 1 window
+    WindowTables::getInstance().fillHann (window.data(), fftSize + 1);
+
+    // Hann * Hann at 75% overlap sums to a constant (1.5)
+    float windowSum = 0.0f;
+    for (int i = 0; i < fftSize; i += hopSize)
+        windowSum += window[static_cast<size_t> (i)] * window[static_cast<size_t> (i)];
+
+    overlapGain = 1.0f / windowSum;
+
+    reset();
+}
+
+void SpectralPeakShifter::setVoices (const Voice* newVoices, int numNewVoices) noexcept
+{
+    numVoices = juce::jlimit (1, maxVoices, numNewVoices);
+
+    for (int v = 0; v < numVoices; ++v)
+        voices[static_cast<size_t> (v)] = newVoices != nullptr && v < numNewVoices ? newVoices[v] : Voice {};
+}
+
+void SpectralPeakShifter::setHarmonyVoices (const HarmonyVoice* newVoices, int numNewVoices) noexcept
+{
+    for (int v = 0; v < maxHarmonyVoices; ++v)
+        harmonyVoices[static_cast<size_t> (v)] = newVoices != nullptr && v < numNewVoices ? newVoices[v] : HarmonyVoice {};
+}
+
+void SpectralPeakShifter::process (const float* const* inputs, float* const* outputs, int channels, int numSamples,
+                                   const float* pitchRatios, [[maybe_unused]] float detectedPeriod,
+                                   [[maybe_unused]] float confidence, [[maybe_unused]] const float* analysisInput)
+{
+    if (numSamples <= 0 || inputs == nullptr || outputs == nullptr)
+        return;
+
+    jassert (channels <= numChannels);
+    channels = juce::jmin (channels, numChannels);
+
+    int mask = fftSize - 1;
+
+    // Stream through the rings up to each hop boundary, where a frame is
+    // analysed and its shifted version overlap-added into the output ring
+    for (int offset = 0; offset < numSamples;)
+    {
+        int chunk = juce::jmin (numSamples - offset, hopSize - hopCounter);
+        int firstRun = juce::jmin (chunk, fftSize - ringPos);
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            // Input is consumed before output is written, so in place is fine
+            float* inputRing = getInputRing (ch);
+            float* outputRing = getOutputRing (ch);
+            const float* in = inputs[ch] + offset;
+            float* out = outputs[ch] + offset;
+
+            std::copy_n (in, firstRun, inputRing + ringPos);
+            std::copy_n (in + firstRun, chunk - firstRun, inputRing);
+
+            std::copy_n (outputRing + ringPos, firstRun, out);
+            std::copy_n (outputRing, chunk - firstRun, out + firstRun);
+            std::fill_n (outputRing + ringPos, firstRun, 0.0f);
+            std::fill_n (outputRing, chunk - firstRun, 0.0f);
+        }
+
+        ringPos = (ringPos + chunk) & mask;
+        hopCounter += chunk;
+        offset += chunk;
+
+        if (hopCounter == hopSize)
+        {
+            hopCounter = 0;
+            float frameRatio = pitchRatios != nullptr ? pitchRatios[offset - 1] : 1.0f;
+            processFrame (channels, frameRatio);
+        }
+    }
+}
+
+void SpectralPeakShifter::processFrame (int channels, float frameRatio)
+{
+    auto& fft = *ffts[static_cast<size_t> (fftOrder)];
+    int numBins = fftSize / 2 + 1;
+    int firstRun = fftSize - ringPos;
+
+    // Analysis: the input ring from ringPos is the frame, oldest first
+    std::fill_n (power.begin(), numBins, 0.0f);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        const float* ring = getInputRing (ch);
+        float* spectrum = getSpectrum (ch);
+
+        for (int i = 0; i < firstRun; ++i)
+            spectrum[i] = ring[ringPos + i] * window[static_cast<size_t> (i)];
+
+        for (int i = firstRun; i < fftSize; ++i)
+            spectrum[i] = ring[i - firstRun] * window[static_cast<size_t> (i)];
+
+        fft.performRealOnlyForwardTransform (spectrum, true);
+
+        for (int k = 0; k < numBins; ++k)
+            power[static_cast<size_t> (k)] += spectrum[2 * k] * spectrum[2 * k] + spectrum[2 * k + 1] * spectrum[2 * k + 1];
+    }
+
+    // Peaks and their shifts are decided once for all channels and voices
+    findPeaks();
+    collectStreams (frameRatio);
+    updatePeakPhases();
+
+    // Synthesis per channel: move each region to its peak's new frequency
+    int mask = fftSize - 1;
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        const float* spectrum = getSpectrum (ch);
+        float* frame = synthesisFrame.data();
+        std::fill_n (frame, fftSize * 2, 0.0f);
+
+        for (int s = 0; s < numActiveStreams; ++s)
+        {
+            int row = activeStreams[static_cast<size_t> (s)].row;
+
+            for (int p = 0; p < numPeaks; ++p)
+            {
+                auto index = static_cast<size_t> (row * maxPeaks + p);
+                int shift = peakShifts[index];
+                float rotRe = rotationsRe[index];
+                float rotIm = rotationsIm[index];
+
+                // Bins moved past DC or Nyquist are dropped
+                int first = juce::jmax (regionStarts[static_cast<size_t> (p)], -shift);
+                int last = juce::jmin (regionStarts[static_cast<size_t> (p + 1)], numBins - shift);
+
+                for (int k = first; k < last; ++k)
+                {
+                    float re = spectrum[2 * k];
+                    float im = spectrum[2 * k + 1];
+                    frame[2 * (k + shift)] += re * rotRe - im * rotIm;
+                    frame[2 * (k + shift) + 1] += re * rotIm + im * rotRe;
+                }
+            }
+        }
+
+        fft.performRealOnlyInverseTransform (frame);
+
+        float* outputRing = getOutputRing (ch);
+        for (int i = 0; i < fftSize; ++i)
+            outputRing[(ringPos + i) & mask] += frame[i] * window[static_cast<size_t> (i)] * overlapGain;
+    }
+}
+
+void SpectralPeakShifter::findPeaks() noexcept
+{
+    int numBins = fftSize / 2 + 1;
+    numPeaks = 0;
+
+    float loudest = *std::max_element (power.begin(), power.begin() + numBins);
+    if (loudest <= 1.0e-20f)
+    {
+        regionStarts[0] = 0;
+        return;
+    }
+
+    float peakFloor = loudest * std::pow (10.0f, peakFloorDb / 10.0f);
+
+    // A peak is louder than its four nearest neighbours
+    for (int k = 2; k < numBins - 2 && numPeaks < maxPeaks; ++k)
+    {
+        float p = power[static_cast<size_t> (k)];
+
+        if (p > peakFloor
+            && p > power[static_cast<size_t> (k - 1)] && p > power[static_cast<size_t> (k - 2)]
+            && p >= power[static_cast<size_t> (k + 1)] && p >= power[static_cast<size_t> (k + 2)])
+        {
+            // Parabolic refinement on log power
+            float a = std::log (power[static_cast<size_t> (k - 1)] + 1.0e-30f);
+            float b = std::log (p);
+            float c = std::log (power[static_cast<size_t> (k + 1)] + 1.0e-30f);
+            float denominator = a - 2.0f * b + c;
+            float offset = denominator < 0.0f ? 0.5f * (a - c) / denominator : 0.0f;
+
+            peakBins[static_cast<size_t> (numPeaks)] = k;
+            peakFrequencies[static_cast<size_t> (numPeaks)] = static_cast<float> (k) + juce::jlimit (-0.5f, 0.5f, offset);
+            ++numPeaks;
+        }
+    }
+
+    // Regions: each boundary is the quietest bin between two peaks
+    regionStarts[0] = 0;
+
+    for (int p = 1; p < numPeaks; ++p)
+    {
+        int boundary = peakBins[static_cast<size_t> (p - 1)] + 1;
+
+        for (int k = boundary + 1; k < peakBins[static_cast<size_t> (p)]; ++k)
+            if (power[static_cast<size_t> (k)] < power[static_cast<size_t> (boundary)])
+                boundary = k;
+
+        regionStarts[static_cast<size_t> (p)] = boundary;
+    }
+
+    regionStarts[static_cast<size_t> (numPeaks)] = numBins;
+}
+
+void SpectralPeakShifter::collectStreams (float frameRatio) noexcept
+{
+    // Voices follow the per-sample ratio; harmony voices are absolute and
+    // only synthesised while audible
+    numActiveStreams = 0;
+
+    for (int v = 0; v < numVoices; ++v)
+    {
+        const auto& voice = voices[static_cast<size_t> (v)];
+        activeStreams[static_cast<size_t> (numActiveStreams++)] = { v, frameRatio * voice.ratio, voice.gain };
+    }
+
+    for (int v = 0; v < maxHarmonyVoices; ++v)
+    {
+        const auto& harmony = harmonyVoices[static_cast<size_t> (v)];
+        if (harmony.gain > 0.0f)
+            activeStreams[static_cast<size_t> (numActiveStreams++)] = { maxVoices + v, harmony.ratio, harmony.gain };
+    }
+}
+
+void SpectralPeakShifter::updatePeakPhases() noexcept
+{
+    // A shift of delta bins advances the phase by delta * 2pi * hop / N per
+    // frame. The region moves by round (delta) bins; since the frame starts
+    // N/2 before its centre, that integer shift also needs (-1)^shift.
+    const float hopPhase = juce::MathConstants<float>::twoPi * static_cast<float> (hopSize) / static_cast<float> (fftSize);
+    const float pi = juce::MathConstants<float>::pi;
+    const float twoPi = juce::MathConstants<float>::twoPi;
+
+    int match = 0;
+
+    for (int p = 0; p < numPeaks; ++p)
+    {
+        // Continue the phase of the nearest peak of the previous frame
+        // (both lists are ascending, so the match only moves forward)
+        int bin = peakBins[static_cast<size_t> (p)];
+        while (match + 1 < numPreviousPeaks
+               && std::abs (previousPeakBins[static_cast<size_t> (match + 1)] - bin)
+                  <= std::abs (previousPeakBins[static_cast<size_t> (match)] - bin))
+            ++match;
+
+        for (int s = 0; s < numActiveStreams; ++s)
+        {
+            const auto& stream = activeStreams[static_cast<size_t> (s)];
+            float ratio = juce::jlimit (0.25f, 4.0f, stream.ratio);
+            float delta = (ratio - 1.0f) * peakFrequencies[static_cast<size_t> (p)];
+            int shift = juce::roundToInt (delta);
+
+            float previousPhase = numPreviousPeaks > 0 ? getPhaseRow (previousPeakPhases, stream.row)[match] : 0.0f;
+            float phase = std::remainder (previousPhase + hopPhase * delta, twoPi);
+            getPhaseRow (peakPhases, stream.row)[p] = phase;
+
+            float rotation = phase - pi * static_cast<float> (shift);
+            auto index = static_cast<size_t> (stream.row * maxPeaks + p);
+            peakShifts[index] = shift;
+            rotationsRe[index] = stream.gain * std::cos (rotation);
+            rotationsIm[index] = stream.gain * std::sin (rotation);
+        }
+    }
+
+    std::swap (peakPhases, previousPeakPhases);
+    std::swap (peakBins, previousPeakBins);
+    numPreviousPeaks = numPeaks;
+}
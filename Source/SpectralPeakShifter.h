@@ -0,0 +1,168 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "PitchShifter.h"
+#include "WindowTables.h"
+
+/**
+ * Spectral Peak Shifter
+ *
+ * The Laroche-Dolson peak-locked phase vocoder from
+ * docs/spectral_peak_vocoder.md. Pitch is shifted directly in the STFT
+ * domain: every spectral peak owns the bins around it (its region), and the
+ * whole region is moved to the peak's new frequency and rotated by a phase
+ * that accumulates the frequency change from frame to frame. Bins in a region
+ * share one rotation, which keeps them phase locked.
+ *
+ * Algorithm (Hann analysis and synthesis, 75% overlap):
+ * 1. Every hop, FFT the last fftSize samples of each channel
+ * 2. Peaks: bins louder than their four nearest neighbours in the summed
+ *    power of all channels, refined by parabolic interpolation; region
+ *    boundaries sit at the quietest bin between two peaks
+ * 3. Per peak and voice: delta = (ratio - 1) * peak frequency, the region
+ *    moves by round (delta) bins and is rotated by the accumulated phase
+ *    (continued from the nearest peak of the previous frame)
+ * 4. Inverse FFT, window and overlap-add
+ *
+ * The cost per frame is two FFTs per channel whatever the ratio, and extra
+ * voices (setVoices, or harmony voices at absolute ratios) only add the
+ * region copies: one analysis serves a chord.
+ * Formants move with the pitch, and the latency is one FFT frame.
+ */
+class SpectralPeakShifter : public PitchShifter
+{
+public:
+    /** One output voice: a pitch ratio on top of the per-sample ratio, and a gain. */
+    struct Voice
+    {
+        float ratio = 1.0f;
+        float gain = 1.0f;
+    };
+
+    static constexpr int maxVoices = 8;
+
+    SpectralPeakShifter();
+    ~SpectralPeakShifter() override = default;
+
+    void prepare (double sampleRate, int maxBlockSize, int numChannels = 1) override;
+    void reset() override;
+
+    /**
+     * The FFT spans about three periods of the lowest frequency (between
+     * ~25 and ~100 ms), so the range sets the frame size and the latency.
+     * Never allocates; changing the frame size restarts the shifter.
+     */
+    void setFrequencyRange (float minHz, float maxHz) override;
+
+    /**
+     * Synthesises every voice from the same analysis frame and mixes them.
+     * The ratio used for a frame is the per-sample ratio at the end of its
+     * hop times the voice ratio; detectedPeriod and confidence are unused,
+     * since unpitched audio is shifted by its peaks like anything else.
+     */
+    void process (const float* const* inputs, float* const* outputs, int numChannels, int numSamples,
+                  const float* pitchRatios, float detectedPeriod, float confidence,
+                  const float* analysisInput = nullptr) override;
+
+    /**
+     * Sets the voices synthesised from each frame (at most maxVoices). The
+     * default is a single voice at ratio 1 and unity gain. Never allocates.
+     */
+    void setVoices (const Voice* newVoices, int numNewVoices) noexcept;
+    int getNumVoices() const noexcept { return numVoices; }
+
+    /** One FFT frame. */
+    int getLatencySamples() const noexcept override { return fftSize; }
+
+    /** Harmony voices are extra streams at absolute ratios; gain changes fade over a frame. */
+    void setHarmonyVoices (const HarmonyVoice* newVoices, int numNewVoices) noexcept override;
+    bool supportsHarmony() const noexcept override { return true; }
+
+    int getFftSize() const noexcept { return fftSize; }
+
+private:
+    // Synthesis streams: the voices, then the harmony voices. Each has its
+    // own row of peak phases, shifts and rotations.
+    static constexpr int numStreams = maxVoices + maxHarmonyVoices;
+
+    struct ActiveStream
+    {
+        int row = 0;
+        float ratio = 1.0f;
+        float gain = 1.0f;
+    };
+
+    void processFrame (int channels, float frameRatio);
+    void findPeaks() noexcept;
+    void collectStreams (float frameRatio) noexcept;
+    void updatePeakPhases() noexcept;
+    void setFftOrder (int order);
+
+    float* getInputRing (int channel) noexcept { return inputRings.data() + channel * maxFftSize; }
+    float* getOutputRing (int channel) noexcept { return outputRings.data() + channel * maxFftSize; }
+    float* getSpectrum (int channel) noexcept { return spectra.data() + channel * maxFftSize * 2; }
+    float* getPhaseRow (std::vector<float>& phases, int row) noexcept { return phases.data() + row * maxPeaks; }
+
+    // One FFT per selectable order, created in prepare()
+    std::vector<std::unique_ptr<juce::dsp::FFT>> ffts;
+    int minFftOrder = 10;
+    int maxFftOrder = 12;
+    int fftOrder = 11;
+    int fftSize = 2048;
+    int hopSize = 512;
+    int maxFftSize = 0;
+
+    // Input and output rings (channel-major, fftSize long); the input ring
+    // holds the next frame, the output ring the overlap-add tail
+    std::vector<float> inputRings;
+    std::vector<float> outputRings;
+    int ringPos = 0;
+    int hopCounter = 0;
+    int numChannels = 1;
+
+    // Per-channel spectra (real-only transform layout, 2 * fftSize) and the
+    // synthesis frame they are shifted into
+    std::vector<float> spectra;
+    std::vector<float> synthesisFrame;
+    std::vector<float> window;        // Periodic Hann, fftSize
+    float overlapGain = 1.0f;         // 1 / sum of analysis * synthesis windows
+
+    // Peaks of the current frame, in ascending bin order
+    std::vector<float> power;
+    std::vector<int> peakBins;
+    std::vector<float> peakFrequencies;     // Refined, in bins
+    std::vector<int> regionStarts;          // First bin of each region; regionStarts[numPeaks] = end
+    std::vector<int> previousPeakBins;
+    int numPeaks = 0;
+    int numPreviousPeaks = 0;
+    int maxPeaks = 0;
+
+    // Accumulated phase per stream and peak (stream-major rows of maxPeaks),
+    // and the shift and rotation each region gets in the current frame
+    std::vector<float> peakPhases;
+    std::vector<float> previousPeakPhases;
+    std::vector<int> peakShifts;
+    std::vector<float> rotationsRe;
+    std::vector<float> rotationsIm;
+
+    std::array<Voice, maxVoices> voices {};
+    int numVoices = 1;
+    std::array<HarmonyVoice, maxHarmonyVoices> harmonyVoices {};
+    std::array<ActiveStream, numStreams> activeStreams {};
+    int numActiveStreams = 0;
+
+    double currentSampleRate = 44100.0;
+    float minFrequencyHz = 50.0f;
+    float maxFrequencyHz = 1000.0f;
+
+    // Constants
+    static constexpr int overlapFactor = 4;             // 75% overlap
+    static constexpr float peakFloorDb = -80.0f;        // Below the frame's loudest bin
+    static constexpr float lowestFrequencyHz = 20.0f;   // Matches the detector's floor
+};
@@ -0,0 +1,67 @@
+#include "WindowTables.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+#include <numeric>
+
+WindowTables::WindowTables()
+{
+    // Master Hann over [0, 1] sampled at hannTableSize + 1 points
+    for (int i = 0; i <= hannTableSize; ++i)
+    {
+        double phase = static_cast<double> (i) / hannTableSize;
+        hannTable[static_cast<size_t> (i)] = static_cast<float> (
+            0.5 * (1.0 - std::cos (juce::MathConstants<double>::twoPi * phase)));
+    }
+
+    hannTable[hannTableSize + 1] = 0.0f;
+
+    // Decimation filter (Hann-windowed sinc, cutoff at the decimated Nyquist)
+    double cutoff = 1.0 / (2.0 * decimationFactor);
+    int halfTaps = decimationTaps / 2;
+
+    for (int n = 0; n < decimationTaps; ++n)
+    {
+        double x = static_cast<double> (n - halfTaps);
+        double window = 0.5 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * n / (decimationTaps - 1));
+        double sinc = (n == halfTaps) ? 2.0 * cutoff
+                                      : std::sin (juce::MathConstants<double>::twoPi * cutoff * x)
+                                            / (juce::MathConstants<double>::pi * x);
+        decimationFilter[static_cast<size_t> (n)] = static_cast<float> (window * sinc);
+    }
+
+    // Normalize filter
+    float sum = std::accumulate (decimationFilter.begin(), decimationFilter.end(), 0.0f);
+    if (std::abs (sum) > 1e-6f)
+    {
+        for (auto& c : decimationFilter)
+            c /= sum;
+    }
+}
+
+const WindowTables& WindowTables::getInstance()
+{
+    static const WindowTables tables;
+    return tables;
+}
+
+void WindowTables::fillHann (float* dest, int length) const noexcept
+{
+    if (length <= 1)
+    {
+        if (length == 1)
+            dest[0] = 1.0f;
+        return;
+    }
+
+    float step = static_cast<float> (hannTableSize) / static_cast<float> (length - 1);
+
+    for (int i = 0; i < length; ++i)
+    {
+        float position = static_cast<float> (i) * step;
+        int index = juce::jmin (static_cast<int> (position), hannTableSize);
+        float frac = position - static_cast<float> (index);
+        float a = hannTable[static_cast<size_t> (index)];
+        float b = hannTable[static_cast<size_t> (index + 1)];
+        dest[i] = a + frac * (b - a);
+    }
+}
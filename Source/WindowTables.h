@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+
+/**
+ * Shared Window Tables
+ *
+ * Process-wide, immutable tables for the windows the DSP classes need, built
+ * once on first use so that no instance evaluates trig in prepare() or on the
+ * audio thread. Safe to read from any number of instances and threads.
+ *
+ * - Hann windows of any length are interpolated from one master table
+ *   (max error ~1e-7, below float resolution of the window itself).
+ * - The detector's decimate-by-8 lowpass is a fixed 33-tap windowed sinc.
+ *
+ * Call getInstance() from prepare() so construction never lands on the
+ * audio thread.
+ */
+class WindowTables
+{
+public:
+    static constexpr int decimationFactor = 8;
+    static constexpr int decimationTaps = 33;
+
+    static const WindowTables& getInstance();
+
+    /** Writes a symmetric Hann window (zero at both ends) of the given length. */
+    void fillHann (float* dest, int length) const noexcept;
+
+    /** Unity-gain lowpass for decimating by decimationFactor (symmetric taps). */
+    const float* getDecimationFilter() const noexcept { return decimationFilter.data(); }
+
+private:
+    WindowTables();
+
+    static constexpr int hannTableSize = 4096;
+
+    // One extra point for the closing zero and one guard for interpolation
+    std::array<float, hannTableSize + 2> hannTable {};
+    std::array<float, decimationTaps> decimationFilter {};
+};
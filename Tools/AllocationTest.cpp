@@ -0,0 +1,209 @@
+#include "../Source/PitchCorrectionEngine.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+//==============================================================================
+// Allocation hooks. While trapAllocations is set, every heap allocation or
+// release is counted. On glibc the malloc family itself is interposed, which
+// also catches JUCE's HeapBlock; elsewhere the global operator new/delete
+// are replaced instead.
+namespace
+{
+std::atomic<bool> trapAllocations { false };
+std::atomic<int> trappedAllocations { 0 };
+
+inline void noteAllocation() noexcept
+{
+    if (trapAllocations.load (std::memory_order_relaxed))
+        trappedAllocations.fetch_add (1, std::memory_order_relaxed);
+}
+}
+
+#if defined (__GLIBC__)
+extern "C"
+{
+void* __libc_malloc (size_t);
+void* __libc_calloc (size_t, size_t);
+void* __libc_realloc (void*, size_t);
+void __libc_free (void*);
+
+void* malloc (size_t size) noexcept              { noteAllocation(); return __libc_malloc (size); }
+void* calloc (size_t count, size_t size) noexcept { noteAllocation(); return __libc_calloc (count, size); }
+void* realloc (void* ptr, size_t size) noexcept  { noteAllocation(); return __libc_realloc (ptr, size); }
+void free (void* ptr) noexcept                   { if (ptr != nullptr) noteAllocation(); __libc_free (ptr); }
+}
+#else
+void* operator new (std::size_t size)
+{
+    noteAllocation();
+    if (auto* ptr = std::malloc (size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)                              { return operator new (size); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept   { noteAllocation(); return std::malloc (size == 0 ? 1 : size); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept { noteAllocation(); return std::malloc (size == 0 ? 1 : size); }
+void operator delete (void* ptr) noexcept                            { if (ptr != nullptr) noteAllocation(); std::free (ptr); }
+void operator delete[] (void* ptr) noexcept                          { operator delete (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept               { operator delete (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept             { operator delete (ptr); }
+#endif
+
+namespace
+{
+struct ScopedAllocationTrap
+{
+    ScopedAllocationTrap()  { trapAllocations.store (true); }
+    ~ScopedAllocationTrap() { trapAllocations.store (false); }
+};
+
+// 220 Hz tone gated on and off every 0.25 s, then a glide and noise, so the
+// run crosses voiced/unvoiced transitions, tracking lock and loss
+float makeSample (int index, double sampleRate, double& phase, juce::Random& random)
+{
+    double t = index / sampleRate;
+    bool gate = std::fmod (t, 0.5) < 0.25;
+
+    if (t < 2.0)
+    {
+        phase += juce::MathConstants<double>::twoPi * 220.0 / sampleRate;
+        return gate ? static_cast<float> (0.5 * std::sin (phase)) : 0.0f;
+    }
+
+    if (t < 3.0)
+    {
+        double frequency = 150.0 * std::pow (2.0, t - 2.0);
+        phase += juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        return static_cast<float> (0.5 * std::sin (phase));
+    }
+
+    return 0.2f * (random.nextFloat() - 0.5f);
+}
+
+// Runs the engine the way processBlock does (parameters, MIDI, process) and
+// returns the number of heap operations seen inside the audio callbacks
+int runEngine (double sampleRate, int preparedBlockSize, int hostBlockSize, int analysisHopSize,
+               PitchCorrectionEngine::ShifterMode shifterMode = PitchCorrectionEngine::ShifterMode::Quality,
+               int lookaheadSamples = 0)
+{
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, preparedBlockSize, 2);
+    engine.setAnalysisHopSize (analysisHopSize);
+    engine.setLookahead (lookaheadSamples);
+
+    PitchCorrectionEngine::Parameters params;
+    params.retuneSpeedMs = 0.0f;
+    params.transpose = 3;
+    params.shifterMode = shifterMode;
+    engine.setParameters (params);
+
+    const int totalSamples = static_cast<int> (sampleRate * 4.0);
+    juce::AudioBuffer<float> buffer (2, hostBlockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize (256);
+    juce::Random random (1234);
+    double phase = 0.0;
+
+    trappedAllocations.store (0);
+
+    for (int start = 0, block = 0; start < totalSamples; start += hostBlockSize, ++block)
+    {
+        int numSamples = juce::jmin (hostBlockSize, totalSamples - start);
+        buffer.setSize (2, numSamples, false, false, true);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float sample = makeSample (start + i, sampleRate, phase, random);
+            buffer.setSample (0, i, sample);
+            buffer.setSample (1, i, sample);
+        }
+
+        // Flip the input type and MIDI now and then, as automation would
+        params.inputType = (block / 50) % 2 == 0 ? PitchDetector::InputType::AltoTenor
+                                                  : PitchDetector::InputType::Soprano;
+        params.midiEnabled = (block / 80) % 2 == 1;
+        params.harmonyEnabled = (block / 60) % 2 == 1;
+
+        midi.clear();
+        if (block % 40 == 0)
+        {
+            midi.addEvent (juce::MidiMessage::noteOn (1, 60, 0.8f), 0);
+            midi.addEvent (juce::MidiMessage::noteOn (1, 64 + (block / 40) % 3, 0.8f), 0);
+        }
+        else if (block % 40 == 20)
+        {
+            midi.addEvent (juce::MidiMessage::noteOff (1, 60), 0);
+        }
+
+        ScopedAllocationTrap trap;
+        engine.setParameters (params);
+        engine.pushMidi (midi);
+        engine.process (buffer);
+    }
+
+    return trappedAllocations.load();
+}
+
+int runDetector (double sampleRate, int blockSize)
+{
+    PitchDetector detector;
+    detector.prepare (sampleRate, blockSize);
+
+    const int totalSamples = static_cast<int> (sampleRate * 4.0);
+    std::vector<float> block (static_cast<size_t> (blockSize));
+    juce::Random random (99);
+    double phase = 0.0;
+
+    trappedAllocations.store (0);
+
+    for (int start = 0; start < totalSamples; start += blockSize)
+    {
+        for (int i = 0; i < blockSize; ++i)
+            block[static_cast<size_t> (i)] = makeSample (start + i, sampleRate, phase, random);
+
+        ScopedAllocationTrap trap;
+        detector.process (block.data(), blockSize);
+    }
+
+    return trappedAllocations.load();
+}
+}
+
+int main()
+{
+    std::cout << "=== Audio Thread Allocation Test ===" << std::endl;
+    std::cout << "\nCase\t\t\t\t\tHeap ops in process()" << std::endl;
+    std::cout << "----\t\t\t\t\t---------------------" << std::endl;
+
+    bool passed = true;
+
+    auto report = [&passed] (const char* name, int allocations)
+    {
+        std::cout << name << "\t" << allocations << (allocations == 0 ? "" : "\t[FAIL]") << std::endl;
+        passed = passed && allocations == 0;
+    };
+
+    report ("Engine 44.1k, 512 blk, hop 128\t", runEngine (44100.0, 512, 512, 128));
+    report ("Engine 48k, 32 blk, hop 64\t", runEngine (48000.0, 32, 32, 64));
+    report ("Engine 96k, 2048 blk, hop 256\t", runEngine (96000.0, 2048, 2048, 256));
+    report ("Engine 44.1k, host exceeds prepared\t", runEngine (44100.0, 256, 4096, 128));
+    report ("Engine 48k, 256 blk, Eco shifter\t", runEngine (48000.0, 256, 256, 128,
+                                                             PitchCorrectionEngine::ShifterMode::Eco));
+    report ("Engine 48k, 256 blk, Spectral shifter", runEngine (48000.0, 256, 256, 128,
+                                                             PitchCorrectionEngine::ShifterMode::Spectral));
+    report ("Engine 44.1k, 512 blk, 100 ms lookahead", runEngine (44100.0, 512, 512, 128,
+                                                              PitchCorrectionEngine::ShifterMode::Quality, 4410));
+    report ("Detector 44.1k, 512 blk\t\t", runDetector (44100.0, 512));
+
+    std::cout << "\n=== Summary ===" << std::endl;
+    std::cout << (passed ? "PASS: process() is allocation-free"
+                         : "FAIL: heap use on the audio path") << std::endl;
+
+    return passed ? 0 : 1;
+}
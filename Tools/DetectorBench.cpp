@@ -0,0 +1,181 @@
+#include "../Source/PitchDetector.h"
+#include "../Source/PeriodKernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+struct InputTypeInfo
+{
+    PitchDetector::InputType type;
+    const char* name;
+    float testFrequency;
+};
+
+const InputTypeInfo inputTypes[] = {
+    { PitchDetector::InputType::Soprano,        "Soprano",      440.0f },
+    { PitchDetector::InputType::AltoTenor,      "AltoTenor",    220.0f },
+    { PitchDetector::InputType::LowMale,        "LowMale",      110.0f },
+    { PitchDetector::InputType::Instrument,     "Instrument",   330.0f },
+    { PitchDetector::InputType::BassInstrument, "BassInst",      55.0f }
+};
+
+// Harmonic-rich test tone so the search sees formant-like structure
+std::vector<float> makeTone (double sampleRate, float frequency, int numSamples)
+{
+    std::vector<float> signal (static_cast<size_t> (numSamples));
+    double phase = 0.0;
+    double increment = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+
+    for (auto& s : signal)
+    {
+        double value = 0.0;
+        for (int h = 1; h <= 8; ++h)
+            value += std::sin (phase * h) / h;
+
+        s = static_cast<float> (0.3 * value);
+        phase += increment;
+    }
+
+    return signal;
+}
+
+// Average microseconds per process() call with tracking disabled, so every
+// block runs the full coarse + fine search
+double timeFullSearch (const InputTypeInfo& info, double sampleRate, int blockSize,
+                       const std::vector<float>& signal, int& voicedBlocks)
+{
+    PitchDetector detector;
+    detector.setInputType (info.type);
+    detector.prepare (sampleRate, blockSize);
+    detector.setTrackingModeEnabled (false);
+
+    voicedBlocks = 0;
+    int numBlocks = static_cast<int> (signal.size()) / blockSize;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        if (detector.process (signal.data() + block * blockSize, blockSize).voiced)
+            ++voicedBlocks;
+    }
+
+    auto elapsed = std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start);
+    return elapsed.count() / numBlocks;
+}
+
+// Average nanoseconds per call of a period-scoring kernel at one lag
+template <typename Kernel>
+double timeKernel (Kernel&& kernel, const std::vector<float>& signal, int lag, double& sink)
+{
+    constexpr int iterations = 20000;
+    const float* current = signal.data() + signal.size() - static_cast<size_t> (lag);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto sums = kernel (current - lag, current, lag);
+        sink += sums.correlation;
+    }
+
+    auto elapsed = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start);
+    return elapsed.count() / iterations;
+}
+
+void runKernelBenchmark (const double* sampleRates, int numSampleRates)
+{
+    std::cout << "\n=== Period Scoring Kernel (active: " << PeriodKernels::getActiveKernelName()
+              << ") ===" << std::endl;
+    std::cout << "\nRate\tF0 Hz\tLag\tScalar ns/lag\tSIMD ns/lag\tSpeedup\tMax rel. error" << std::endl;
+    std::cout << "----\t-----\t---\t-------------\t-----------\t-------\t--------------" << std::endl;
+
+    const float frequencies[] = { 1000.0f, 440.0f, 220.0f, 110.0f, 55.0f };
+    double sink = 0.0;
+
+    for (int r = 0; r < numSampleRates; ++r)
+    {
+        double sampleRate = sampleRates[r];
+
+        for (auto frequency : frequencies)
+        {
+            int lag = static_cast<int> (sampleRate / frequency);
+            auto signal = makeTone (sampleRate, frequency, lag * 2);
+
+            double scalarNs = timeKernel (PeriodKernels::scoreSpansReference, signal, lag, sink);
+            double simdNs = timeKernel (PeriodKernels::scoreSpans, signal, lag, sink);
+
+            const float* current = signal.data() + lag;
+            auto reference = PeriodKernels::scoreSpansReference (signal.data(), current, lag);
+            auto vectorised = PeriodKernels::scoreSpans (signal.data(), current, lag);
+
+            auto relativeError = [] (double a, double b)
+            {
+                return std::abs (a - b) / juce::jmax (1.0e-12, std::abs (a));
+            };
+
+            double maxError = juce::jmax (relativeError (reference.previousEnergy, vectorised.previousEnergy),
+                                          relativeError (reference.currentEnergy, vectorised.currentEnergy),
+                                          relativeError (reference.correlation, vectorised.correlation));
+
+            std::cout << std::fixed << std::setprecision (1)
+                      << sampleRate / 1000.0 << "k\t"
+                      << frequency << "\t"
+                      << lag << "\t"
+                      << scalarNs << "\t\t"
+                      << simdNs << "\t\t"
+                      << std::setprecision (2) << scalarNs / simdNs << "x\t"
+                      << std::scientific << std::setprecision (1) << maxError
+                      << std::defaultfloat << std::endl;
+        }
+    }
+
+    if (sink == 0.0)
+        std::cout << std::endl;
+}
+}
+
+int main()
+{
+    std::cout << "=== PitchDetector Benchmark ===" << std::endl;
+
+    // An FFT cross-correlation filling every lag's E(L)/H(L) at once was
+    // tried here against the per-lag search: 0.25-0.6x its speed at every
+    // rate and range, BassInstrument included, since the per-lag loops are
+    // short next to the frame copy and decimation. Only the direct search
+    // remains.
+    std::cout << "\n=== Full Search (every block) ===" << std::endl;
+
+    constexpr int blockSize = 512;
+    const double sampleRates[] = { 44100.0, 48000.0, 96000.0 };
+
+    std::cout << "\nRate\tInput\t\tus/blk\tVoiced" << std::endl;
+    std::cout << "----\t-----\t\t------\t------" << std::endl;
+
+    for (auto sampleRate : sampleRates)
+    {
+        for (const auto& info : inputTypes)
+        {
+            auto signal = makeTone (sampleRate, info.testFrequency, static_cast<int> (sampleRate * 2.0));
+
+            int voiced = 0;
+            double us = timeFullSearch (info, sampleRate, blockSize, signal, voiced);
+
+            std::cout << std::fixed << std::setprecision (1)
+                      << sampleRate / 1000.0 << "k\t"
+                      << std::left << std::setw (12) << info.name << std::right << "\t"
+                      << us << "\t"
+                      << voiced << std::endl;
+        }
+    }
+
+    runKernelBenchmark (sampleRates, static_cast<int> (std::size (sampleRates)));
+
+    return 0;
+}
@@ -1,9 +1,957 @@
 #include "../Source/PitchCorrectionEngine.h"
+#include "../Source/PitchTrackFile.h"
+#include "../Source/PitchRefiner.h"
+#include "../Source/PsolaShifter.h"
 
 #include <cmath>
+#include <initializer_list>
 #include <iostream>
+#include <utility>
 #include <vector>
 
+namespace
+{
+// Amplitude of one frequency over a run of samples
+double measureTone (const std::vector<float>& signal, int start, int length, double frequency, double sampleRate)
+{
+    double re = 0.0, im = 0.0;
+    for (int i = 0; i < length; ++i)
+    {
+        double angle = juce::MathConstants<double>::twoPi * frequency * i / sampleRate;
+        re += signal[static_cast<size_t> (start + i)] * std::cos (angle);
+        im += signal[static_cast<size_t> (start + i)] * std::sin (angle);
+    }
+    return 2.0 * std::sqrt (re * re + im * im) / length;
+}
+
+// A harmonic voice gliding up a major third, jumping a fifth halfway, with
+// and without a DC offset: tracking mode must stay locked on the glide, be
+// at least as accurate as the full search alone (which can settle on the
+// common subharmonic after the jump), and relock within a few hops
+bool runTrackingModeTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int hopSize = 128;
+    constexpr int totalSamples = 3 * 44100;
+    constexpr int jumpSample = totalSamples / 2;
+    constexpr int settleSamples = 3 * hopSize;
+
+    struct Run
+    {
+        int frames = 0;
+        int lockedFrames = 0;
+        double maxErrorCents = 0.0;
+        double meanErrorCents = 0.0;
+        bool relocked = false;
+    };
+
+    auto detect = [&] (bool trackingMode, float dcOffset)
+    {
+        PitchDetector detector;
+        detector.prepare (sampleRate, hopSize);
+        detector.setInputType (PitchDetector::InputType::AltoTenor);
+        detector.setTrackingModeEnabled (trackingMode);
+
+        Run run;
+        std::vector<float> hop (hopSize);
+        double phase = 0.0, frequency = 0.0;
+
+        for (int start = 0; start < totalSamples; start += hopSize)
+        {
+            for (int i = 0; i < hopSize; ++i)
+            {
+                auto n = start + i;
+                frequency = 196.0 * std::pow (2.0, (4.0 / 12.0) * n / totalSamples) * (n >= jumpSample ? 1.5 : 1.0);
+                phase += juce::MathConstants<double>::twoPi * frequency / sampleRate;
+                hop[static_cast<size_t> (i)] = dcOffset + 0.4f * static_cast<float> (std::sin (phase) + 0.5 * std::sin (2.0 * phase)
+                                                                                     + 0.25 * std::sin (3.0 * phase));
+            }
+
+            detector.pushSamples (hop.data(), hopSize);
+            auto result = detector.analyse();
+            auto end = start + hopSize;
+            auto error = result.voiced ? std::abs (1200.0 * std::log2 (result.frequency / frequency)) : 1200.0;
+
+            // Just after the jump: a frame within settleSamples must be right
+            if (end > jumpSample && end <= jumpSample + settleSamples)
+            {
+                run.relocked = run.relocked || (error < 5.0 && (! trackingMode || detector.isTrackingLocked()));
+                continue;
+            }
+
+            // Warm-up and the frame straddling the jump are left out
+            if (end < 0.2 * sampleRate || (end > jumpSample - hopSize && end <= jumpSample + hopSize))
+                continue;
+
+            ++run.frames;
+            run.lockedFrames += detector.isTrackingLocked() ? 1 : 0;
+            run.maxErrorCents = juce::jmax (run.maxErrorCents, error);
+            run.meanErrorCents += error;
+        }
+
+        run.meanErrorCents /= juce::jmax (1, run.frames);
+        return run;
+    };
+
+    auto tracked = detect (true, 0.0f);
+    auto searched = detect (false, 0.0f);
+    auto trackedWithOffset = detect (true, 0.3f);
+
+    bool passed = tracked.lockedFrames > tracked.frames * 9 / 10 && searched.lockedFrames == 0
+        && tracked.maxErrorCents < 2.0 && tracked.meanErrorCents <= searched.meanErrorCents + 0.1
+        && trackedWithOffset.maxErrorCents < 2.0 && trackedWithOffset.lockedFrames == tracked.lockedFrames
+        && tracked.relocked && trackedWithOffset.relocked;
+
+    std::cout << "Tracked: locked " << tracked.lockedFrames << "/" << tracked.frames << " frames, error max "
+              << tracked.maxErrorCents << " mean " << tracked.meanErrorCents << " cents (full search mean "
+              << searched.meanErrorCents << "); with DC offset max " << trackedWithOffset.maxErrorCents
+              << "; relocked after jump: " << (tracked.relocked && trackedWithOffset.relocked ? "yes" : "no")
+              << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// 1.5 s of a 220 Hz voice in harmony mode with the given notes held
+std::vector<float> renderHarmony (PitchCorrectionEngine::ShifterMode mode, std::initializer_list<int> notes)
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int blockSize = 512;
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, blockSize);
+
+    PitchCorrectionEngine::Parameters params;
+    params.retuneSpeedMs = 0.0f;
+    params.shifterMode = mode;
+    params.harmonyEnabled = true;
+    params.harmonyLevel = 1.0f;
+    engine.setParameters (params);
+
+    juce::MidiBuffer midi;
+    for (auto note : notes)
+        midi.addEvent (juce::MidiMessage::noteOn (1, note, 0.8f), 0);
+
+    const int numBlocks = static_cast<int> (sampleRate * 1.5) / blockSize;
+    std::vector<float> output;
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    double phase = 0.0;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            buffer.setSample (0, i, static_cast<float> (0.5 * std::sin (phase)));
+            phase += juce::MathConstants<double>::twoPi * 220.0 / sampleRate;
+        }
+
+        engine.pushMidi (midi);
+        midi.clear();
+        engine.process (buffer);
+        output.insert (output.end(), buffer.getReadPointer (0), buffer.getReadPointer (0) + blockSize);
+    }
+
+    return output;
+}
+
+// Two held notes in harmony mode: the output should carry the lead plus one
+// voice per note
+bool runHarmonyTest (PitchCorrectionEngine::ShifterMode mode, const char* name)
+{
+    constexpr double sampleRate = 44100.0;
+    auto output = renderHarmony (mode, { 61, 64 });    // C#4 277.2 Hz, E4 329.6 Hz
+
+    int length = static_cast<int> (sampleRate * 0.5);
+    int start = static_cast<int> (output.size()) - length;
+    double lead = measureTone (output, start, length, 220.0, sampleRate);
+    double third = measureTone (output, start, length, 277.18, sampleRate);
+    double fifth = measureTone (output, start, length, 329.63, sampleRate);
+
+    bool passed = lead > 0.1 && third > 0.1 && fifth > 0.1;
+    std::cout << name << "\tlead " << lead << "\tC#4 " << third << "\tE4 " << fifth
+              << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// A 220 Hz voice held on one MIDI note in Eco mode: the cycle resampler
+// must land on the note, leave little of the input pitch behind and keep
+// the level through its cycle jumps and crossfades
+bool runEcoShiftTest (int note, const char* name)
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int blockSize = 512;
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, blockSize);
+
+    PitchCorrectionEngine::Parameters params;
+    params.retuneSpeedMs = 0.0f;
+    params.shifterMode = PitchCorrectionEngine::ShifterMode::Eco;
+    params.midiEnabled = true;
+    engine.setParameters (params);
+
+    juce::MidiBuffer midi;
+    midi.addEvent (juce::MidiMessage::noteOn (1, note, 0.8f), 0);
+
+    const int numBlocks = static_cast<int> (sampleRate * 1.5) / blockSize;
+    std::vector<float> output;
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    double phase = 0.0;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            buffer.setSample (0, i, static_cast<float> (0.5 * std::sin (phase)));
+            phase += juce::MathConstants<double>::twoPi * 220.0 / sampleRate;
+        }
+
+        engine.pushMidi (midi);
+        midi.clear();
+        engine.process (buffer);
+        output.insert (output.end(), buffer.getReadPointer (0), buffer.getReadPointer (0) + blockSize);
+    }
+
+    int length = static_cast<int> (sampleRate * 0.5);
+    int start = static_cast<int> (output.size()) - length;
+    auto target = static_cast<double> (ScaleMapper::midiToFrequency (static_cast<float> (note)));
+    double shifted = measureTone (output, start, length, target, sampleRate);
+    double original = measureTone (output, start, length, 220.0, sampleRate);
+
+    double energy = 0.0;
+    for (int i = start; i < start + length; ++i)
+        energy += static_cast<double> (output[static_cast<size_t> (i)]) * output[static_cast<size_t> (i)];
+    double rms = std::sqrt (energy / length);
+
+    // A 0.5 sine has an RMS of 0.354
+    bool passed = shifted > 0.4 && original < 0.05 && rms > 0.3 && rms < 0.4;
+    std::cout << name << "	" << target / 220.0 << "x	at " << target << " Hz " << shifted << "	at 220 Hz "
+              << original << "	RMS " << rms << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// Notes further than an octave from the voice are folded by octaves into
+// the shifters' ratio range (0.5 to 2): B5 over a 220 Hz voice sounds as
+// B3, D2 as D3, keeping the note name but not the octave
+bool runHarmonyFoldingTest()
+{
+    constexpr double sampleRate = 44100.0;
+    auto output = renderHarmony (PitchCorrectionEngine::ShifterMode::Quality, { 83, 38 });
+
+    int length = static_cast<int> (sampleRate * 0.5);
+    int start = static_cast<int> (output.size()) - length;
+    double foldedDown = measureTone (output, start, length, 246.94, sampleRate);
+    double foldedUp = measureTone (output, start, length, 146.83, sampleRate);
+    double asHeld = juce::jmax (measureTone (output, start, length, 987.77, sampleRate),
+                                measureTone (output, start, length, 73.42, sampleRate));
+
+    bool passed = foldedDown > 0.1 && foldedUp > 0.1 && asHeld < 0.02;
+    std::cout << "Folded\tB5 as B3 " << foldedDown << "\tD2 as D3 " << foldedUp
+              << "\tat the held octaves " << asHeld << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// A harmony voice on a steady tone, then the input turns unvoiced: the
+// lead passes through dry at once, while the voice fades out over the
+// shifter's 10 ms instead of being cut off
+bool runHarmonyReleaseTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int blockSize = 512;
+    constexpr int voicedBlocks = 40;
+    constexpr int unvoicedBlocks = 10;
+    constexpr float period = static_cast<float> (sampleRate / 220.0);
+
+    PsolaShifter shifter;
+    shifter.prepare (sampleRate, blockSize, 1);
+    shifter.setFrequencyRange (100.0f, 600.0f);
+    PitchShifter::HarmonyVoice voice { 1.25f, 1.0f };
+    shifter.setHarmonyVoices (&voice, 1);
+
+    std::vector<float> input, output;
+    std::vector<float> block (blockSize);
+    for (int b = 0; b < voicedBlocks + unvoicedBlocks; ++b)
+    {
+        for (int i = 0; i < blockSize; ++i)
+            block[static_cast<size_t> (i)] = static_cast<float> (0.5 * std::sin (juce::MathConstants<double>::twoPi * 220.0
+                                                                                 * static_cast<double> (b * blockSize + i) / sampleRate));
+
+        input.insert (input.end(), block.begin(), block.end());
+        bool voiced = b < voicedBlocks;
+        shifter.process (block.data(), block.data(), blockSize, 1.0f, voiced ? period : 0.0f, voiced ? 1.0f : 0.0f);
+        output.insert (output.end(), block.begin(), block.end());
+    }
+
+    // Unvoiced, the output is the delayed input plus whatever is left of the voice
+    int latency = shifter.getLatencySamples();
+    int release = voicedBlocks * blockSize;
+    int fadeEnd = release + static_cast<int> (0.012 * sampleRate);
+    float firstMs = 0.0f, afterFade = 0.0f;
+
+    for (int i = release; i < static_cast<int> (output.size()); ++i)
+    {
+        auto residual = std::abs (output[static_cast<size_t> (i)] - input[static_cast<size_t> (i - latency)]);
+        if (i < release + static_cast<int> (0.001 * sampleRate))
+            firstMs = juce::jmax (firstMs, residual);
+        else if (i >= fadeEnd)
+            afterFade = juce::jmax (afterFade, residual);
+    }
+
+    bool passed = firstMs > 0.1f && afterFade == 0.0f;
+    std::cout << "Voice after the input turns unvoiced: peak " << firstMs << " in the first ms, "
+              << afterFade << " after 12 ms" << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// Runs a 220 Hz voice in MIDI mode with notes at fixed absolute sample
+// positions, in host blocks of the given size
+std::vector<float> runMidiTiming (int blockSize, int lookaheadSamples = 0)
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int totalSamples = 44100;
+    const std::pair<int, juce::MidiMessage> events[] = {
+        { 10007, juce::MidiMessage::noteOn (1, 60, 0.8f) },
+        { 22051, juce::MidiMessage::noteOff (1, 60) },
+        { 22051, juce::MidiMessage::noteOn (1, 55, 0.8f) },
+        { 33333, juce::MidiMessage::noteOff (1, 55) }
+    };
+
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, blockSize);
+
+    PitchCorrectionEngine::Parameters params;
+    params.retuneSpeedMs = 0.0f;
+    params.midiEnabled = true;
+    engine.setParameters (params);
+    engine.setLookahead (lookaheadSamples);
+
+    std::vector<float> output;
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+    double phase = 0.0;
+
+    for (int start = 0; start < totalSamples; start += blockSize)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            buffer.setSample (0, i, static_cast<float> (0.5 * std::sin (phase)));
+            phase += juce::MathConstants<double>::twoPi * 220.0 / sampleRate;
+        }
+
+        midi.clear();
+        for (const auto& [position, message] : events)
+            if (position >= start && position < start + blockSize)
+                midi.addEvent (message, position - start);
+
+        engine.pushMidi (midi);
+        engine.process (buffer);
+        output.insert (output.end(), buffer.getReadPointer (0), buffer.getReadPointer (0) + blockSize);
+    }
+
+    output.resize (static_cast<size_t> (totalSamples));
+    return output;
+}
+
+// With lookahead, notes wait for their delayed audio, also while bypassed:
+// a note played during a bypass that ends before its audio comes out must
+// not be held yet when processing resumes, and must be once it has
+bool runMidiLookaheadBypassTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int blockSize = 64;
+    constexpr int lookaheadSamples = 4410;
+    constexpr int bypassStart = 690 * blockSize;            // Once the lookahead has primed
+    constexpr int noteOn = 50007;
+    constexpr int bypassEnd = 800 * blockSize;              // Before noteOn + lookahead
+
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, blockSize);
+    engine.setLookahead (lookaheadSamples);
+
+    PitchCorrectionEngine::Parameters params;
+    params.retuneSpeedMs = 0.0f;
+    params.midiEnabled = true;
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+    double phase = 0.0;
+    float targetAfterBypass = 0.0f, targetAfterNote = 0.0f;
+
+    for (int start = 0; start < 2 * noteOn; start += blockSize)
+    {
+        params.bypass = start >= bypassStart && start < bypassEnd;
+        engine.setParameters (params);
+
+        for (int i = 0; i < blockSize; ++i)
+        {
+            buffer.setSample (0, i, static_cast<float> (0.5 * std::sin (phase)));
+            phase += juce::MathConstants<double>::twoPi * 220.0 / sampleRate;
+        }
+
+        midi.clear();
+        if (noteOn >= start && noteOn < start + blockSize)
+            midi.addEvent (juce::MidiMessage::noteOn (1, 60, 0.8f), noteOn - start);
+
+        engine.pushMidi (midi);
+        engine.process (buffer);
+
+        if (start == bypassEnd + 4 * blockSize)
+            targetAfterBypass = engine.getLastTargetFrequency();
+    }
+
+    targetAfterNote = engine.getLastTargetFrequency();
+
+    auto middleC = ScaleMapper::midiToFrequency (60.0f);
+    bool passed = std::abs (targetAfterBypass - middleC) > 1.0f && std::abs (targetAfterNote - middleC) < 1.0f;
+    std::cout << "Target just after bypass " << targetAfterBypass << " Hz, after the delayed note "
+              << targetAfterNote << " Hz" << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// Runs a gliding voice with the legacy range and a slow retune, applying
+// the same parameters either once or before every block as the plugin used to
+std::vector<float> runParameterSnapshots (bool applyEveryBlock)
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int blockSize = 256;
+    constexpr int totalSamples = 44100;
+
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, blockSize);
+
+    PitchCorrectionEngine::Parameters params;
+    params.retuneSpeedMs = 120.0f;
+    params.rangeLowHz = 90.0f;
+    params.rangeHighHz = 500.0f;
+    engine.setParameters (params);
+
+    std::vector<float> output;
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    double phase = 0.0;
+
+    for (int start = 0; start < totalSamples; start += blockSize)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            double frequency = 200.0 + 40.0 * (start + i) / totalSamples;
+            buffer.setSample (0, i, static_cast<float> (0.5 * std::sin (phase)));
+            phase += juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        }
+
+        if (applyEveryBlock)
+            engine.setParameters (params);
+
+        engine.process (buffer);
+        output.insert (output.end(), buffer.getReadPointer (0), buffer.getReadPointer (0) + blockSize);
+    }
+
+    return output;
+}
+
+// Drains the analysis FIFO after a second of 220 Hz in blocks that do not
+// line up with the hop: one frame per hop, in order, with the pitch
+bool runAnalysisFifoTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int blockSize = 480;
+    constexpr int totalSamples = 44160;
+
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    double phase = 0.0;
+
+    for (int start = 0; start < totalSamples; start += blockSize)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            buffer.setSample (0, i, static_cast<float> (0.5 * std::sin (phase)));
+            phase += juce::MathConstants<double>::twoPi * 220.0 / sampleRate;
+        }
+
+        engine.process (buffer);
+    }
+
+    std::vector<AnalysisFifo::Frame> frames (AnalysisFifo::capacity);
+    int numFrames = engine.getAnalysisFifo().pop (frames.data(), AnalysisFifo::capacity);
+    int hopSize = engine.getAnalysisHopSize();
+
+    bool inOrder = true;
+    for (int i = 0; i < numFrames; ++i)
+        inOrder = inOrder && frames[static_cast<size_t> (i)].samplePosition == static_cast<std::int64_t> (i + 1) * hopSize;
+
+    const auto& last = frames[static_cast<size_t> (juce::jmax (0, numFrames - 1))];
+    bool passed = numFrames == totalSamples / hopSize && inOrder && std::abs (last.detectedFrequency - 220.0f) < 2.0f;
+
+    std::cout << "Frames: " << numFrames << " (expected " << totalSamples / hopSize << ")"
+              << ", last detected " << last.detectedFrequency << " Hz"
+              << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// A stereo voice stepping through three notes with vibrato
+juce::AudioBuffer<float> makeSteppedVoice (double sampleRate, int totalSamples)
+{
+    juce::AudioBuffer<float> voice (2, totalSamples);
+    double phase = 0.0;
+
+    for (int i = 0; i < totalSamples; ++i)
+    {
+        double note = 57.3 + 2.0 * (3 * i / totalSamples) + 0.3 * std::sin (juce::MathConstants<double>::twoPi * 5.5 * i / sampleRate);
+        phase += juce::MathConstants<double>::twoPi * 440.0 * std::pow (2.0, (note - 69.0) / 12.0) / sampleRate;
+        voice.setSample (0, i, static_cast<float> (0.5 * std::sin (phase)));
+        voice.setSample (1, i, static_cast<float> (0.3 * std::sin (phase + 0.5)));
+    }
+
+    return voice;
+}
+
+// Renders the voice in blocks that do not line up with the hop, detecting
+// or reading detection from a track
+juce::AudioBuffer<float> renderVoice (const juce::AudioBuffer<float>& voice, const PitchCorrectionEngine::Parameters& params,
+                                      const PitchTrackFile* track, std::int64_t trackStart = 0,
+                                      int lookaheadSamples = 0, int* latencySamples = nullptr)
+{
+    constexpr int blockSize = 500;
+
+    PitchCorrectionEngine engine;
+    engine.prepare (44100.0, blockSize, voice.getNumChannels());
+    engine.setParameters (params);
+    engine.setPitchTrack (track, trackStart);
+    engine.setLookahead (lookaheadSamples);
+
+    if (latencySamples != nullptr)
+        *latencySamples = engine.getLatencySamples();
+
+    juce::AudioBuffer<float> output (voice);
+    for (int start = 0; start < output.getNumSamples(); start += blockSize)
+    {
+        juce::AudioBuffer<float> block (output.getArrayOfWritePointers(), output.getNumChannels(), start,
+                                        juce::jmin (blockSize, output.getNumSamples() - start));
+        engine.process (block);
+    }
+
+    return output;
+}
+
+// Analyses the voice to a track file, then renders it with two retune
+// settings, once detecting and once from the track: the outputs must be
+// identical, and reading the track a hop out must not be. Damaged tracks
+// must be refused.
+bool runPitchTrackTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int totalSamples = 3 * 44100;
+    auto voice = makeSteppedVoice (sampleRate, totalSamples);
+
+    PitchCorrectionEngine::Parameters params;
+    params.scaleType = ScaleMapper::ScaleType::Major;
+    params.scale.type = PitchCorrectionEngine::Parameters::ScaleSettings::Type::Major;
+
+    juce::TemporaryFile trackFile (".ptrk");
+    PitchTrackFile::Analyser analyser;
+    analyser.prepare (params, sampleRate);
+
+    {
+        PitchTrackFile::Writer writer (trackFile.getFile().createOutputStream(), analyser.getSettings(),
+                                       PitchTrackFile::Source { totalSamples, 2, 0, 0 });
+        bool written = analyser.process (voice, writer) && analyser.processTail (2, writer) && writer.finish();
+        if (! written)
+        {
+            std::cout << "Couldn't write the track\t[FAIL]" << std::endl;
+            return false;
+        }
+    }
+
+    PitchTrackFile track;
+    auto opened = track.open (trackFile.getFile());
+    if (opened.failed())
+    {
+        std::cout << opened.getErrorMessage() << "\t[FAIL]" << std::endl;
+        return false;
+    }
+
+    auto tailSamples = juce::roundToInt (PitchTrackFile::Analyser::tailSeconds * sampleRate);
+    auto hopSize = PitchCorrectionEngine::defaultAnalysisHopSize;
+    auto expectedFrames = (totalSamples + (tailSamples + hopSize - 1) / hopSize * hopSize) / hopSize;
+    bool passed = track.getNumFrames() == expectedFrames && track.getSource().lengthInSamples == totalSamples;
+
+    int voicedFrames = 0;
+    for (std::int64_t i = 0; i < totalSamples / hopSize; ++i)
+        voicedFrames += track.getFrame (i).detection.voiced ? 1 : 0;
+
+    float maxDifference = 0.0f;
+    for (auto retuneSpeed : { 20.0f, 150.0f })
+    {
+        params.retuneSpeedMs = retuneSpeed;
+        auto detected = renderVoice (voice, params, nullptr);
+        auto fromTrack = renderVoice (voice, params, &track);
+
+        for (int ch = 0; ch < voice.getNumChannels(); ++ch)
+            for (int i = 0; i < totalSamples; ++i)
+                maxDifference = juce::jmax (maxDifference, std::abs (detected.getSample (ch, i) - fromTrack.getSample (ch, i)));
+    }
+
+    auto misaligned = renderVoice (voice, params, &track, hopSize);
+    auto detected = renderVoice (voice, params, nullptr);
+    float misalignedDifference = 0.0f;
+    for (int i = 0; i < totalSamples; ++i)
+        misalignedDifference = juce::jmax (misalignedDifference, std::abs (detected.getSample (0, i) - misaligned.getSample (0, i)));
+
+    passed = passed && maxDifference == 0.0f && misalignedDifference > 1.0e-3f
+        && voicedFrames > totalSamples / hopSize * 9 / 10;
+
+    // A track cut short, or one whose writer never finished, is refused
+    juce::MemoryBlock contents;
+    trackFile.getFile().loadFileAsData (contents);
+    juce::TemporaryFile damaged (".ptrk");
+    PitchTrackFile damagedTrack;
+
+    damaged.getFile().replaceWithData (contents.getData(), contents.getSize() - PitchTrackFile::recordSize);
+    bool truncatedRefused = damagedTrack.open (damaged.getFile()).failed();
+
+    juce::MemoryOutputStream unfinished;
+    unfinished.write (contents.getData(), contents.getSize());
+    unfinished.setPosition (16);
+    unfinished.writeInt64 (-1);
+    damaged.getFile().replaceWithData (unfinished.getData(), unfinished.getDataSize());
+    bool unfinishedRefused = damagedTrack.open (damaged.getFile()).failed();
+
+    passed = passed && truncatedRefused && unfinishedRefused;
+
+    std::cout << "Frames: " << track.getNumFrames() << " (expected " << expectedFrames << "), "
+              << voicedFrames << " voiced; max difference from detecting: " << maxDifference
+              << " (" << misalignedDifference << " a hop out)"
+              << "; damaged tracks refused: " << (truncatedRefused && unfinishedRefused ? "yes" : "no")
+              << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// Frames with an octave misread, a dropout, a late onset and a real octave
+// leap: the refiner must fix the first three and keep the leap
+bool runPitchRefinerTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int hopSize = PitchCorrectionEngine::defaultAnalysisHopSize;
+    constexpr int numFrames = 140;
+
+    auto voicedAt = [] (float frequency)
+    {
+        PitchDetector::Result frame;
+        frame.frequency = frequency;
+        frame.period = static_cast<float> (sampleRate) / frequency;
+        frame.confidence = 0.9f;
+        frame.voiced = true;
+        return frame;
+    };
+
+    // Unvoiced until 10, 220 Hz until 60 (misread at 25-27, lost at 40-41),
+    // then 440 Hz until 100
+    std::vector<PitchDetector::Result> frames (numFrames);
+    std::vector<float> expected (numFrames, 0.0f);
+    for (int i = 10; i < 100; ++i)
+    {
+        bool misread = i >= 25 && i < 28;
+        bool lost = i == 40 || i == 41;
+        auto frequency = i < 60 ? 220.0f : 440.0f;
+        frames[static_cast<size_t> (i)] = lost ? PitchDetector::Result {} : voicedAt (misread ? 440.0f : frequency);
+        expected[static_cast<size_t> (i)] = frequency;
+    }
+
+    PitchRefiner refiner;
+    refiner.prepare (sampleRate, hopSize, juce::roundToInt (0.1 * sampleRate / hopSize));
+
+    // The onset reaches back maxOnsetSeconds
+    auto onsetHops = juce::roundToInt (PitchRefiner::maxOnsetSeconds * sampleRate / hopSize);
+    for (int i = 10 - onsetHops; i < 10; ++i)
+        expected[static_cast<size_t> (i)] = 220.0f;
+
+    // Streamed through the window as the engine does
+    std::vector<PitchDetector::Result> window (static_cast<size_t> (refiner.getWindowSize()));
+    int wrongFrames = 0;
+    for (int i = 0; i < numFrames + refiner.getContextHops(); ++i)
+    {
+        std::copy (window.begin() + 1, window.end(), window.begin());
+        window.back() = i < numFrames ? frames[static_cast<size_t> (i)] : PitchDetector::Result {};
+
+        auto centre = i - refiner.getContextHops();
+        if (centre < 0)
+            continue;
+
+        auto decision = refiner.refine (window.data());
+        auto target = expected[static_cast<size_t> (centre)];
+        bool right = target > 0.0f ? decision.voiced && std::abs (decision.frequency - target) < 0.5f
+                                   : ! decision.voiced;
+        wrongFrames += right ? 0 : 1;
+    }
+
+    bool passed = wrongFrames == 0;
+    std::cout << "Frames decided wrongly: " << wrongFrames << " of " << numFrames
+              << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// Lookahead in the engine: streaming (delayed audio) and from a track must
+// render the same sound with every shifter, the stream only later by the
+// lookahead, and notes must be corrected from before their onsets rather
+// than after
+bool runLookaheadTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int totalSamples = 3 * 44100;
+    constexpr int noteSpacing = 22050;
+    constexpr int noteStart = 2000;
+    constexpr int lookaheadSamples = 4410;
+
+    PitchCorrectionEngine::Parameters params;
+    params.scaleType = ScaleMapper::ScaleType::Major;
+    params.scale.type = PitchCorrectionEngine::Parameters::ScaleSettings::Type::Major;
+
+    auto writeTrack = [&] (const juce::AudioBuffer<float>& voice, const juce::File& file)
+    {
+        PitchTrackFile::Analyser analyser;
+        analyser.prepare (params, sampleRate);
+        PitchTrackFile::Writer writer (file.createOutputStream(), analyser.getSettings(),
+                                       PitchTrackFile::Source { totalSamples, 2, 0, 0 });
+        return analyser.process (voice, writer) && analyser.processTail (2, writer) && writer.finish();
+    };
+
+    // The stepped voice sounding from the first sample, and cut into notes
+    // with silence between
+    auto voice = makeSteppedVoice (sampleRate, totalSamples);
+    auto notes = voice;
+    for (int ch = 0; ch < notes.getNumChannels(); ++ch)
+        for (int i = 0; i < totalSamples; ++i)
+            if (i % noteSpacing < noteStart)
+                notes.setSample (ch, i, 0.0f);
+
+    juce::TemporaryFile voiceTrackFile (".ptrk"), notesTrackFile (".ptrk");
+    PitchTrackFile voiceTrack, track;
+    if (! writeTrack (voice, voiceTrackFile.getFile()) || ! writeTrack (notes, notesTrackFile.getFile())
+        || voiceTrack.open (voiceTrackFile.getFile()).failed() || track.open (notesTrackFile.getFile()).failed())
+    {
+        std::cout << "Couldn't write the tracks\t[FAIL]" << std::endl;
+        return false;
+    }
+
+    int realtimeLatency = 0, streamedLatency = 0, trackLatency = 0;
+    bool latencyRight = true;
+    float maxDifference = 0.0f;
+
+    for (auto mode : { PitchCorrectionEngine::ShifterMode::Quality, PitchCorrectionEngine::ShifterMode::Eco,
+                       PitchCorrectionEngine::ShifterMode::Spectral })
+    {
+        params.shifterMode = mode;
+        renderVoice (voice, params, nullptr, 0, 0, &realtimeLatency);
+        auto streamed = renderVoice (voice, params, nullptr, 0, lookaheadSamples, &streamedLatency);
+        auto fromTrack = renderVoice (voice, params, &voiceTrack, 0, lookaheadSamples, &trackLatency);
+
+        latencyRight = latencyRight && trackLatency == realtimeLatency
+                    && streamedLatency >= realtimeLatency + lookaheadSamples;
+
+        auto delay = streamedLatency - trackLatency;
+        for (int ch = 0; ch < voice.getNumChannels(); ++ch)
+            for (int i = 0; i + delay < totalSamples; ++i)
+                maxDifference = juce::jmax (maxDifference, std::abs (streamed.getSample (ch, i + delay) - fromTrack.getSample (ch, i)));
+    }
+
+    params.shifterMode = PitchCorrectionEngine::ShifterMode::Quality;
+
+    // Where each note's correction starts, from the frames the track render
+    // publishes (frame n drives the hop starting at its sample position)
+    auto meanCorrectionStart = [&] (int lookahead)
+    {
+        constexpr int blockSize = 500;
+        PitchCorrectionEngine engine;
+        engine.prepare (sampleRate, blockSize, notes.getNumChannels());
+        engine.setParameters (params);
+        engine.setPitchTrack (&track);
+        engine.setLookahead (lookahead);
+
+        juce::AudioBuffer<float> output (notes);
+        std::int64_t lastOnset = -1;
+        double totalMs = 0.0;
+        int numNotes = 0;
+
+        for (int start = 0; start < totalSamples; start += blockSize)
+        {
+            juce::AudioBuffer<float> block (output.getArrayOfWritePointers(), output.getNumChannels(), start,
+                                            juce::jmin (blockSize, totalSamples - start));
+            engine.process (block);
+
+            AnalysisFifo::Frame frame;
+            while (engine.getAnalysisFifo().pop (&frame, 1) == 1)
+            {
+                auto onset = frame.samplePosition / noteSpacing * noteSpacing + noteStart;
+                if (frame.targetFrequency > 0.0f && onset != lastOnset && frame.samplePosition > onset - noteStart / 2)
+                {
+                    lastOnset = onset;
+                    totalMs += 1000.0 * static_cast<double> (frame.samplePosition - onset) / sampleRate;
+                    ++numNotes;
+                }
+            }
+        }
+
+        return numNotes > 0 ? totalMs / numNotes : 1000.0;
+    };
+
+    auto realtimeStart = meanCorrectionStart (0);
+    auto lookaheadStart = meanCorrectionStart (lookaheadSamples);
+
+    bool passed = latencyRight && maxDifference == 0.0f && realtimeStart > 0.0 && lookaheadStart <= 0.0;
+
+    std::cout << "Streaming adds " << streamedLatency - realtimeLatency << " samples of latency, a track "
+              << trackLatency - realtimeLatency << "; max difference streamed vs track: " << maxDifference
+              << "; correction starts " << realtimeStart << " ms after onsets realtime, "
+              << lookaheadStart << " ms with lookahead" << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// Renders from a pitch track, so detection stays put while channel 0
+// changes: linked, channel 1 follows the marks of the mix and changes too;
+// unlinked it is marked on its own and must not change a sample. Identical
+// channels must render the same either way.
+bool runStereoLinkTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int totalSamples = 2 * 44100;
+    auto voice = makeSteppedVoice (sampleRate, totalSamples);
+
+    PitchCorrectionEngine::Parameters params;
+    params.scaleType = ScaleMapper::ScaleType::Major;
+    params.scale.type = PitchCorrectionEngine::Parameters::ScaleSettings::Type::Major;
+
+    juce::TemporaryFile trackFile (".ptrk");
+    PitchTrackFile::Analyser analyser;
+    analyser.prepare (params, sampleRate);
+
+    {
+        PitchTrackFile::Writer writer (trackFile.getFile().createOutputStream(), analyser.getSettings(),
+                                       PitchTrackFile::Source { totalSamples, 2, 0, 0 });
+        if (! (analyser.process (voice, writer) && analyser.processTail (2, writer) && writer.finish()))
+        {
+            std::cout << "Couldn't write the track\t[FAIL]" << std::endl;
+            return false;
+        }
+    }
+
+    PitchTrackFile track;
+    if (track.open (trackFile.getFile()).failed())
+    {
+        std::cout << "Couldn't open the track\t[FAIL]" << std::endl;
+        return false;
+    }
+
+    // Channel 0 flipped moves the mix's peaks; channel 1 stays the same
+    auto flipped = voice;
+    flipped.applyGain (0, 0, totalSamples, -1.0f);
+
+    auto dualMono = voice;
+    dualMono.copyFrom (1, 0, voice, 0, 0, totalSamples);
+
+    auto maxDifference = [] (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b, int channel)
+    {
+        float difference = 0.0f;
+        for (int i = 0; i < a.getNumSamples(); ++i)
+            difference = juce::jmax (difference, std::abs (a.getSample (channel, i) - b.getSample (channel, i)));
+        return difference;
+    };
+
+    params.linkChannels = true;
+    auto linkedChange = maxDifference (renderVoice (voice, params, &track), renderVoice (flipped, params, &track), 1);
+    auto linkedSame = renderVoice (dualMono, params, &track);
+
+    params.linkChannels = false;
+    auto unlinkedChange = maxDifference (renderVoice (voice, params, &track), renderVoice (flipped, params, &track), 1);
+    auto unlinkedSame = renderVoice (dualMono, params, &track);
+
+    auto sameDifference = juce::jmax (maxDifference (linkedSame, unlinkedSame, 0), maxDifference (linkedSame, unlinkedSame, 1));
+    bool passed = linkedChange > 1.0e-3f && unlinkedChange == 0.0f && sameDifference == 0.0f;
+
+    std::cout << "Channel 1 change when channel 0 flips: linked " << linkedChange << ", unlinked " << unlinkedChange
+              << "; identical channels, linked vs unlinked: " << sameDifference
+              << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+
+// Processes the voice, then switches Bypass on mid-render: from the first
+// bypassed block the output must be the input delayed by exactly the
+// reported latency, lookahead included, so host delay compensation keeps
+// the track in place
+bool runBypassTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int totalSamples = 44100;
+    constexpr int blockSize = 500;
+    constexpr int bypassBlock = 40;
+    auto voice = makeSteppedVoice (sampleRate, totalSamples);
+
+    bool passed = true;
+    for (auto [type, lookahead] : { std::pair { PitchDetector::InputType::AltoTenor, 0 },
+                                    std::pair { PitchDetector::InputType::BassInstrument, 4410 } })
+    {
+        PitchCorrectionEngine::Parameters params;
+        params.inputType = type;
+
+        PitchCorrectionEngine engine;
+        engine.prepare (sampleRate, blockSize, voice.getNumChannels());
+        engine.setParameters (params);
+        engine.setLookahead (lookahead);
+        auto latency = engine.getLatencySamples();
+
+        juce::AudioBuffer<float> output (voice);
+        for (int block = 0; block * blockSize < totalSamples; ++block)
+        {
+            params.bypass = block >= bypassBlock;
+            engine.setParameters (params);
+
+            juce::AudioBuffer<float> view (output.getArrayOfWritePointers(), output.getNumChannels(), block * blockSize,
+                                           juce::jmin (blockSize, totalSamples - block * blockSize));
+            engine.process (view);
+        }
+
+        float maxError = 0.0f;
+        for (int ch = 0; ch < voice.getNumChannels(); ++ch)
+            for (int i = bypassBlock * blockSize; i < totalSamples; ++i)
+                maxError = juce::jmax (maxError, std::abs (output.getSample (ch, i) - voice.getSample (ch, i - latency)));
+
+        passed = passed && maxError == 0.0f;
+        std::cout << "Latency " << latency << " samples: bypassed output vs delayed input, max error " << maxError
+                  << (maxError == 0.0f ? "" : "\t[FAIL]") << std::endl;
+    }
+
+    return passed;
+}
+
+// A correction followed by a frame with nothing to correct: the ratio must
+// glide back to 1 over the note transition, never step
+bool runRetuneReleaseTest()
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int numSamples = 4410;
+
+    RetuneEngine retune;
+    RetuneEngine::Settings settings;
+    settings.retuneSpeedMs = 0.0f;
+    retune.setSettings (settings);
+    retune.prepare (sampleRate);
+
+    std::vector<float> ratios (2 * numSamples);
+    retune.setTarget (220.0f, 246.94f);
+    retune.renderRatios (ratios.data(), numSamples);
+    retune.release();
+    retune.renderRatios (ratios.data() + numSamples, numSamples);
+
+    float maxStep = 0.0f;
+    for (int i = numSamples; i < 2 * numSamples; ++i)
+        maxStep = juce::jmax (maxStep, std::abs (ratios[static_cast<size_t> (i)] - ratios[static_cast<size_t> (i - 1)]));
+
+    bool passed = std::abs (ratios[numSamples - 1] - 246.94f / 220.0f) < 1.0e-4f
+               && ratios.back() == 1.0f && maxStep < 1.0e-3f;
+
+    std::cout << "Released from " << ratios[numSamples - 1] << " to " << ratios.back()
+              << ", largest step " << maxStep << (passed ? "" : "\t[FAIL]") << std::endl;
+    return passed;
+}
+}
+
 int main()
 {
     std::cout << "=== ProTune Audio Test ===" << std::endl;
@@ -117,5 +1065,133 @@ int main()
     else
         std::cout << "NOTE: Pitch detection needs tuning (no pitch detected for 440 Hz sine)" << std::endl;
 
-    return hasOutput ? 0 : 1;
+    // Once locked, the detector follows the pitch from running sums
+    std::cout << "\n=== Tracking Mode ===" << std::endl;
+    bool trackingModeWorks = runTrackingModeTest();
+    std::cout << (trackingModeWorks ? "PASS: Tracking follows the pitch and relocks after a jump"
+                                    : "FAIL: Tracking loses the pitch") << std::endl;
+
+    // Latency follows the input type range, so higher voices get less delay
+    std::cout << "\n=== Latency by Input Type ===" << std::endl;
+    const std::pair<PitchDetector::InputType, const char*> inputTypes[] = {
+        { PitchDetector::InputType::Soprano,        "Soprano" },
+        { PitchDetector::InputType::AltoTenor,      "AltoTenor" },
+        { PitchDetector::InputType::LowMale,        "LowMale" },
+        { PitchDetector::InputType::Instrument,     "Instrument" },
+        { PitchDetector::InputType::BassInstrument, "BassInst" }
+    };
+
+    int sopranoLatency = 0;
+    int altoTenorLatency = 0;
+
+    for (const auto& [type, name] : inputTypes)
+    {
+        params.inputType = type;
+        engine.setParameters (params);
+        int latency = engine.getLatencySamples();
+
+        if (type == PitchDetector::InputType::Soprano)
+            sopranoLatency = latency;
+        else if (type == PitchDetector::InputType::AltoTenor)
+            altoTenorLatency = latency;
+
+        std::cout << name << "\t" << latency << " samples\t"
+                  << 1000.0 * latency / sampleRate << " ms" << std::endl;
+    }
+
+    bool latencyFollowsRange = sopranoLatency > 0 && sopranoLatency < altoTenorLatency;
+    std::cout << (latencyFollowsRange ? "PASS: Latency follows input type"
+                                      : "FAIL: Latency ignores input type") << std::endl;
+
+    // Bypass keeps the reported latency
+    std::cout << "\n=== Bypass Alignment ===" << std::endl;
+    bool bypassAligned = runBypassTest();
+    std::cout << (bypassAligned ? "PASS: Bypass is delayed by the reported latency"
+                                : "FAIL: Bypass moves the track") << std::endl;
+
+    // Frames without a correction release the ratio smoothly
+    std::cout << "\n=== Retune Release ===" << std::endl;
+    bool releaseGlides = runRetuneReleaseTest();
+    std::cout << (releaseGlides ? "PASS: Uncorrected frames glide the ratio back to 1"
+                                : "FAIL: The ratio steps when correction stops") << std::endl;
+
+    // Harmony voices from held MIDI notes share the lead's analysis
+    std::cout << "\n=== Harmony (220 Hz input) ===" << std::endl;
+    bool harmonyWorks = runHarmonyTest (PitchCorrectionEngine::ShifterMode::Quality, "Quality")
+                        & runHarmonyTest (PitchCorrectionEngine::ShifterMode::Spectral, "Spectral")
+                        & runHarmonyFoldingTest()
+                        & runHarmonyReleaseTest();
+    std::cout << (harmonyWorks ? "PASS: Harmony voices follow held notes and fade out"
+                               : "FAIL: Harmony voices missing") << std::endl;
+
+    // The Eco shifter resamples by whole cycles; it must still hit the note
+    std::cout << "\n=== Eco Shifter (220 Hz input) ===" << std::endl;
+    bool ecoShifts = runEcoShiftTest (52, "E3")
+                     & runEcoShiftTest (61, "C#4")
+                     & runEcoShiftTest (67, "G4");
+    std::cout << (ecoShifts ? "PASS: Eco shifts to the held note at full level"
+                            : "FAIL: Eco misses the note or the level") << std::endl;
+
+    // Notes apply at their sample positions, so the host block size must
+    // not change the output
+    std::cout << "\n=== MIDI Timing (64 vs 1024 sample blocks) ===" << std::endl;
+    auto smallBlocks = runMidiTiming (64);
+    auto largeBlocks = runMidiTiming (1024);
+
+    float maxDifference = 0.0f;
+    for (size_t i = 0; i < smallBlocks.size(); ++i)
+        maxDifference = juce::jmax (maxDifference, std::abs (smallBlocks[i] - largeBlocks[i]));
+
+    auto smallDelayed = runMidiTiming (64, 4410);
+    auto largeDelayed = runMidiTiming (1024, 4410);
+    float maxDelayedDifference = 0.0f;
+    for (size_t i = 0; i < smallDelayed.size(); ++i)
+        maxDelayedDifference = juce::jmax (maxDelayedDifference, std::abs (smallDelayed[i] - largeDelayed[i]));
+
+    bool midiSampleAccurate = maxDifference < 1.0e-5f && maxDelayedDifference < 1.0e-5f
+                              && runMidiLookaheadBypassTest();
+    std::cout << "Max difference: " << maxDifference << ", with lookahead " << maxDelayedDifference << std::endl;
+    std::cout << (midiSampleAccurate ? "PASS: MIDI is sample accurate"
+                                     : "FAIL: MIDI timing depends on block size") << std::endl;
+
+    // Re-applying unchanged parameters must not restart anything
+    std::cout << "\n=== Unchanged Parameters (applied once vs every block) ===" << std::endl;
+    auto appliedOnce = runParameterSnapshots (false);
+    auto appliedEveryBlock = runParameterSnapshots (true);
+
+    float snapshotDifference = 0.0f;
+    for (size_t i = 0; i < appliedOnce.size(); ++i)
+        snapshotDifference = juce::jmax (snapshotDifference, std::abs (appliedOnce[i] - appliedEveryBlock[i]));
+
+    bool snapshotsIdempotent = snapshotDifference == 0.0f;
+    std::cout << "Max difference: " << snapshotDifference << std::endl;
+    std::cout << (snapshotsIdempotent ? "PASS: Unchanged parameters leave the output alone"
+                                      : "FAIL: Re-applying parameters changes the output") << std::endl;
+
+    // Every hop's analysis reaches the editor through the FIFO
+    std::cout << "\n=== Analysis FIFO ===" << std::endl;
+    bool analysisPublished = runAnalysisFifoTest();
+    std::cout << (analysisPublished ? "PASS: Every analysis frame is published"
+                                    : "FAIL: Analysis frames missing or out of order") << std::endl;
+
+    // A cached analysis stands in for the detector without changing a sample
+    std::cout << "\n=== Pitch Track ===" << std::endl;
+    bool pitchTrackMatches = runPitchTrackTest();
+    std::cout << (pitchTrackMatches ? "PASS: Renders from a pitch track match detecting renders"
+                                    : "FAIL: Pitch track renders differ, or damaged tracks open") << std::endl;
+
+    // Offline lookahead fixes what realtime detection can't see coming
+    std::cout << "\n=== Lookahead ===" << std::endl;
+    bool lookaheadWorks = runPitchRefinerTest() && runLookaheadTest();
+    std::cout << (lookaheadWorks ? "PASS: Lookahead refines decisions, streamed or from a track"
+                                 : "FAIL: Lookahead decisions or renders are wrong") << std::endl;
+
+    // Unlinked, each channel takes pitch marks from itself
+    std::cout << "\n=== Stereo Link ===" << std::endl;
+    bool stereoLinkWorks = runStereoLinkTest();
+    std::cout << (stereoLinkWorks ? "PASS: Unlinked channels are marked on their own"
+                                  : "FAIL: Unlinked channels depend on each other") << std::endl;
+
+    return hasOutput && trackingModeWorks && latencyFollowsRange && bypassAligned && releaseGlides && harmonyWorks && ecoShifts && midiSampleAccurate && snapshotsIdempotent
+        && analysisPublished && pitchTrackMatches && lookaheadWorks && stereoLinkWorks ? 0 : 1;
 }
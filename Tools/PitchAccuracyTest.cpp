@@ -0,0 +1,601 @@
+/**
+ * PitchAccuracyTest
+ *
+ * Regression guard for detection and correction accuracy. Builds a labelled
+ * synthetic corpus (true f0 known per sample), runs it through PitchDetector
+ * and the full engine, and reports MIR-style metrics per category:
+ *
+ * - RPA: raw pitch accuracy, truth-voiced frames detected within 50 cents
+ * - Octave: gross octave errors, truth-voiced frames off by a whole octave
+ *   or two (within 50 cents)
+ * - VR / VFA: voicing recall and voicing false alarm rate
+ * - Corr p50 / p95: cents error of the corrected output (chromatic, instant
+ *   retune), re-detected and compared with the note it should land on
+ * - CPU: milliseconds of detector and engine time per second of audio
+ *
+ * Everything is generated offline. The process fails (exit code 1) when an
+ * overall metric crosses its threshold, when any single signal crosses its
+ * per-signal bound (the worst signal is reported for each metric), or, with
+ * --baseline, when CPU time grows past that baseline.
+ *
+ * A baseline is a saved --json report from an optimised build. Timings only
+ * compare on the machine that recorded them, so CPU is checked only when a
+ * baseline is named: record one (--json <baseline file>) before a change
+ * and compare against it after, on the same machine and build type.
+ *
+ * Usage: PitchAccuracyTest [--json <file>] [--baseline <file>]
+ */
+#include "../Source/PitchCorrectionEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr double sampleRate = 44100.0;
+constexpr int hopSize = PitchCorrectionEngine::defaultAnalysisHopSize;
+constexpr int engineBlockSize = 256;
+
+// Overall thresholds, a little outside the current results (RPA and VR
+// 100%, no octave errors or false alarms, correction 2.2 / 20.5 cents);
+// a regression past any of them fails the run
+constexpr double minRawPitchAccuracy = 0.98;
+constexpr double maxOctaveErrorRate = 0.01;
+constexpr double minVoicingRecall = 0.98;
+constexpr double maxVoicingFalseAlarm = 0.02;
+constexpr double maxCorrectionMedianCents = 4.0;
+constexpr double maxCorrectionP95Cents = 30.0;
+
+// Per-signal bounds, so one broken case cannot hide in the totals. The
+// worst signals today: 99.7% RPA (the bass glide), correction 26.3 / 36.5
+// cents (the top Instrument note)
+constexpr double minSignalRawPitchAccuracy = 0.95;
+constexpr double maxSignalOctaveErrorRate = 0.02;
+constexpr double minSignalVoicingRecall = 0.95;
+constexpr double maxSignalVoicingFalseAlarm = 0.05;
+constexpr double maxSignalCorrectionMedianCents = 35.0;
+constexpr double maxSignalCorrectionP95Cents = 50.0;
+
+// Detector and engine CPU may grow to this multiple of the baseline
+constexpr double maxCpuRegression = 1.5;
+
+struct InputTypeInfo
+{
+    PitchDetector::InputType type;
+    const char* name;
+    float lowHz;
+    float highHz;
+};
+
+const InputTypeInfo inputTypes[] = {
+    { PitchDetector::InputType::Soprano,        "Soprano",    200.0f, 1200.0f },
+    { PitchDetector::InputType::AltoTenor,      "AltoTenor",  100.0f,  600.0f },
+    { PitchDetector::InputType::LowMale,        "LowMale",     60.0f,  300.0f },
+    { PitchDetector::InputType::Instrument,     "Instrument",  80.0f, 2000.0f },
+    { PitchDetector::InputType::BassInstrument, "BassInst",    30.0f,  250.0f }
+};
+
+const InputTypeInfo& altoTenor = inputTypes[1];
+
+// One labelled signal: audio plus the true f0 per sample (0 = unvoiced)
+struct LabelledSignal
+{
+    std::string name;
+    std::string category;
+    const InputTypeInfo* input = nullptr;
+    std::vector<float> audio;
+    std::vector<float> f0;
+    int correctionNote = -1;        // MIDI note the corrected output should land on, -1 = not checked
+};
+
+using PitchCurve = std::function<float (double)>;                 // Seconds -> Hz, 0 = unvoiced
+using HarmonicGain = std::function<double (int, double)>;         // Harmonic number, Hz -> amplitude
+
+float midiToHz (float note) { return 440.0f * std::pow (2.0f, (note - 69.0f) / 12.0f); }
+float hzToMidi (float hz) { return 69.0f + 12.0f * std::log2 (hz / 440.0f); }
+double centsBetween (double a, double b) { return 1200.0 * std::log2 (a / b); }
+
+// Vowel-like spectral envelope with two formants, on a 1/h source
+double formantEnvelope (double hz, double f1, double f2)
+{
+    auto resonance = [hz] (double centre, double bandwidth)
+    {
+        double x = (hz - centre) / bandwidth;
+        return 1.0 / (1.0 + x * x);
+    };
+
+    return 0.15 + resonance (f1, 120.0) + 0.7 * resonance (f2, 180.0);
+}
+
+double vocalHarmonics (int h, double hz) { return formantEnvelope (hz * h, 700.0, 1200.0) / h; }
+
+// Additive synthesis along a pitch curve, with optional noise throughout
+LabelledSignal synthesise (std::string name, std::string category, const InputTypeInfo& input, double seconds,
+                           const PitchCurve& pitch, const HarmonicGain& gain, double noiseLevel = 0.002)
+{
+    LabelledSignal signal;
+    signal.name = std::move (name);
+    signal.category = std::move (category);
+    signal.input = &input;
+
+    auto numSamples = static_cast<size_t> (seconds * sampleRate);
+    signal.audio.resize (numSamples);
+    signal.f0.resize (numSamples);
+
+    juce::Random random (static_cast<juce::int64> (numSamples) + static_cast<juce::int64> (signal.name.size()));
+    double phase = 0.0;
+    int onsetSamples = 0;
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        double hz = pitch (static_cast<double> (i) / sampleRate);
+        double value = 0.0;
+
+        if (hz > 0.0)
+        {
+            // Short attack so onsets do not click
+            onsetSamples = juce::jmin (onsetSamples + 1, 441);
+            int numHarmonics = juce::jlimit (1, 30, static_cast<int> (sampleRate * 0.45 / hz));
+
+            for (int h = 1; h <= numHarmonics; ++h)
+                value += gain (h, hz) * std::sin (phase * h);
+
+            value *= 0.3 * onsetSamples / 441.0;
+            phase = std::fmod (phase + juce::MathConstants<double>::twoPi * hz / sampleRate,
+                               juce::MathConstants<double>::twoPi);
+        }
+        else
+        {
+            onsetSamples = 0;
+        }
+
+        signal.f0[i] = static_cast<float> (hz);
+        signal.audio[i] = static_cast<float> (value + noiseLevel * (random.nextDouble() * 2.0 - 1.0));
+    }
+
+    return signal;
+}
+
+std::vector<LabelledSignal> buildCorpus()
+{
+    std::vector<LabelledSignal> corpus;
+    HarmonicGain vocal = vocalHarmonics;
+
+    for (const auto& input : inputTypes)
+    {
+        // Steady notes 30 cents sharp at the bottom, middle and top of each
+        // range; correction should pull them onto the note
+        int lowNote = static_cast<int> (std::ceil (hzToMidi (input.lowHz * 1.25f)));
+        int highNote = static_cast<int> (std::floor (hzToMidi (input.highHz / 1.25f)));
+
+        for (int note : { lowNote, (lowNote + highNote) / 2, highNote })
+        {
+            float hz = midiToHz (static_cast<float> (note) + 0.3f);
+            auto signal = synthesise (std::string ("steady ") + input.name + " " + std::to_string (note), "steady", input,
+                                      2.0, [hz] (double) { return hz; }, vocal);
+            signal.correctionNote = note;
+            corpus.push_back (std::move (signal));
+        }
+
+        // Exponential glide across the range and back
+        float glideLow = input.lowHz * 1.2f;
+        float glideHigh = input.highHz / 1.2f;
+        corpus.push_back (synthesise (std::string ("glide ") + input.name, "glide", input, 3.0,
+                                      [glideLow, glideHigh] (double t)
+                                      {
+                                          double position = t < 1.5 ? t / 1.5 : (3.0 - t) / 1.5;
+                                          return static_cast<float> (glideLow * std::pow (glideHigh / glideLow, position));
+                                      }, vocal));
+    }
+
+    // Vibrato at several rates and depths around A3
+    for (double rate : { 3.0, 5.5, 8.0 })
+    {
+        for (double depth : { 20.0, 60.0, 150.0 })
+        {
+            corpus.push_back (synthesise ("vibrato " + juce::String (rate, 1).toStdString() + " Hz "
+                                              + std::to_string (static_cast<int> (depth)) + " c",
+                                          "vibrato", altoTenor, 2.0,
+                                          [rate, depth] (double t)
+                                          {
+                                              double cents = depth * std::sin (juce::MathConstants<double>::twoPi * rate * t);
+                                              return static_cast<float> (220.0 * std::pow (2.0, cents / 1200.0));
+                                          }, vocal));
+        }
+    }
+
+    // Formant-rich pulse trains: flat harmonics through vowel formants
+    const std::pair<const char*, std::pair<double, double>> vowels[] = {
+        { "a", { 730.0, 1090.0 } }, { "i", { 270.0, 2290.0 } }, { "u", { 300.0, 870.0 } }
+    };
+
+    for (const auto& [vowel, formants] : vowels)
+    {
+        for (int note : { 50, 57 })
+        {
+            auto [f1, f2] = formants;
+            float hz = midiToHz (static_cast<float> (note) - 0.25f);
+            auto signal = synthesise (std::string ("pulse /") + vowel + "/ " + std::to_string (note), "pulse", altoTenor, 2.0,
+                                      [hz] (double) { return hz; },
+                                      [f1 = f1, f2 = f2] (int h, double f) { return 0.25 * formantEnvelope (f * h, f1, f2); });
+            signal.correctionNote = note;
+            corpus.push_back (std::move (signal));
+        }
+    }
+
+    // Octave-ambiguous spectra: weak fundamental, odd harmonics only, and a
+    // second harmonic three times the fundamental
+    corpus.push_back (synthesise ("weak fundamental", "octave", altoTenor, 2.0, [] (double) { return 180.0f; },
+                                  [] (int h, double) { return h == 1 ? 0.1 : 1.0 / (h - 1); }));
+    corpus.push_back (synthesise ("odd harmonics", "octave", altoTenor, 2.0, [] (double) { return 200.0f; },
+                                  [] (int h, double) { return h % 2 == 1 ? 1.0 / h : 0.0; }));
+    corpus.push_back (synthesise ("strong octave", "octave", altoTenor, 2.0, [] (double) { return 150.0f; },
+                                  [] (int h, double) { return h == 1 ? 0.3 : (h == 2 ? 1.0 : 0.5 / h); }));
+
+    // Noise only, white and louder, and phrases separated by breath noise
+    corpus.push_back (synthesise ("white noise", "noise", altoTenor, 2.0, [] (double) { return 0.0f; }, vocal, 0.1));
+    corpus.push_back (synthesise ("loud noise", "noise", inputTypes[3], 2.0, [] (double) { return 0.0f; }, vocal, 0.3));
+    corpus.push_back (synthesise ("phrases", "voicing", altoTenor, 3.0,
+                                  [] (double t) { return std::fmod (t, 0.45) < 0.3 ? 196.0f : 0.0f; }, vocal, 0.02));
+
+    return corpus;
+}
+
+struct Metrics
+{
+    int truthVoiced = 0;
+    int correct = 0;
+    int octaveErrors = 0;
+    int detectedVoiced = 0;         // Of the truth-voiced frames
+    int truthUnvoiced = 0;
+    int falseAlarms = 0;
+    std::vector<double> correctionCents;
+    double audioSeconds = 0.0;
+    double detectorSeconds = 0.0;
+    double engineSeconds = 0.0;
+
+    void add (const Metrics& other)
+    {
+        truthVoiced += other.truthVoiced;
+        correct += other.correct;
+        octaveErrors += other.octaveErrors;
+        detectedVoiced += other.detectedVoiced;
+        truthUnvoiced += other.truthUnvoiced;
+        falseAlarms += other.falseAlarms;
+        correctionCents.insert (correctionCents.end(), other.correctionCents.begin(), other.correctionCents.end());
+        audioSeconds += other.audioSeconds;
+        detectorSeconds += other.detectorSeconds;
+        engineSeconds += other.engineSeconds;
+    }
+
+    static double ratio (int numerator, int denominator) { return denominator > 0 ? static_cast<double> (numerator) / denominator : 0.0; }
+
+    double rawPitchAccuracy() const { return ratio (correct, truthVoiced); }
+    double octaveErrorRate() const { return ratio (octaveErrors, truthVoiced); }
+    double voicingRecall() const { return ratio (detectedVoiced, truthVoiced); }
+    double voicingFalseAlarm() const { return ratio (falseAlarms, truthUnvoiced); }
+    double detectorMsPerSecond() const { return 1000.0 * detectorSeconds / audioSeconds; }
+    double engineMsPerSecond() const { return 1000.0 * engineSeconds / audioSeconds; }
+
+    double correctionPercentile (double p) const
+    {
+        if (correctionCents.empty())
+            return 0.0;
+
+        auto sorted = correctionCents;
+        std::sort (sorted.begin(), sorted.end());
+        return sorted[static_cast<size_t> (p * static_cast<double> (sorted.size() - 1) + 0.5)];
+    }
+};
+
+// Truth for the detector frame ending at sample end: the f0 one period
+// before the end (the detector compares the last two periods). Frames that
+// straddle a voicing change are skipped (returns -1).
+float truthForFrame (const std::vector<float>& f0, int end)
+{
+    auto last = static_cast<size_t> (end - 1);
+    int guard = static_cast<int> (0.02 * sampleRate);
+    if (f0[last] > 0.0f)
+        guard = juce::jmax (guard, 2 * static_cast<int> (sampleRate / f0[last]));
+
+    auto first = static_cast<size_t> (juce::jmax (0, end - 1 - guard));
+    bool voicedNow = f0[last] > 0.0f;
+
+    for (auto i = first; i < last; ++i)
+        if ((f0[i] > 0.0f) != voicedNow)
+            return -1.0f;
+
+    if (! voicedNow)
+        return 0.0f;
+
+    auto reference = static_cast<size_t> (juce::jmax (0, end - 1 - static_cast<int> (sampleRate / f0[last])));
+    return f0[reference];
+}
+
+void scoreFrame (Metrics& metrics, float truthHz, const PitchDetector::Result& result)
+{
+    if (truthHz < 0.0f)
+        return;
+
+    if (truthHz == 0.0f)
+    {
+        ++metrics.truthUnvoiced;
+        if (result.voiced)
+            ++metrics.falseAlarms;
+        return;
+    }
+
+    ++metrics.truthVoiced;
+    if (! result.voiced || result.frequency <= 0.0f)
+        return;
+
+    ++metrics.detectedVoiced;
+    double cents = centsBetween (result.frequency, truthHz);
+
+    if (std::abs (cents) < 50.0)
+        ++metrics.correct;
+    else
+        for (double octave : { -2400.0, -1200.0, 1200.0, 2400.0 })
+            if (std::abs (cents - octave) < 50.0)
+                ++metrics.octaveErrors;
+}
+
+Metrics evaluate (const LabelledSignal& signal)
+{
+    Metrics metrics;
+    auto numSamples = static_cast<int> (signal.audio.size());
+    metrics.audioSeconds = numSamples / sampleRate;
+    int settleSamples = static_cast<int> (0.1 * sampleRate);
+
+    // Detector alone, one hop at a time as the engine runs it
+    {
+        PitchDetector detector;
+        detector.setInputType (signal.input->type);
+        detector.prepare (sampleRate, hopSize);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<PitchDetector::Result> results;
+
+        for (int end = hopSize; end <= numSamples; end += hopSize)
+            results.push_back (detector.process (signal.audio.data() + end - hopSize, hopSize));
+
+        metrics.detectorSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+        for (size_t frame = 0; frame < results.size(); ++frame)
+        {
+            int end = static_cast<int> (frame + 1) * hopSize;
+            if (end > settleSamples)
+                scoreFrame (metrics, truthForFrame (signal.f0, end), results[frame]);
+        }
+    }
+
+    // Full engine: chromatic, instant retune, no vibrato or humanize
+    PitchCorrectionEngine engine;
+    engine.prepare (sampleRate, engineBlockSize, 1);
+
+    PitchCorrectionEngine::Parameters params;
+    params.inputType = signal.input->type;
+    params.retuneSpeedMs = 0.0f;
+    params.vibratoTracking = 0.0f;
+    params.humanize = 0.0f;
+    engine.setParameters (params);
+
+    std::vector<float> output (signal.audio);
+    auto start = std::chrono::steady_clock::now();
+
+    for (int position = 0; position + engineBlockSize <= numSamples; position += engineBlockSize)
+    {
+        float* channel = output.data() + position;
+        juce::AudioBuffer<float> block (&channel, 1, engineBlockSize);
+        engine.process (block);
+    }
+
+    metrics.engineSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+    // Re-detect the corrected output; output sample p came from input p - latency
+    if (signal.correctionNote >= 0)
+    {
+        int latency = engine.getLatencySamples();
+        double expectedHz = midiToHz (static_cast<float> (signal.correctionNote));
+
+        PitchDetector redetector;
+        redetector.setInputType (signal.input->type);
+        redetector.prepare (sampleRate, hopSize);
+
+        for (int end = hopSize; end <= numSamples; end += hopSize)
+        {
+            auto result = redetector.process (output.data() + end - hopSize, hopSize);
+            int inputEnd = end - latency;
+
+            if (inputEnd > static_cast<int> (0.3 * sampleRate) && result.voiced
+                && truthForFrame (signal.f0, inputEnd) > 0.0f)
+                metrics.correctionCents.push_back (std::abs (centsBetween (result.frequency, expectedHz)));
+        }
+    }
+
+    return metrics;
+}
+
+juce::var toJson (const std::string& name, const Metrics& metrics)
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty ("name", juce::String (name));
+    object->setProperty ("rawPitchAccuracy", metrics.rawPitchAccuracy());
+    object->setProperty ("octaveErrorRate", metrics.octaveErrorRate());
+    object->setProperty ("voicingRecall", metrics.voicingRecall());
+    object->setProperty ("voicingFalseAlarm", metrics.voicingFalseAlarm());
+    object->setProperty ("correctionMedianCents", metrics.correctionPercentile (0.5));
+    object->setProperty ("correctionP95Cents", metrics.correctionPercentile (0.95));
+    object->setProperty ("detectorMsPerSecond", metrics.detectorMsPerSecond());
+    object->setProperty ("engineMsPerSecond", metrics.engineMsPerSecond());
+    return object;
+}
+
+void printRow (const std::string& name, const Metrics& metrics)
+{
+    auto percent = [] (double value) { return juce::String (100.0 * value, 1) + "%"; };
+    bool hasCorrection = ! metrics.correctionCents.empty();
+
+    std::cout << std::left << std::setw (24) << name << std::right << "\t"
+              << (metrics.truthVoiced > 0 ? percent (metrics.rawPitchAccuracy()) : juce::String ("-")) << "\t"
+              << (metrics.truthVoiced > 0 ? percent (metrics.octaveErrorRate()) : juce::String ("-")) << "\t"
+              << (metrics.truthVoiced > 0 ? percent (metrics.voicingRecall()) : juce::String ("-")) << "\t"
+              << (metrics.truthUnvoiced > 0 ? percent (metrics.voicingFalseAlarm()) : juce::String ("-")) << "\t"
+              << (hasCorrection ? juce::String (metrics.correctionPercentile (0.5), 1) : juce::String ("-")) << "\t"
+              << (hasCorrection ? juce::String (metrics.correctionPercentile (0.95), 1) : juce::String ("-")) << "\t"
+              << juce::String (metrics.detectorMsPerSecond(), 1) << "\t"
+              << juce::String (metrics.engineMsPerSecond(), 1) << std::endl;
+}
+
+bool check (const juce::String& label, double value, double limit, bool lowerIsBetter)
+{
+    bool passed = lowerIsBetter ? value <= limit : value >= limit;
+    std::cout << (passed ? "PASS: " : "FAIL: ") << label << " " << value
+              << (lowerIsBetter ? " (max " : " (min ") << limit << ")" << std::endl;
+    return passed;
+}
+
+using SignalResults = std::vector<std::pair<std::string, Metrics>>;
+
+// Checks the worst signal for one metric, over the signals it applies to
+bool checkWorstSignal (const char* label, const SignalResults& results, const std::function<bool (const Metrics&)>& applies,
+                       const std::function<double (const Metrics&)>& metric, double limit, bool lowerIsBetter)
+{
+    const SignalResults::value_type* worst = nullptr;
+
+    for (const auto& result : results)
+    {
+        if (! applies (result.second))
+            continue;
+
+        double value = metric (result.second);
+        if (worst == nullptr || (lowerIsBetter ? value > metric (worst->second) : value < metric (worst->second)))
+            worst = &result;
+    }
+
+    if (worst == nullptr)
+        return true;
+
+    return check (juce::String (label) + " (" + worst->first + ")", metric (worst->second), limit, lowerIsBetter);
+}
+
+// Compares CPU time with a saved report, which must exist
+bool checkCpuBaseline (const juce::File& file, const Metrics& overall)
+{
+    auto baseline = file.existsAsFile() ? juce::JSON::parse (file).getProperty ("overall", {}) : juce::var();
+
+    if (! baseline.isObject())
+    {
+        std::cout << "FAIL: No CPU baseline in " << file.getFullPathName() << std::endl;
+        return false;
+    }
+
+    auto limit = [&baseline] (const char* key) { return maxCpuRegression * static_cast<double> (baseline.getProperty (key, 0.0)); };
+
+    return check ("Detector ms/s vs baseline", overall.detectorMsPerSecond(), limit ("detectorMsPerSecond"), true)
+         & check ("Engine ms/s vs baseline", overall.engineMsPerSecond(), limit ("engineMsPerSecond"), true);
+}
+}
+
+int main (int argc, char* argv[])
+{
+    juce::String jsonPath;
+    juce::String baselinePath;
+
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (juce::String (argv[i]) == "--json")
+            jsonPath = argv[i + 1];
+        else if (juce::String (argv[i]) == "--baseline")
+            baselinePath = argv[i + 1];
+    }
+
+    std::cout << "=== ProTune Pitch Accuracy ===" << std::endl;
+
+    auto corpus = buildCorpus();
+    std::cout << corpus.size() << " labelled signals" << std::endl;
+
+    const char* header = "\nSignal\t\t\t\tRPA\tOctave\tVR\tVFA\tCorr50\tCorr95\tDet ms/s\tEng ms/s\n"
+                         "------\t\t\t\t---\t------\t--\t---\t------\t------\t--------\t--------";
+
+    std::map<std::string, Metrics> categories;
+    std::vector<std::string> categoryOrder;
+    Metrics overall;
+    SignalResults signalResults;
+
+    std::cout << header << std::endl;
+
+    for (const auto& signal : corpus)
+    {
+        auto metrics = evaluate (signal);
+        printRow (signal.name, metrics);
+
+        if (categories.find (signal.category) == categories.end())
+            categoryOrder.push_back (signal.category);
+
+        categories[signal.category].add (metrics);
+        overall.add (metrics);
+        signalResults.emplace_back (signal.name, std::move (metrics));
+    }
+
+    std::cout << "\n=== By Category ===" << header << std::endl;
+    juce::Array<juce::var> categoryResults;
+
+    for (const auto& category : categoryOrder)
+    {
+        printRow (category, categories[category]);
+        categoryResults.add (toJson (category, categories[category]));
+    }
+
+    printRow ("overall", overall);
+
+    std::cout << "\n=== Thresholds ===" << std::endl;
+    bool passed = check ("Raw pitch accuracy", overall.rawPitchAccuracy(), minRawPitchAccuracy, false)
+                & check ("Octave error rate", overall.octaveErrorRate(), maxOctaveErrorRate, true)
+                & check ("Voicing recall", overall.voicingRecall(), minVoicingRecall, false)
+                & check ("Voicing false alarm", overall.voicingFalseAlarm(), maxVoicingFalseAlarm, true)
+                & check ("Correction median cents", overall.correctionPercentile (0.5), maxCorrectionMedianCents, true)
+                & check ("Correction p95 cents", overall.correctionPercentile (0.95), maxCorrectionP95Cents, true);
+
+    auto voiced = [] (const Metrics& m) { return m.truthVoiced > 0; };
+    auto unvoiced = [] (const Metrics& m) { return m.truthUnvoiced > 0; };
+    auto corrected = [] (const Metrics& m) { return ! m.correctionCents.empty(); };
+
+    passed = checkWorstSignal ("Worst raw pitch accuracy", signalResults, voiced,
+                               [] (const Metrics& m) { return m.rawPitchAccuracy(); }, minSignalRawPitchAccuracy, false)
+           & checkWorstSignal ("Worst octave error rate", signalResults, voiced,
+                               [] (const Metrics& m) { return m.octaveErrorRate(); }, maxSignalOctaveErrorRate, true)
+           & checkWorstSignal ("Worst voicing recall", signalResults, voiced,
+                               [] (const Metrics& m) { return m.voicingRecall(); }, minSignalVoicingRecall, false)
+           & checkWorstSignal ("Worst voicing false alarm", signalResults, unvoiced,
+                               [] (const Metrics& m) { return m.voicingFalseAlarm(); }, maxSignalVoicingFalseAlarm, true)
+           & checkWorstSignal ("Worst correction median cents", signalResults, corrected,
+                               [] (const Metrics& m) { return m.correctionPercentile (0.5); }, maxSignalCorrectionMedianCents, true)
+           & checkWorstSignal ("Worst correction p95 cents", signalResults, corrected,
+                               [] (const Metrics& m) { return m.correctionPercentile (0.95); }, maxSignalCorrectionP95Cents, true)
+           & passed;
+
+    if (baselinePath.isNotEmpty())
+        passed = checkCpuBaseline (juce::File::getCurrentWorkingDirectory().getChildFile (baselinePath), overall) & passed;
+
+    if (jsonPath.isNotEmpty())
+    {
+        auto* report = new juce::DynamicObject();
+        report->setProperty ("categories", categoryResults);
+        report->setProperty ("overall", toJson ("overall", overall));
+        report->setProperty ("passed", passed);
+
+        juce::File jsonFile (juce::File::getCurrentWorkingDirectory().getChildFile (jsonPath));
+        if (! jsonFile.replaceWithText (juce::JSON::toString (juce::var (report))))
+            std::cout << "Failed to write " << jsonFile.getFullPathName() << std::endl;
+    }
+
+    return passed ? 0 : 1;
+}
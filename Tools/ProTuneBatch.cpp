@@ -0,0 +1,1513 @@
+/**
+ * ProTuneBatch
+ *
+ * Renders audio files through the pitch correction engine, several at a
+ * time, without holding any file in memory: each job streams its input
+ * block by block through an AudioFormatReader, its own engine and an
+ * AudioFormatWriter.
+ *
+ * Usage: ProTuneBatch [options] <file or directory>... --out <directory>
+ *
+ *   --out <dir>          Where rendered files go (required). Files keep their
+ *                        names, and their relative paths when a directory is
+ *                        searched recursively.
+ *   --preset <file.json> Engine settings, keyed by plugin parameter ID.
+ *   --<parameterID> <v>  Any preset setting, overriding the preset.
+ *   --jobs <n>           Files rendered at once (default: one per core).
+ *   --block <n>          Samples per process() call (default 512).
+ *   --format <ext>       wav, aiff or flac (default: the input's format when
+ *                        it can be written, otherwise wav).
+ *   --bits <n>           16, 24 or 32 (default: the input's bit depth).
+ *   --recursive          Search directories recursively.
+ *   --overwrite          Replace existing output files (default: skip them).
+ *   --segment <s>        Split files of at least twice this length into
+ *                        segments of about this length (5 s or more),
+ *                        rendered in parallel (default 0: never split).
+ *   --warmup <s>         Audio each segment's engine runs through first,
+ *                        so its detector, retune and shifter state has
+ *                        settled by the segment start (default 2).
+ *   --crossfade <ms>     Fade from one segment into the next (default 20).
+ *   --verify             Also render split files serially and compare; a
+ *                        split render that differs audibly, over the whole
+ *                        file or around any one join, fails.
+ *   --analyse            Render nothing: write each file's pitch track
+ *                        (<name>.ptrk, see PitchTrackFile) and the same as
+ *                        <name>.csv to the output directory.
+ *   --pitch-cache <dir>  Render with detection read from <dir>/<name>.ptrk.
+ *                        Tracks that are missing, older than their input or
+ *                        analysed with other detection settings are
+ *                        analysed again first; retune, scale and shifter
+ *                        settings can change freely.
+ *   --lookahead <ms>     Decide each hop's pitch seeing this far ahead (see
+ *                        PitchRefiner), as the plugin does when bouncing
+ *                        (default 0: decide as in realtime). From a pitch
+ *                        track the future is already analysed; otherwise
+ *                        the engine delays its audio, which costs nothing
+ *                        here since latency is removed.
+ *
+ * Settings use the plugin's units and choice names, e.g.
+ *   { "inputType": "Low Male", "key": "F#", "scaleMode": "Natural Minor",
+ *     "retuneSpeed": 10, "tracking": 50, "shifterMode": "Quality" }
+ *
+ * Every plugin parameter ID is accepted, so a preset saved from the plugin
+ * works as it is. There is no MIDI input: MIDI Control and Harmony render
+ * as the plugin does with no notes held. offlineLookahead is the plugin's
+ * name for --lookahead, which overrides a preset like any other flag.
+ *
+ * The engine's latency is removed, so outputs line up with their inputs and
+ * have the same length. Each file is written to a temporary file first and
+ * only moved into place once complete.
+ *
+ * Segment boundaries move to the quietest point within a few seconds, where
+ * the engine's state converges fastest. Across pauses a warmed-up segment
+ * is normally sample-identical to the serial render; through sustained
+ * notes the shifter's output phase can differ while sounding the same, so
+ * joins are placed and faded to suit (see joinSegments) and --verify
+ * compares what is heard rather than samples (see compareRenders).
+ *
+ * A render from a pitch track is sample-identical to one that detects for
+ * itself, and skips the detector, with or without --lookahead.
+ */
+#include "../Source/PitchCorrectionEngine.h"
+#include "../Source/PitchTrackFile.h"
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+using Parameters = PitchCorrectionEngine::Parameters;
+using ScaleSettings = Parameters::ScaleSettings;
+using AllowedMask = PitchCorrectionEngine::AllowedMask;
+
+const juce::StringArray inputTypeNames { "Soprano", "Alto/Tenor", "Low Male", "Instrument", "Bass Inst." };
+const juce::StringArray scaleModeNames {
+    "Chromatic", "Major", "Natural Minor", "Harmonic Minor", "Melodic Minor",
+    "Dorian", "Phrygian", "Lydian", "Mixolydian", "Locrian",
+    "Whole Tone", "Blues", "Major Pentatonic", "Minor Pentatonic",
+    "Diminished", "Custom"
+};
+const juce::StringArray shifterModeNames { "Quality", "Eco", "Spectral" };
+const juce::StringArray enharmonicNames { "Auto", "Sharps", "Flats" };
+const juce::StringArray losslessExtensions { "wav", "aiff", "aif", "flac" };
+
+// How far past each segment boundary the join may place its crossfade
+constexpr double joinSearchSeconds = 0.5;
+
+struct Options
+{
+    juce::Array<juce::File> inputs;
+    juce::File outputDirectory;
+    juce::File presetFile;
+    juce::StringPairArray overrides;        // Parameter ID -> value, from flags
+    int jobs = juce::SystemStats::getNumCpus();
+    int blockSize = 512;
+    juce::String format;
+    int bitsPerSample = 0;
+    bool recursive = false;
+    bool overwrite = false;
+
+    // Splitting long files into segments rendered in parallel
+    double segmentSeconds = 0.0;            // 0 = whole files only
+    double warmUpSeconds = 2.0;
+    double crossfadeMs = 20.0;
+    bool verify = false;
+    // --verify tolerances, just above what the comparison gives for renders
+    // that sound the same (the serial render vs one started a few samples
+    // earlier): the detector reads a few cents of jitter into PSOLA output.
+    // A 10 cent detune or 100 ms of retune speed fails.
+    double maxPitchCents = 8.0;
+    double maxGrossPitchRate = 0.05;
+    double maxLevelDb = 1.5;
+    double maxJoinLevelDb = 2.0;            // A 20 ms dropout at a join reads ~10 dB
+    double minVoicingAgreement = 0.97;
+    // The same around each join: a second of frames averages less jitter
+    // away, so the pitch tolerance is wider. 20 cents for half a second at
+    // a join fails, as does an octave error or dropout of three frames.
+    double maxJoinPitchCents = 11.0;
+    double maxJoinGrossPitchRate = 0.05;
+    double minJoinVoicingAgreement = 0.95;
+
+    // Pitch tracks
+    bool analyseOnly = false;
+    juce::File pitchCacheDirectory;
+    double lookaheadMs = 0.0;
+};
+
+// Lower case letters, digits and '#' only, so "Low Male", "lowmale" and
+// "low-male" all match
+juce::String normalise (const juce::String& name)
+{
+    return name.toLowerCase().retainCharacters ("abcdefghijklmnopqrstuvwxyz0123456789#");
+}
+
+// A choice given by index, by name or by an unambiguous start of a name
+// ("bass" for "Bass Inst."); -1 if it is none of these
+int parseChoice (const juce::String& value, const juce::StringArray& names)
+{
+    auto trimmed = value.trim();
+    if (trimmed.isNotEmpty() && trimmed.containsOnly ("0123456789"))
+        return trimmed.getIntValue() < names.size() ? trimmed.getIntValue() : -1;
+
+    auto wanted = normalise (trimmed);
+    if (wanted.isEmpty())
+        return -1;
+
+    int prefixMatch = -1;
+    for (int i = 0; i < names.size(); ++i)
+    {
+        auto name = normalise (names[i]);
+        if (name == wanted)
+            return i;
+        if (name.startsWith (wanted))
+            prefixMatch = prefixMatch == -1 ? i : -2;
+    }
+
+    return juce::jmax (-1, prefixMatch);
+}
+
+// A key given by index (0 = C) or by name, with any number of sharps or flats
+int parseKey (const juce::String& value)
+{
+    auto trimmed = value.trim();
+    if (trimmed.isNotEmpty() && trimmed.containsOnly ("0123456789"))
+        return trimmed.getIntValue() < 12 ? trimmed.getIntValue() : -1;
+
+    static const int naturals[] = { 9, 11, 0, 2, 4, 5, 7 };     // A to G
+    auto letter = juce::CharacterFunctions::toUpperCase (trimmed[0]);
+    if (letter < 'A' || letter > 'G')
+        return -1;
+
+    int key = naturals[letter - 'A'];
+    for (auto accidental : trimmed.substring (1))
+    {
+        if (accidental == '#')
+            ++key;
+        else if (accidental == 'b')
+            --key;
+        else
+            return -1;
+    }
+
+    return (key + 12) % 12;
+}
+
+bool parseBool (const juce::String& value, bool& result)
+{
+    auto lower = value.trim().toLowerCase();
+    if (lower == "1" || lower == "true" || lower == "on" || lower == "yes")
+        result = true;
+    else if (lower == "0" || lower == "false" || lower == "off" || lower == "no")
+        result = false;
+    else
+        return false;
+
+    return true;
+}
+
+bool parseNumber (const juce::String& value, float minimum, float maximum, float& result)
+{
+    auto trimmed = value.trim();
+    if (trimmed.isEmpty() || ! trimmed.containsOnly ("0123456789.-+eE"))
+        return false;
+
+    result = juce::jlimit (minimum, maximum, trimmed.getFloatValue());
+    return true;
+}
+
+/**
+ * Applies one setting, keyed and scaled like the plugin parameter of the same
+ * ID (see ProTuneAudioProcessor::updateEngineParameters). Returns an error
+ * message, or an empty string on success.
+ */
+juce::String applySetting (Parameters& params, double& lookaheadMs, const juce::String& id, const juce::String& value)
+{
+    float number = 0.0f;
+    bool flag = false;
+    auto invalid = "invalid value for " + id + ": \"" + value + "\"";
+
+    if (id == "inputType")
+    {
+        auto index = parseChoice (value, inputTypeNames);
+        if (index < 0)
+            return invalid;
+        params.inputType = static_cast<PitchDetector::InputType> (index);
+    }
+    else if (id == "key" || id == "scaleRoot")
+    {
+        auto key = parseKey (value);
+        if (key < 0)
+            return invalid;
+        params.scale.root = key;
+        params.scaleRoot = key;
+    }
+    else if (id == "scaleMode")
+    {
+        auto index = parseChoice (value, scaleModeNames);
+        if (index < 0)
+            return invalid;
+        params.scale.type = static_cast<ScaleSettings::Type> (index);
+        params.scaleType = static_cast<ScaleMapper::ScaleType> (index);
+    }
+    else if (id == "shifterMode")
+    {
+        auto index = parseChoice (value, shifterModeNames);
+        if (index < 0)
+            return invalid;
+        params.shifterMode = static_cast<PitchCorrectionEngine::ShifterMode> (index);
+    }
+    else if (id == "enharmonicPref")
+    {
+        auto index = parseChoice (value, enharmonicNames);
+        if (index < 0)
+            return invalid;
+        params.scale.enharmonicPreference = static_cast<ScaleSettings::EnharmonicPreference> (index);
+    }
+    else if (id == "bypass" || id == "forceCorrection" || id == "stereoLink"
+             || id == "midiEnabled" || id == "harmonyEnabled")
+    {
+        if (! parseBool (value, flag))
+            return invalid;
+        (id == "bypass" ? params.bypass
+                        : id == "stereoLink" ? params.linkChannels
+                        : id == "midiEnabled" ? params.midiEnabled
+                        : id == "harmonyEnabled" ? params.harmonyEnabled : params.forceCorrection) = flag;
+    }
+    else if (id == "scaleMask")
+    {
+        auto trimmed = value.trim();
+        auto mask = trimmed.startsWithIgnoreCase ("0x") ? trimmed.substring (2).getHexValue32()
+                                                        : trimmed.getIntValue();
+        params.customScaleMask = static_cast<AllowedMask> (mask) & 0x0FFFu;
+    }
+    else
+    {
+        struct NumberSetting
+        {
+            const char* id;
+            float minimum, maximum, scale;
+            float Parameters::* field;
+        };
+
+        static const NumberSetting numberSettings[] = {
+            { "retuneSpeed",  0.0f,    400.0f,  1.0f,    &Parameters::retuneSpeedMs },
+            { "speed",        0.0f,    400.0f,  1.0f,    &Parameters::retuneSpeedMs },
+            { "tracking",     0.0f,    100.0f,  0.01f,   &Parameters::tracking },
+            { "humanize",     0.0f,    100.0f,  0.01f,   &Parameters::humanize },
+            { "detune",       -100.0f, 100.0f,  1.0f,    &Parameters::detune },
+            { "vibrato",      0.0f,    1.0f,    1.0f,    &Parameters::vibratoTracking },
+            { "formant",      0.0f,    1.0f,    1.0f,    &Parameters::formantPreserve },
+            { "transition",   0.0f,    1.0f,    1.0f,    &Parameters::noteTransition },
+            { "tolerance",    0.0f,    100.0f,  1.0f,    &Parameters::toleranceCents },
+            { "rangeLow",     40.0f,   500.0f,  1.0f,    &Parameters::rangeLowHz },
+            { "rangeHigh",    120.0f,  2000.0f, 1.0f,    &Parameters::rangeHighHz },
+            { "harmonyLevel", 0.0f,    1.0f,    1.0f,    &Parameters::harmonyLevel }
+        };
+
+        if (id == "transpose")
+        {
+            if (! parseNumber (value, -24.0f, 24.0f, number))
+                return invalid;
+            params.transpose = juce::roundToInt (number);
+            return {};
+        }
+
+        if (id == "offlineLookahead")
+        {
+            if (! parseNumber (value, 0.0f, static_cast<float> (1000.0 * PitchCorrectionEngine::maxLookaheadSeconds), number))
+                return invalid;
+            lookaheadMs = number;
+            return {};
+        }
+
+        for (const auto& setting : numberSettings)
+        {
+            if (id == setting.id)
+            {
+                if (! parseNumber (value, setting.minimum, setting.maximum, number))
+                    return invalid;
+                params.*setting.field = number * setting.scale;
+                return {};
+            }
+        }
+
+        return "unknown setting: " + id;
+    }
+
+    return {};
+}
+
+// Fields derived from others, as the processor does after reading its parameters
+void finaliseParameters (Parameters& params)
+{
+    auto mask = ScaleSettings::maskForType (params.scale.type, params.scale.root, params.customScaleMask);
+    params.scale.mask = mask != 0 ? mask : 0x0FFFu;
+
+    if (params.rangeLowHz > params.rangeHighHz)
+        std::swap (params.rangeLowHz, params.rangeHighHz);
+}
+
+juce::String loadPreset (const juce::File& file, Parameters& params, double& lookaheadMs)
+{
+    juce::var preset;
+    auto result = juce::JSON::parse (file.loadFileAsString(), preset);
+
+    if (result.failed())
+        return file.getFullPathName() + ": " + result.getErrorMessage();
+
+    auto* object = preset.getDynamicObject();
+    if (object == nullptr)
+        return file.getFullPathName() + ": expected a JSON object";
+
+    for (const auto& property : object->getProperties())
+    {
+        // Numbers and booleans arrive as their string forms ("1"/"0" for booleans)
+        auto error = applySetting (params, lookaheadMs, property.name.toString(), property.value.toString());
+        if (error.isNotEmpty())
+            return file.getFullPathName() + ": " + error;
+    }
+
+    return {};
+}
+
+struct Job
+{
+    juce::File input;
+    juce::File output;
+    juce::File track;                       // Pitch track to write or reuse, if any
+    juce::int64 lengthInSamples = 0;
+    double sampleRate = 44100.0;
+    int numChannels = 1;
+    int bitsPerSample = 24;
+};
+
+// Input samples [preRollStart, start) only warm the engine up; the output
+// for [start, end) is kept
+struct Segment
+{
+    juce::int64 preRollStart = 0;
+    juce::int64 start = 0;
+    juce::int64 end = 0;
+};
+
+std::unique_ptr<juce::AudioFormatWriter> createWriter (juce::AudioFormat& format, const juce::File& file,
+                                                       const Job& job, int bitsPerSample)
+{
+    auto fileStream = std::make_unique<juce::FileOutputStream> (file);
+    if (fileStream->failedToOpen())
+        return nullptr;
+
+    std::unique_ptr<juce::OutputStream> stream = std::move (fileStream);
+    return format.createWriterFor (stream, juce::AudioFormatWriterOptions()
+                                               .withSampleRate (job.sampleRate)
+                                               .withNumChannels (job.numChannels)
+                                               .withBitsPerSample (bitsPerSample));
+}
+
+/**
+ * Streams one segment of a file through its own engine. Memory use is a
+ * block buffer plus whatever the reader and writer buffer internally,
+ * whatever the segment length. Returns an error message, or an empty string.
+ */
+juce::String renderSegment (const Job& job, const Segment& segment, const Parameters& params, const PitchTrackFile* track,
+                            double lookaheadMs, int blockSize, juce::AudioFormatWriter& writer, float& peak,
+                            const std::function<bool()>& shouldExit)
+{
+    // AudioFormatManager isn't shared between threads; each task has its own
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (job.input));
+    if (reader == nullptr)
+        return "can't read this file";
+
+    PitchCorrectionEngine engine;
+    engine.prepare (job.sampleRate, blockSize, job.numChannels);
+    engine.setParameters (params);
+    engine.setPitchTrack (track, segment.preRollStart);
+    engine.setLookahead (juce::roundToInt (lookaheadMs * 0.001 * job.sampleRate));
+    auto latency = static_cast<juce::int64> (engine.getLatencySamples());
+
+    // Input runs latency samples past the end of the segment (silence past
+    // the end of the file, which flushes the engine) and output sample
+    // position - latency lines up with the input
+    juce::AudioBuffer<float> block (job.numChannels, blockSize);
+    auto inputEnd = segment.end + latency;
+
+    for (auto position = segment.preRollStart; position < inputEnd; position += blockSize)
+    {
+        if (shouldExit())
+            return "cancelled";
+
+        auto numSamples = static_cast<int> (juce::jmin (static_cast<juce::int64> (blockSize), inputEnd - position));
+        juce::AudioBuffer<float> view (block.getArrayOfWritePointers(), job.numChannels, numSamples);
+
+        if (! reader->read (&view, 0, numSamples, position, true, true))
+            return "read error at sample " + juce::String (position);
+
+        engine.process (view);
+
+        auto first = juce::jmax (position, segment.start + latency);
+        auto last = position + numSamples;
+        if (first >= last)
+            continue;
+
+        auto offset = static_cast<int> (first - position);
+        auto count = static_cast<int> (last - first);
+        peak = juce::jmax (peak, view.getMagnitude (offset, count));
+
+        if (! writer.writeFromAudioSampleBuffer (view, offset, count))
+            return "write error";
+    }
+
+    return {};
+}
+
+/**
+ * Writes the file's pitch track (and with writeCsv, the same as CSV next to
+ * it), streaming the input like a render. Returns an error message, or an
+ * empty string.
+ */
+juce::String analyseFile (const Job& job, const Parameters& params, bool writeCsv, int& numVoicedFrames,
+                          const std::function<bool()>& shouldExit)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (job.input));
+    if (reader == nullptr)
+        return "can't read this file";
+
+    if (! job.track.getParentDirectory().createDirectory())
+        return "can't create " + job.track.getParentDirectory().getFullPathName();
+
+    PitchTrackFile::Analyser analyser;
+    analyser.prepare (params, job.sampleRate);
+
+    juce::TemporaryFile trackFile (job.track);
+    {
+        PitchTrackFile::Writer writer (trackFile.getFile().createOutputStream(), analyser.getSettings(),
+                                       PitchTrackFile::Source::fromFile (job.input, job.lengthInSamples, job.numChannels));
+
+        constexpr int chunkSize = 8192;
+        juce::AudioBuffer<float> chunk (job.numChannels, chunkSize);
+
+        for (juce::int64 position = 0; position < job.lengthInSamples; position += chunkSize)
+        {
+            if (shouldExit())
+                return "cancelled";
+
+            auto numSamples = static_cast<int> (juce::jmin (static_cast<juce::int64> (chunkSize), job.lengthInSamples - position));
+            juce::AudioBuffer<float> view (chunk.getArrayOfWritePointers(), job.numChannels, numSamples);
+
+            if (! reader->read (&view, 0, numSamples, position, true, true))
+                return "read error at sample " + juce::String (position);
+
+            if (! analyser.process (view, writer))
+                return "write error";
+        }
+
+        if (! analyser.processTail (job.numChannels, writer) || ! writer.finish())
+            return "write error";
+    }
+
+    // Read back through the reader, which also checks what was written; the
+    // map and the CSV stream close before their files are moved
+    juce::TemporaryFile csvFile (job.track.withFileExtension ("csv"));
+    {
+        PitchTrackFile track;
+        auto opened = track.open (trackFile.getFile());
+        if (opened.failed())
+            return opened.getErrorMessage();
+
+        numVoicedFrames = 0;
+        for (juce::int64 i = 0; i < track.getNumFrames(); ++i)
+            numVoicedFrames += track.getFrame (i).detection.voiced ? 1 : 0;
+
+        if (writeCsv)
+        {
+            juce::FileOutputStream stream (csvFile.getFile());
+            bool written = stream.openedOk() && track.writeCsv (stream);
+            stream.flush();
+
+            if (! written || stream.getStatus().failed())
+                return "can't write " + csvFile.getTargetFile().getFullPathName();
+        }
+    }
+
+    if (writeCsv && ! csvFile.overwriteTargetFileWithTemporary())
+        return "can't move the result to " + csvFile.getTargetFile().getFullPathName();
+
+    if (! trackFile.overwriteTargetFileWithTemporary())
+        return "can't move the result to " + job.track.getFullPathName();
+
+    return {};
+}
+
+/** Opens the job's cached track, if it was analysed from this input with these detection settings. */
+bool openCurrentTrack (const Job& job, const Parameters& params, PitchTrackFile& track)
+{
+    bool current = job.track.existsAsFile()
+                && track.open (job.track).wasOk()
+                && track.getSource() == PitchTrackFile::Source::fromFile (job.input, job.lengthInSamples, job.numChannels)
+                && track.getSettings().hasSameDetection (PitchTrackFile::Settings::fromParameters (params, job.sampleRate));
+
+    if (! current)
+        track.close();
+
+    return current;
+}
+
+/**
+ * Splits a file into segments of about options.segmentSeconds. Each
+ * boundary moves to the quietest point near it, where the renders either
+ * side agree best (the engine's state settles in pauses), and each segment
+ * but the last runs on by overlapSamples, for joinSegments to find the
+ * best place to fade into the next.
+ */
+std::vector<Segment> planSegments (const Job& job, const Options& options, int crossfadeSamples, int overlapSamples)
+{
+    auto length = job.lengthInSamples;
+    auto segmentLength = static_cast<juce::int64> (options.segmentSeconds * job.sampleRate);
+
+    if (segmentLength <= 0 || length < 2 * segmentLength)
+        return { { 0, 0, length } };
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (job.input));
+
+    // Boundaries stay on the analysis hop grid, like the serial render's
+    constexpr int hop = PitchCorrectionEngine::defaultAnalysisHopSize;
+    auto searchRadius = juce::jmin (segmentLength / 4, static_cast<juce::int64> (5.0 * job.sampleRate)) / hop * hop;
+    auto warmUp = static_cast<juce::int64> (options.warmUpSeconds * job.sampleRate);
+
+    std::vector<juce::int64> boundaries { 0 };
+    juce::AudioBuffer<float> window;
+    std::vector<double> energy;
+
+    for (auto nominal = segmentLength / hop * hop; nominal + segmentLength / 2 < length; nominal += segmentLength / hop * hop)
+    {
+        auto from = nominal - searchRadius;
+        auto windowLength = static_cast<int> (2 * searchRadius + crossfadeSamples);
+        window.setSize (job.numChannels, windowLength, false, false, true);
+        auto best = nominal;
+
+        if (reader != nullptr && reader->read (&window, 0, windowLength, from, true, true))
+        {
+            // Running sum of squares, so every candidate costs one subtraction
+            energy.assign (static_cast<size_t> (windowLength) + 1, 0.0);
+            for (int i = 0; i < windowLength; ++i)
+            {
+                double sum = 0.0;
+                for (int ch = 0; ch < job.numChannels; ++ch)
+                    sum += window.getSample (ch, i) * window.getSample (ch, i);
+                energy[static_cast<size_t> (i) + 1] = energy[static_cast<size_t> (i)] + sum;
+            }
+
+            double bestEnergy = std::numeric_limits<double>::max();
+            for (int offset = 0; offset <= 2 * searchRadius; offset += hop)
+            {
+                auto candidateEnergy = energy[static_cast<size_t> (offset + crossfadeSamples)] - energy[static_cast<size_t> (offset)];
+                if (candidateEnergy < bestEnergy)
+                {
+                    bestEnergy = candidateEnergy;
+                    best = from + offset;
+                }
+            }
+        }
+
+        boundaries.push_back (best);
+    }
+
+    std::vector<Segment> segments;
+    for (size_t i = 0; i < boundaries.size(); ++i)
+    {
+        auto start = boundaries[i];
+        auto end = i + 1 < boundaries.size() ? juce::jmin (boundaries[i + 1] + overlapSamples, length) : length;
+        auto preRollStart = juce::jmax (static_cast<juce::int64> (0), (start - warmUp) / hop * hop);
+        segments.push_back ({ preRollStart, start, end });
+    }
+
+    return segments;
+}
+
+/**
+ * Streams the segment renders into one file. Segment i runs on into
+ * segment i + 1 by joinSearchSamples + crossfadeSamples; the fade goes
+ * where the two renders differ least within that overlap. After the
+ * warm-up they're often identical, and the splice is exact. Where they
+ * aren't (the shifter's output phase can differ through a sustained note),
+ * the fade gains follow the renders' correlation, from linear for equal
+ * signals to equal power for unrelated ones, so the level holds through
+ * the fade either way.
+ */
+juce::String joinSegments (const Job& job, const std::vector<Segment>& segments, const std::vector<juce::File>& segmentFiles,
+                           int crossfadeSamples, int joinSearchSamples, juce::AudioFormatWriter& writer, float& peak)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    constexpr int chunkSize = 8192;
+    constexpr int searchStep = 16;
+    auto overlapLength = joinSearchSamples + crossfadeSamples;
+    juce::AudioBuffer<float> chunk (job.numChannels, chunkSize);
+    juce::AudioBuffer<float> outgoing (job.numChannels, overlapLength), incoming (job.numChannels, overlapLength);
+    std::vector<double> outgoingEnergy, incomingEnergy, crossEnergy;
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (segmentFiles[0]));
+    juce::int64 copyStart = 0;      // Within the current segment's render
+
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        if (reader == nullptr)
+            return "can't read back segment " + juce::String (static_cast<int> (i));
+
+        bool isLast = i + 1 == segments.size();
+        auto overlapStart = isLast ? segments[i].end - segments[i].start
+                                   : segments[i + 1].start - segments[i].start;
+        std::unique_ptr<juce::AudioFormatReader> nextReader;
+        int fadeOffset = 0;
+
+        if (! isLast)
+        {
+            nextReader.reset (formatManager.createReaderFor (segmentFiles[i + 1]));
+            if (nextReader == nullptr)
+                return "can't read back segment " + juce::String (static_cast<int> (i + 1));
+
+            reader->read (&outgoing, 0, overlapLength, overlapStart, true, true);
+            nextReader->read (&incoming, 0, overlapLength, 0, true, true);
+
+            // Running sums of a*a, b*b and a*b over the overlap, so each
+            // candidate window costs a few subtractions
+            outgoingEnergy.assign (static_cast<size_t> (overlapLength) + 1, 0.0);
+            incomingEnergy.assign (static_cast<size_t> (overlapLength) + 1, 0.0);
+            crossEnergy.assign (static_cast<size_t> (overlapLength) + 1, 0.0);
+            for (int n = 0; n < overlapLength; ++n)
+            {
+                double a2 = 0.0, b2 = 0.0, ab = 0.0;
+                for (int ch = 0; ch < job.numChannels; ++ch)
+                {
+                    double a = outgoing.getSample (ch, n), b = incoming.getSample (ch, n);
+                    a2 += a * a;
+                    b2 += b * b;
+                    ab += a * b;
+                }
+                auto k = static_cast<size_t> (n);
+                outgoingEnergy[k + 1] = outgoingEnergy[k] + a2;
+                incomingEnergy[k + 1] = incomingEnergy[k] + b2;
+                crossEnergy[k + 1] = crossEnergy[k] + ab;
+            }
+
+            auto windowSum = [crossfadeSamples] (const std::vector<double>& sums, int offset)
+            {
+                return sums[static_cast<size_t> (offset + crossfadeSamples)] - sums[static_cast<size_t> (offset)];
+            };
+
+            // Squared difference, relative to the window's energy and to the
+            // loudest the overlap gets, so a quiet window also scores well
+            double loudest = 0.0;
+            for (int offset = 0; offset <= joinSearchSamples; offset += searchStep)
+                loudest = juce::jmax (loudest, windowSum (outgoingEnergy, offset) + windowSum (incomingEnergy, offset));
+
+            double bestScore = std::numeric_limits<double>::max();
+            double correlation = 1.0;
+            for (int offset = 0; offset <= joinSearchSamples; offset += searchStep)
+            {
+                auto energy = windowSum (outgoingEnergy, offset) + windowSum (incomingEnergy, offset);
+                auto cross = windowSum (crossEnergy, offset);
+                auto score = (energy - 2.0 * cross) / (loudest + 1.0e-20);
+
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    fadeOffset = offset;
+                    correlation = energy > 1.0e-20 ? 2.0 * cross / energy : 1.0;
+                }
+            }
+
+            // Fade gains for renders with this correlation, as even and odd
+            // parts of the fade: e^2 + o^2 + 2r(e^2 - o^2) = 1/2 keeps the
+            // level. A pair that nearly cancels would need ever larger gains,
+            // so r stops at -0.7.
+            auto r = juce::jlimit (-0.7, 1.0, correlation);
+            for (int n = 0; n < crossfadeSamples; ++n)
+            {
+                double odd = (n + 0.5) / crossfadeSamples - 0.5;
+                double even = std::sqrt (juce::jmax (0.0, 0.5 / (1.0 + r) - (1.0 - r) / (1.0 + r) * odd * odd));
+                auto outGain = static_cast<float> (even - odd);
+                auto inGain = static_cast<float> (even + odd);
+
+                for (int ch = 0; ch < job.numChannels; ++ch)
+                {
+                    auto index = fadeOffset + n;
+                    outgoing.setSample (ch, index, outGain * outgoing.getSample (ch, index) + inGain * incoming.getSample (ch, index));
+                }
+            }
+        }
+
+        // Up to the fade (or the end), then the fade itself
+        auto copyEnd = overlapStart + fadeOffset;
+        for (auto position = copyStart; position < copyEnd; position += chunkSize)
+        {
+            auto numSamples = static_cast<int> (juce::jmin (static_cast<juce::int64> (chunkSize), copyEnd - position));
+            reader->read (&chunk, 0, numSamples, position, true, true);
+            peak = juce::jmax (peak, chunk.getMagnitude (0, numSamples));
+
+            if (! writer.writeFromAudioSampleBuffer (chunk, 0, numSamples))
+                return "write error";
+        }
+
+        if (isLast)
+            break;
+
+        peak = juce::jmax (peak, outgoing.getMagnitude (fadeOffset, crossfadeSamples));
+        if (! writer.writeFromAudioSampleBuffer (outgoing, fadeOffset, crossfadeSamples))
+            return "write error";
+
+        reader = std::move (nextReader);
+        copyStart = fadeOffset + crossfadeSamples;
+    }
+
+    return {};
+}
+
+struct Comparison
+{
+    double snrDb = 0.0;                     // Sample by sample
+    double meanPitchCents = 0.0;            // Re-detected pitch, frames voiced in both...
+    double grossPitchRate = 0.0;            // ...and the fraction of those over 50 cents apart
+    double p99LevelDb = 0.0;                // Frame level, frames above -60 dBFS in either
+    double maxJoinLevelDb = 0.0;            // Frame level, worst frame around a join
+    double voicingAgreement = 1.0;          // Frames voiced in both or in neither
+
+    // The same pitch measures over the frames around each join, worst join:
+    // an error at one join is too short to move the whole-file figures
+    double joinPitchCents = 0.0;
+    double joinGrossPitchRate = 0.0;
+    double joinVoicingAgreement = 1.0;
+};
+
+double percentile99 (std::vector<double>& values)
+{
+    if (values.empty())
+        return 0.0;
+
+    auto index = (values.size() - 1) * 99 / 100;
+    std::nth_element (values.begin(), values.begin() + static_cast<long> (index), values.end());
+    return values[index];
+}
+
+/**
+ * Compares two renders of the same file by what is heard: the pitch the
+ * detector finds in each and the level, frame by frame. Sample differences
+ * only say whether they're identical: a shifter's output phase depends on
+ * all of its history, so renders that sound the same (a warmed-up segment,
+ * or the same file started one sample later) can be far apart sample by
+ * sample, and so can their fine spectra.
+ */
+juce::String compareRenders (const Job& job, const Parameters& params, const juce::File& fileA, const juce::File& fileB,
+                             const std::vector<Segment>& segments, Comparison& comparison)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> readerA (formatManager.createReaderFor (fileA));
+    std::unique_ptr<juce::AudioFormatReader> readerB (formatManager.createReaderFor (fileB));
+    if (readerA == nullptr || readerB == nullptr)
+        return "can't read back the renders to compare";
+
+    constexpr int frameSize = 1024;
+    PitchDetector detectorA, detectorB;
+    for (auto* detector : { &detectorA, &detectorB })
+    {
+        detector->setInputType (params.inputType);
+        detector->prepare (job.sampleRate, frameSize);
+    }
+
+    juce::AudioBuffer<float> frameA (job.numChannels, frameSize), frameB (job.numChannels, frameSize);
+    std::vector<float> monoA (frameSize), monoB (frameSize);
+    std::vector<double> pitchDifferences, levelsA, levelsB;
+    int voicedFrames = 0, agreeingFrames = 0, grossPitchFrames = 0;
+    double signalEnergy = 0.0, errorEnergy = 0.0;
+
+    struct PitchMatch                       // Every frame, for the windows around joins
+    {
+        bool voiced = false;                // In either render
+        bool agreeing = false;              // In both
+        double cents = 0.0;
+    };
+    std::vector<PitchMatch> pitchMatches;
+
+    auto mixToMono = [&job] (const juce::AudioBuffer<float>& frame, std::vector<float>& mono)
+    {
+        juce::FloatVectorOperations::copy (mono.data(), frame.getReadPointer (0), frameSize);
+        for (int ch = 1; ch < job.numChannels; ++ch)
+            juce::FloatVectorOperations::add (mono.data(), frame.getReadPointer (ch), frameSize);
+        juce::FloatVectorOperations::multiply (mono.data(), 1.0f / static_cast<float> (job.numChannels), frameSize);
+    };
+
+    auto levelDb = [] (const std::vector<float>& mono)
+    {
+        double energy = 0.0;
+        for (auto sample : mono)
+            energy += static_cast<double> (sample) * sample;
+        return 10.0 * std::log10 (energy / frameSize + 1.0e-20);
+    };
+
+    for (juce::int64 position = 0; position < job.lengthInSamples; position += frameSize)
+    {
+        readerA->read (&frameA, 0, frameSize, position, true, true);
+        readerB->read (&frameB, 0, frameSize, position, true, true);
+
+        for (int ch = 0; ch < job.numChannels; ++ch)
+        {
+            for (int i = 0; i < frameSize; ++i)
+            {
+                double difference = frameA.getSample (ch, i) - frameB.getSample (ch, i);
+                signalEnergy += static_cast<double> (frameB.getSample (ch, i)) * frameB.getSample (ch, i);
+                errorEnergy += difference * difference;
+            }
+        }
+
+        mixToMono (frameA, monoA);
+        mixToMono (frameB, monoB);
+
+        // Detected hop by hop as the engine does: fed whole frames, the
+        // detector's tracking can hold a subharmonic for a second or more
+        PitchDetector::Result resultA, resultB;
+        for (int hop = 0; hop < frameSize; hop += PitchCorrectionEngine::defaultAnalysisHopSize)
+        {
+            resultA = detectorA.process (monoA.data() + hop, PitchCorrectionEngine::defaultAnalysisHopSize);
+            resultB = detectorB.process (monoB.data() + hop, PitchCorrectionEngine::defaultAnalysisHopSize);
+        }
+
+        levelsA.push_back (levelDb (monoA));
+        levelsB.push_back (levelDb (monoB));
+        auto& match = pitchMatches.emplace_back();
+        if (juce::jmax (levelsA.back(), levelsB.back()) < -60.0)
+            continue;
+
+        if (resultA.voiced || resultB.voiced)
+        {
+            ++voicedFrames;
+            match.voiced = true;
+            if (resultA.voiced && resultB.voiced)
+            {
+                ++agreeingFrames;
+                auto cents = std::abs (1200.0 * std::log2 (resultA.frequency / resultB.frequency));
+                match.agreeing = true;
+                match.cents = cents;
+                if (cents > 50.0)
+                    ++grossPitchFrames;
+                else
+                    pitchDifferences.push_back (cents);
+            }
+        }
+    }
+
+    // Onsets and note ends may move by a few milliseconds between renders
+    // (the Eco shifter adds and drops whole cycles), which changes the level
+    // of a frame in a fade by several dB. Nothing more than 10 dB below the
+    // loudest frame within two frames either side is heard (temporal
+    // masking), so levels are raised to that floor first; a dropout or a
+    // click still shows in full.
+    std::vector<double> levelDifferences;
+    for (size_t i = 0; i < levelsA.size(); ++i)
+    {
+        if (juce::jmax (levelsA[i], levelsB[i]) < -60.0)
+            continue;
+
+        double loudest = -200.0;
+        for (size_t j = i > 2 ? i - 2 : 0; j < juce::jmin (i + 3, levelsA.size()); ++j)
+            loudest = juce::jmax (loudest, levelsA[j], levelsB[j]);
+
+        auto maskingFloor = loudest - 10.0;
+        auto difference = std::abs (juce::jmax (levelsA[i], maskingFloor) - juce::jmax (levelsB[i], maskingFloor));
+        levelDifferences.push_back (difference);
+
+        // Joins are too few for a percentile to notice, so the frames
+        // around each are checked on their own
+        auto frameStart = static_cast<juce::int64> (i) * frameSize;
+        for (size_t segment = 1; segment < segments.size(); ++segment)
+            if (std::abs (frameStart - segments[segment].start) <= 3 * frameSize)
+                comparison.maxJoinLevelDb = juce::jmax (comparison.maxJoinLevelDb, difference);
+    }
+
+    // Half a second either side of a join: long enough for the detector to
+    // settle on a note, short enough that one bad join isn't averaged away
+    auto joinFrames = static_cast<juce::int64> (0.5 * job.sampleRate / frameSize);
+    for (size_t segment = 1; segment < segments.size(); ++segment)
+    {
+        auto joinFrame = segments[segment].start / frameSize;
+        auto first = static_cast<size_t> (juce::jmax (static_cast<juce::int64> (0), joinFrame - joinFrames));
+        auto last = static_cast<size_t> (juce::jmin (static_cast<juce::int64> (pitchMatches.size()), joinFrame + joinFrames + 1));
+
+        int joinVoiced = 0, joinAgreeing = 0, joinGross = 0, joinFine = 0;
+        double joinCents = 0.0;
+        for (auto i = first; i < last; ++i)
+        {
+            const auto& match = pitchMatches[i];
+            joinVoiced += match.voiced ? 1 : 0;
+            if (! match.agreeing)
+                continue;
+
+            ++joinAgreeing;
+            if (match.cents > 50.0)
+            {
+                ++joinGross;
+            }
+            else
+            {
+                ++joinFine;
+                joinCents += match.cents;
+            }
+        }
+
+        if (joinFine > 0)
+            comparison.joinPitchCents = juce::jmax (comparison.joinPitchCents, joinCents / joinFine);
+        if (joinAgreeing > 0)
+            comparison.joinGrossPitchRate = juce::jmax (comparison.joinGrossPitchRate,
+                                                        static_cast<double> (joinGross) / joinAgreeing);
+        if (joinVoiced > 0)
+            comparison.joinVoicingAgreement = juce::jmin (comparison.joinVoicingAgreement,
+                                                          static_cast<double> (joinAgreeing) / joinVoiced);
+    }
+
+    comparison.snrDb = errorEnergy > 0.0 ? 10.0 * std::log10 (signalEnergy / errorEnergy) : 999.0;
+    comparison.meanPitchCents = pitchDifferences.empty() ? 0.0
+                              : std::accumulate (pitchDifferences.begin(), pitchDifferences.end(), 0.0)
+                                    / static_cast<double> (pitchDifferences.size());
+    comparison.grossPitchRate = agreeingFrames > 0 ? static_cast<double> (grossPitchFrames) / agreeingFrames : 0.0;
+    comparison.p99LevelDb = percentile99 (levelDifferences);
+    comparison.voicingAgreement = voicedFrames > 0 ? static_cast<double> (agreeingFrames) / voicedFrames : 1.0;
+    return {};
+}
+
+void printUsage()
+{
+    std::cerr << "Usage: ProTuneBatch [options] <file or directory>... --out <directory>\n"
+                 "  --preset <file.json>   engine settings keyed by plugin parameter ID\n"
+                 "  --<parameterID> <v>    a single setting, e.g. --key F# --scaleMode Major\n"
+                 "  --jobs <n>             files rendered at once (default: one per core)\n"
+                 "  --block <n>            samples per process() call (default 512)\n"
+                 "  --format <ext>         wav, aiff or flac (default: same as input)\n"
+                 "  --bits <n>             output bit depth (default: same as input)\n"
+                 "  --recursive            search directories recursively\n"
+                 "  --overwrite            replace existing outputs (default: skip)\n"
+                 "  --segment <s>          split files at least twice this long into segments\n"
+                 "                         of 5 s or more, rendered in parallel (default 0)\n"
+                 "  --warmup <s>           audio run through before each segment (default 2)\n"
+                 "  --crossfade <ms>       fade between segments (default 20)\n"
+                 "  --verify               also render split files serially and compare\n"
+                 "  --analyse              write pitch tracks (.ptrk and .csv) instead of audio\n"
+                 "  --pitch-cache <dir>    render from cached pitch tracks, analysing any\n"
+                 "                         missing or out of date first\n"
+                 "  --lookahead <ms>       decide pitch seeing this far ahead, as plugin\n"
+                 "                         bounces do (default 0: as in realtime)" << std::endl;
+}
+
+bool parseOptions (int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String arg (argv[i]);
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h")
+            return false;
+        else if (arg == "--recursive")
+            options.recursive = true;
+        else if (arg == "--overwrite")
+            options.overwrite = true;
+        else if (arg == "--verify")
+            options.verify = true;
+        else if (arg == "--analyse" || arg == "--analyze")
+            options.analyseOnly = true;
+        else if (! arg.startsWith ("--"))
+            options.inputs.add (juce::File::getCurrentWorkingDirectory().getChildFile (arg));
+        else if (! hasValue)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        else if (arg == "--out")
+            options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else if (arg == "--preset")
+            options.presetFile = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else if (arg == "--jobs")
+            options.jobs = juce::jlimit (1, 256, juce::String (argv[++i]).getIntValue());
+        else if (arg == "--block")
+            options.blockSize = juce::jlimit (16, 65536, juce::String (argv[++i]).getIntValue());
+        else if (arg == "--format")
+            options.format = juce::String (argv[++i]).trimCharactersAtStart (".").toLowerCase();
+        else if (arg == "--bits")
+            options.bitsPerSample = juce::String (argv[++i]).getIntValue();
+        else if (arg == "--segment")
+        {
+            auto seconds = juce::String (argv[++i]).getDoubleValue();
+            options.segmentSeconds = seconds > 0.0 ? juce::jmax (5.0, seconds) : 0.0;
+        }
+        else if (arg == "--warmup")
+            options.warmUpSeconds = juce::jlimit (0.0, 60.0, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--crossfade")
+            options.crossfadeMs = juce::jlimit (1.0, 1000.0, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--pitch-cache")
+            options.pitchCacheDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else if (arg == "--lookahead")
+            options.overrides.set ("offlineLookahead", argv[++i]);
+        else
+            options.overrides.set (arg.substring (2), argv[++i]);
+    }
+
+    if (options.inputs.isEmpty() || options.outputDirectory == juce::File())
+    {
+        std::cerr << "Need at least one input and --out" << std::endl;
+        return false;
+    }
+
+    if (options.format.isNotEmpty() && ! losslessExtensions.contains (options.format))
+    {
+        std::cerr << "Unsupported --format: " << options.format << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Expands directories, skips unreadable files, and pairs each input with its
+ * output (its pitch track with --analyse) and any cached track.
+ */
+std::vector<Job> collectJobs (const Options& options)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    struct Input
+    {
+        juce::File file;
+        juce::File root;        // Output paths are relative to this
+    };
+
+    std::vector<Input> inputs;
+    for (const auto& input : options.inputs)
+    {
+        if (input.isDirectory())
+        {
+            for (const auto& entry : juce::RangedDirectoryIterator (input, options.recursive,
+                                                                     formatManager.getWildcardForAllFormats()))
+                inputs.push_back ({ entry.getFile(), input });
+        }
+        else if (input.existsAsFile())
+        {
+            inputs.push_back ({ input, input.getParentDirectory() });
+        }
+        else
+        {
+            std::cerr << "Not found: " << input.getFullPathName() << std::endl;
+        }
+    }
+
+    std::vector<Job> jobs;
+    for (const auto& input : inputs)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (input.file));
+        if (reader == nullptr)
+        {
+            std::cerr << "Skipping (not a readable audio file): " << input.file.getFullPathName() << std::endl;
+            continue;
+        }
+
+        // Keep the input's format if it's a lossless one, otherwise use WAV
+        auto extension = options.format.isNotEmpty() ? options.format
+                                                     : input.file.getFileExtension().substring (1).toLowerCase();
+        if (! losslessExtensions.contains (extension))
+            extension = "wav";
+
+        auto relative = input.file.getRelativePathFrom (input.root);
+        auto output = options.outputDirectory.getChildFile (relative).withFileExtension (options.analyseOnly ? "ptrk" : extension);
+        auto track = options.analyseOnly ? output
+                   : options.pitchCacheDirectory != juce::File() ? options.pitchCacheDirectory.getChildFile (relative).withFileExtension ("ptrk")
+                                                                 : juce::File();
+
+        if (output == input.file)
+        {
+            std::cerr << "Skipping (output would replace input): " << input.file.getFullPathName() << std::endl;
+            continue;
+        }
+
+        if (output.existsAsFile() && ! options.overwrite)
+        {
+            std::cerr << "Skipping (exists, use --overwrite): " << output.getFullPathName() << std::endl;
+            continue;
+        }
+
+        auto bitsPerSample = options.bitsPerSample > 0 ? options.bitsPerSample
+                                                       : static_cast<int> (reader->bitsPerSample);
+        if (! formatManager.findFormatForFileExtension (extension)->getPossibleBitDepths().contains (bitsPerSample))
+            bitsPerSample = 24;
+
+        jobs.push_back ({ input.file, output, track, reader->lengthInSamples, reader->sampleRate,
+                          static_cast<int> (reader->numChannels), bitsPerSample });
+    }
+
+    return jobs;
+}
+
+/**
+ * Writes the jobs' pitch tracks, a file per pool task, and reports each.
+ * Returns the number that failed.
+ */
+int analyseFiles (const std::vector<Job>& jobs, const Parameters& params, const Options& options)
+{
+    auto numThreads = juce::jmin (options.jobs, static_cast<int> (jobs.size()));
+    std::cerr << "Analysing " << jobs.size() << " file(s) on " << numThreads << " thread(s)" << std::endl;
+
+    std::mutex outputLock;
+    int numFinished = 0;
+    int numFailed = 0;
+
+    juce::ThreadPool pool (juce::ThreadPoolOptions().withThreadName ("ProTuneBatch")
+                                                    .withNumberOfThreads (numThreads));
+
+    for (const auto& job : jobs)
+    {
+        pool.addJob ([&, job]
+        {
+            auto* poolJob = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+            auto startTime = std::chrono::steady_clock::now();
+            int numVoicedFrames = 0;
+            auto error = analyseFile (job, params, options.analyseOnly, numVoicedFrames,
+                                      [poolJob] { return poolJob->shouldExit(); });
+
+            auto audioSeconds = static_cast<double> (job.lengthInSamples) / job.sampleRate;
+            auto analysisSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+            auto numFrames = job.lengthInSamples / PitchCorrectionEngine::defaultAnalysisHopSize;
+
+            std::lock_guard<std::mutex> lock (outputLock);
+            std::cout << "[" << ++numFinished << "/" << jobs.size() << "] " << job.input.getFileName()
+                      << std::fixed << std::setprecision (1);
+
+            if (error.isEmpty())
+                std::cout << "  " << audioSeconds << " s analysed in " << analysisSeconds << " s  "
+                          << (numFrames > 0 ? 100.0 * juce::jmin (numFrames, static_cast<juce::int64> (numVoicedFrames)) / numFrames : 0.0)
+                          << "% voiced" << std::endl;
+            else
+                std::cout << "  FAILED: " << error << std::endl;
+
+            numFailed += error.isEmpty() ? 0 : 1;
+        });
+    }
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep (50);
+
+    return numFailed;
+}
+}
+
+int main (int argc, char* argv[])
+{
+    Options options;
+    if (! parseOptions (argc, argv, options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    // Preset first, then flags on top, then derived fields
+    Parameters params;
+    if (options.presetFile != juce::File())
+    {
+        auto error = loadPreset (options.presetFile, params, options.lookaheadMs);
+        if (error.isNotEmpty())
+        {
+            std::cerr << error << std::endl;
+            return 2;
+        }
+    }
+
+    for (const auto& id : options.overrides.getAllKeys())
+    {
+        auto error = applySetting (params, options.lookaheadMs, id, options.overrides[id]);
+        if (error.isNotEmpty())
+        {
+            std::cerr << error << std::endl;
+            return 2;
+        }
+    }
+
+    finaliseParameters (params);
+
+    auto jobs = collectJobs (options);
+    if (jobs.empty())
+    {
+        std::cerr << "Nothing to render" << std::endl;
+        return 1;
+    }
+
+    if (options.analyseOnly)
+        return analyseFiles (jobs, params, options) == 0 ? 0 : 1;
+
+    // Cached tracks are brought up to date before anything renders from them
+    std::vector<Job> staleTracks;
+    if (options.pitchCacheDirectory != juce::File())
+    {
+        for (const auto& job : jobs)
+        {
+            PitchTrackFile track;
+            if (! openCurrentTrack (job, params, track))
+                staleTracks.push_back (job);
+        }
+
+        std::cerr << "Pitch cache: " << jobs.size() - staleTracks.size() << " of " << jobs.size()
+                  << " track(s) up to date" << std::endl;
+
+        if (! staleTracks.empty() && analyseFiles (staleTracks, params, options) > 0)
+            std::cerr << "Files without a track detect as they render" << std::endl;
+    }
+
+    // Every file becomes one task per segment, plus a serial reference
+    // render with --verify. Whichever of a file's tasks finishes last joins
+    // the segments and moves the result into place.
+    struct FileRender
+    {
+        Job job;
+        std::vector<Segment> segments;
+        std::vector<std::unique_ptr<juce::TemporaryFile>> segmentFiles;
+        std::unique_ptr<juce::TemporaryFile> serialFile;
+        PitchTrackFile track;                   // Open if rendering from the cache
+        int crossfadeSamples = 0;
+        int joinSearchSamples = 0;
+
+        std::atomic<int> tasksRemaining { 0 };
+        std::mutex lock;
+        juce::String error;
+        float peak = 0.0f;
+        std::once_flag started;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    struct Task
+    {
+        FileRender* file;
+        int segment;                // -1 for the serial reference
+        juce::int64 length;
+    };
+
+    std::vector<std::unique_ptr<FileRender>> files;
+    std::vector<Task> tasks;
+
+    for (const auto& job : jobs)
+    {
+        auto file = std::make_unique<FileRender>();
+        file->job = job;
+        if (job.track != juce::File())
+            openCurrentTrack (job, params, file->track);
+        file->crossfadeSamples = juce::jmax (1, static_cast<int> (options.crossfadeMs * 0.001 * job.sampleRate));
+        file->joinSearchSamples = static_cast<int> (joinSearchSeconds * job.sampleRate);
+        file->segments = planSegments (job, options, file->crossfadeSamples,
+                                       file->joinSearchSamples + file->crossfadeSamples);
+
+        // A single segment is written in the output format next to its
+        // target; segments to be joined, and the reference, as float WAV
+        bool isSplit = file->segments.size() > 1;
+        auto intermediate = job.output.withFileExtension ("wav");
+        for (size_t i = 0; i < file->segments.size(); ++i)
+        {
+            const auto& segment = file->segments[i];
+            file->segmentFiles.push_back (std::make_unique<juce::TemporaryFile> (isSplit ? intermediate : job.output));
+            tasks.push_back ({ file.get(), static_cast<int> (i), segment.end - segment.preRollStart });
+        }
+
+        if (options.verify && isSplit)
+        {
+            file->serialFile = std::make_unique<juce::TemporaryFile> (intermediate);
+            tasks.push_back ({ file.get(), -1, job.lengthInSamples });
+        }
+
+        file->tasksRemaining = static_cast<int> (file->segmentFiles.size()) + (file->serialFile != nullptr ? 1 : 0);
+        files.push_back (std::move (file));
+    }
+
+    // The pool's workers take the next task from one shared queue as they
+    // finish, so tasks of any length balance across the cores by
+    // themselves. Longest first keeps a long one from starting last.
+    std::stable_sort (tasks.begin(), tasks.end(), [] (const Task& a, const Task& b)
+    {
+        return a.length > b.length;
+    });
+
+    auto numThreads = juce::jmin (options.jobs, static_cast<int> (tasks.size()));
+    std::cerr << "Rendering " << files.size() << " file(s) as " << tasks.size() << " task(s) on "
+              << numThreads << " thread(s)" << std::endl;
+
+    std::mutex outputLock;
+    int numFinished = 0;
+    int numFailed = 0;
+    double totalAudioSeconds = 0.0;
+    auto startTime = std::chrono::steady_clock::now();
+
+    auto finishFile = [&] (FileRender& file)
+    {
+        const auto& job = file.job;
+        auto error = file.error;
+        Comparison comparison;
+        bool compared = false;
+
+        // A split file is joined next to its target, and checked against
+        // the serial render before it replaces anything
+        std::unique_ptr<juce::TemporaryFile> joined;
+
+        if (error.isEmpty() && file.segments.size() > 1)
+        {
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            auto* format = formatManager.findFormatForFileExtension (job.output.getFileExtension());
+
+            joined = std::make_unique<juce::TemporaryFile> (job.output);
+            std::vector<juce::File> segmentFiles;
+            for (const auto& segmentFile : file.segmentFiles)
+                segmentFiles.push_back (segmentFile->getFile());
+
+            if (auto writer = createWriter (*format, joined->getFile(), job, job.bitsPerSample))
+                error = joinSegments (job, file.segments, segmentFiles, file.crossfadeSamples,
+                                      file.joinSearchSamples, *writer, file.peak);
+            else
+                error = "can't write " + joined->getFile().getFullPathName();
+
+            file.segmentFiles.clear();
+        }
+
+        if (error.isEmpty() && file.serialFile != nullptr)
+        {
+            error = compareRenders (job, params, joined->getFile(), file.serialFile->getFile(), file.segments, comparison);
+            compared = error.isEmpty();
+            if (compared && (comparison.meanPitchCents > options.maxPitchCents
+                             || comparison.grossPitchRate > options.maxGrossPitchRate
+                             || comparison.p99LevelDb > options.maxLevelDb
+                             || comparison.maxJoinLevelDb > options.maxJoinLevelDb
+                             || comparison.voicingAgreement < options.minVoicingAgreement
+                             || comparison.joinPitchCents > options.maxJoinPitchCents
+                             || comparison.joinGrossPitchRate > options.maxJoinGrossPitchRate
+                             || comparison.joinVoicingAgreement < options.minJoinVoicingAgreement))
+                error = "differs audibly from a serial render";
+        }
+
+        auto& result = joined != nullptr ? *joined : *file.segmentFiles[0];
+        if (error.isEmpty() && ! result.overwriteTargetFileWithTemporary())
+            error = "can't move the result to " + job.output.getFullPathName();
+
+        joined.reset();
+        file.segmentFiles.clear();
+        file.serialFile.reset();
+
+        auto audioSeconds = static_cast<double> (job.lengthInSamples) / job.sampleRate;
+        auto renderSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - file.startTime).count();
+
+        std::lock_guard<std::mutex> lock (outputLock);
+        std::cout << "[" << ++numFinished << "/" << files.size() << "] " << job.input.getFileName()
+                  << std::fixed << std::setprecision (1);
+
+        if (error.isEmpty())
+        {
+            totalAudioSeconds += audioSeconds;
+            std::cout << "  " << audioSeconds << " s in " << renderSeconds << " s";
+            if (file.segments.size() > 1)
+                std::cout << " (" << file.segments.size() << " segments)";
+            std::cout << "  peak " << juce::Decibels::gainToDecibels (file.peak) << " dBFS"
+                      << (file.peak > 1.0f ? "  CLIPPED" : "");
+        }
+        else
+        {
+            ++numFailed;
+            std::cout << "  FAILED: " << error;
+        }
+
+        if (compared)
+            std::cout << std::setprecision (2)
+                      << "\n    vs serial: pitch " << comparison.meanPitchCents << " cents ("
+                      << comparison.grossPitchRate * 100.0 << "% over 50), level p99 " << comparison.p99LevelDb
+                      << " dB (joins " << comparison.maxJoinLevelDb << " dB), voicing agreement "
+                      << comparison.voicingAgreement * 100.0 << "%"
+                      << "\n    worst join: pitch " << comparison.joinPitchCents << " cents ("
+                      << comparison.joinGrossPitchRate * 100.0 << "% over 50), voicing agreement "
+                      << comparison.joinVoicingAgreement * 100.0 << "%, sample SNR " << std::setprecision (1)
+                      << comparison.snrDb << " dB";
+
+        std::cout << std::endl;
+    };
+
+    {
+        juce::ThreadPool pool (juce::ThreadPoolOptions().withThreadName ("ProTuneBatch")
+                                                        .withNumberOfThreads (numThreads));
+
+        for (const auto& task : tasks)
+        {
+            pool.addJob ([&, task]
+            {
+                auto& file = *task.file;
+                std::call_once (file.started, [&file] { file.startTime = std::chrono::steady_clock::now(); });
+
+                auto* poolJob = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+                auto shouldExit = [poolJob] { return poolJob->shouldExit(); };
+
+                // The reference is the whole file, rendered as one segment
+                auto segment = task.segment >= 0 ? file.segments[static_cast<size_t> (task.segment)]
+                                                 : Segment { 0, 0, file.job.lengthInSamples };
+                auto destination = task.segment >= 0 ? file.segmentFiles[static_cast<size_t> (task.segment)]->getFile()
+                                                     : file.serialFile->getFile();
+
+                juce::AudioFormatManager formatManager;
+                formatManager.registerBasicFormats();
+                auto* format = formatManager.findFormatForFileExtension (destination.getFileExtension());
+                auto bitsPerSample = file.segments.size() > 1 ? 32 : file.job.bitsPerSample;
+
+                juce::String error;
+                float peak = 0.0f;
+
+                if (! destination.getParentDirectory().createDirectory())
+                    error = "can't create " + destination.getParentDirectory().getFullPathName();
+                else if (auto writer = createWriter (*format, destination, file.job, bitsPerSample))
+                    error = renderSegment (file.job, segment, params, file.track.isOpen() ? &file.track : nullptr,
+                                           options.lookaheadMs, options.blockSize, *writer, peak, shouldExit);
+                else
+                    error = "can't write " + format->getFormatName() + " at " + juce::String (bitsPerSample) + " bits";
+
+                {
+                    std::lock_guard<std::mutex> lock (file.lock);
+                    if (error.isNotEmpty() && file.error.isEmpty())
+                        file.error = error;
+                    if (task.segment >= 0)
+                        file.peak = juce::jmax (file.peak, peak);
+                }
+
+                if (--file.tasksRemaining == 0)
+                    finishFile (file);
+            });
+        }
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep (50);
+    }
+
+    auto elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+    std::cout << std::fixed << std::setprecision (1)
+              << "\nRendered " << (static_cast<int> (files.size()) - numFailed) << " of " << files.size()
+              << " file(s), " << totalAudioSeconds << " s of audio in " << elapsed << " s";
+    if (elapsed > 0.0)
+        std::cout << " (" << totalAudioSeconds / elapsed << "x real time)";
+    std::cout << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
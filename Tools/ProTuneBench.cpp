@@ -0,0 +1,467 @@
+/**
+ * ProTuneBench
+ *
+ * Times each DSP stage on its own and the whole engine across sample rates,
+ * block sizes, channel counts and input types, on a synthetic vocal-like
+ * signal. Prints a table to stderr and JSON to stdout (or --out <file>) so
+ * builds can be compared.
+ *
+ * Usage: ProTuneBench [--quick] [--seconds <s>] [--out <file.json>]
+ *
+ * Per run: ns/sample (mean), real-time factor (processing time / audio
+ * time, lower is better) and p50/p99/max microseconds per block. The first
+ * blocks of every run are warm-up and not counted.
+ */
+#include "../Source/PitchCorrectionEngine.h"
+#include "../Source/PeriodKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+constexpr int schemaVersion = 1;
+constexpr int hopSize = PitchCorrectionEngine::defaultAnalysisHopSize;
+constexpr float shiftRatio = 1.0594631f;        // One semitone up
+
+struct InputTypeInfo
+{
+    PitchDetector::InputType type;
+    const char* name;
+    float testFrequency;
+};
+
+const InputTypeInfo inputTypes[] = {
+    { PitchDetector::InputType::Soprano,        "Soprano",      440.0f },
+    { PitchDetector::InputType::AltoTenor,      "AltoTenor",    220.0f },
+    { PitchDetector::InputType::LowMale,        "LowMale",      110.0f },
+    { PitchDetector::InputType::Instrument,     "Instrument",   330.0f },
+    { PitchDetector::InputType::BassInstrument, "BassInst",      55.0f }
+};
+
+struct Options
+{
+    bool quick = false;
+    double seconds = 3.0;
+    juce::String outputPath;
+};
+
+struct Config
+{
+    double sampleRate = 44100.0;
+    int blockSize = 256;
+    int channels = 1;
+    const InputTypeInfo* input = nullptr;
+};
+
+// Test signal: per-channel audio plus the true f0 per sample
+struct VoiceSignal
+{
+    std::vector<std::vector<float>> channels;
+    std::vector<float> f0;
+    int numSamples = 0;
+};
+
+// Vocal-like test signal: a harmonic source shaped by two formants (an
+// "ah"), 5.5 Hz vibrato of +-30 cents on a slow drift, breath noise, and
+// 1.5 s phrases separated by short unvoiced gaps. The second channel is the
+// same voice with its own noise, as from a second microphone.
+VoiceSignal makeVoice (double sampleRate, float frequency, double seconds)
+{
+    VoiceSignal signal;
+    signal.numSamples = static_cast<int> (sampleRate * seconds);
+    signal.f0.resize (static_cast<size_t> (signal.numSamples));
+    signal.channels.assign (2, std::vector<float> (static_cast<size_t> (signal.numSamples)));
+
+    auto formantGain = [] (double hz)
+    {
+        auto resonance = [hz] (double centre, double bandwidth)
+        {
+            double x = (hz - centre) / bandwidth;
+            return 1.0 / (1.0 + x * x);
+        };
+
+        return 0.2 + resonance (700.0, 130.0) + 0.6 * resonance (1220.0, 160.0);
+    };
+
+    int numHarmonics = juce::jlimit (1, 40, static_cast<int> (sampleRate * 0.45 / frequency));
+    std::vector<double> harmonicGains (static_cast<size_t> (numHarmonics));
+    for (int h = 1; h <= numHarmonics; ++h)
+        harmonicGains[static_cast<size_t> (h - 1)] = formantGain (frequency * h) / h;
+
+    juce::Random random (1234);
+    double phase = 0.0;
+    int phraseLength = static_cast<int> (1.5 * sampleRate);
+    int gapLength = static_cast<int> (0.2 * sampleRate);
+
+    for (int i = 0; i < signal.numSamples; ++i)
+    {
+        double t = i / sampleRate;
+        double cents = 30.0 * std::sin (juce::MathConstants<double>::twoPi * 5.5 * t)
+                     + 20.0 * std::sin (juce::MathConstants<double>::twoPi * 0.3 * t);
+        double hz = frequency * std::pow (2.0, cents / 1200.0);
+
+        int phrasePosition = i % (phraseLength + gapLength);
+        bool voiced = phrasePosition < phraseLength;
+        double envelope = voiced ? juce::jmin (1.0, phrasePosition / (0.05 * sampleRate)) : 0.0;
+
+        double value = 0.0;
+        if (voiced)
+            for (int h = 1; h <= numHarmonics; ++h)
+                value += harmonicGains[static_cast<size_t> (h - 1)] * std::sin (phase * h);
+
+        phase = std::fmod (phase + juce::MathConstants<double>::twoPi * hz / sampleRate,
+                           juce::MathConstants<double>::twoPi);
+
+        auto index = static_cast<size_t> (i);
+        signal.f0[index] = voiced ? static_cast<float> (hz) : 0.0f;
+        for (auto& channel : signal.channels)
+            channel[index] = static_cast<float> (0.25 * envelope * value + 0.01 * (random.nextFloat() - 0.5f));
+    }
+
+    return signal;
+}
+
+// Leading blocks of a run that are processed but not measured
+int getWarmupBlocks (int numSamples, int blockSize)
+{
+    return juce::jmin (numSamples / blockSize / 8, 64);
+}
+
+// Runs processBlock (start, numSamples) over the whole signal and returns
+// nanoseconds per block, without the warm-up blocks
+template <typename ProcessBlock>
+std::vector<double> timeBlocks (int numSamples, int blockSize, ProcessBlock&& processBlock)
+{
+    int numBlocks = numSamples / blockSize;
+    int warmupBlocks = getWarmupBlocks (numSamples, blockSize);
+
+    std::vector<double> blockNs;
+    blockNs.reserve (static_cast<size_t> (numBlocks));
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        auto start = std::chrono::steady_clock::now();
+        processBlock (block * blockSize, blockSize);
+        auto elapsed = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start);
+
+        if (block >= warmupBlocks)
+            blockNs.push_back (elapsed.count());
+    }
+
+    return blockNs;
+}
+
+juce::var summarise (const char* stage, const Config& config, std::vector<double> blockNs)
+{
+    std::sort (blockNs.begin(), blockNs.end());
+
+    auto percentile = [&blockNs] (double p)
+    {
+        auto index = static_cast<size_t> (p * static_cast<double> (blockNs.size() - 1) + 0.5);
+        return blockNs[index];
+    };
+
+    double totalNs = 0.0;
+    for (auto ns : blockNs)
+        totalNs += ns;
+
+    double samples = static_cast<double> (blockNs.size()) * config.blockSize;
+    double nsPerSample = totalNs / samples;
+    double realtimeFactor = nsPerSample * config.sampleRate * 1.0e-9;
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty ("stage", stage);
+    result->setProperty ("sampleRate", config.sampleRate);
+    result->setProperty ("blockSize", config.blockSize);
+    result->setProperty ("channels", config.channels);
+    result->setProperty ("inputType", config.input->name);
+    result->setProperty ("blocks", static_cast<int> (blockNs.size()));
+    result->setProperty ("nsPerSample", nsPerSample);
+    result->setProperty ("realtimeFactor", realtimeFactor);
+    result->setProperty ("p50Us", percentile (0.5) * 1.0e-3);
+    result->setProperty ("p99Us", percentile (0.99) * 1.0e-3);
+    result->setProperty ("maxUs", blockNs.back() * 1.0e-3);
+
+    std::cerr << std::fixed << std::setprecision (1)
+              << std::left << std::setw (12) << stage << std::right
+              << config.sampleRate / 1000.0 << "k\t"
+              << config.blockSize << "\t"
+              << config.channels << "\t"
+              << std::left << std::setw (12) << config.input->name << std::right << "\t"
+              << std::setprecision (2) << nsPerSample << "\t\t"
+              << std::setprecision (4) << realtimeFactor << "\t"
+              << std::setprecision (1) << percentile (0.5) * 1.0e-3 << "\t"
+              << percentile (0.99) * 1.0e-3 << "\t"
+              << blockNs.back() * 1.0e-3 << std::defaultfloat << std::endl;
+
+    return result;
+}
+
+// Calls hopFunction (position) for every analysis hop boundary in a block,
+// the points where the engine runs the mapper and sets a retune target
+template <typename HopFunction>
+void forEachHop (int start, int numSamples, HopFunction&& hopFunction)
+{
+    for (int position = (start + hopSize - 1) / hopSize * hopSize; position < start + numSamples; position += hopSize)
+        hopFunction (position);
+}
+
+ScaleMapper::Settings makeScaleSettings()
+{
+    ScaleMapper::Settings settings;
+    settings.type = ScaleMapper::ScaleType::Major;
+    return settings;
+}
+
+juce::var benchmarkDetector (const Config& config, const VoiceSignal& signal)
+{
+    PitchDetector detector;
+    detector.setInputType (config.input->type);
+    detector.prepare (config.sampleRate, config.blockSize);
+
+    const float* input = signal.channels[0].data();
+    int firstMeasured = getWarmupBlocks (signal.numSamples, config.blockSize) * config.blockSize;
+    int voicedBlocks = 0;
+
+    // Counted over the measured blocks only, like "blocks"
+    auto blockNs = timeBlocks (signal.numSamples, config.blockSize, [&] (int start, int numSamples)
+    {
+        if (detector.process (input + start, numSamples).voiced && start >= firstMeasured)
+            ++voicedBlocks;
+    });
+
+    auto result = summarise ("detector", config, std::move (blockNs));
+    result.getDynamicObject()->setProperty ("voicedBlocks", voicedBlocks);
+    return result;
+}
+
+juce::var benchmarkScaleMapper (const Config& config, const VoiceSignal& signal)
+{
+    ScaleMapper mapper;
+    mapper.setSettings (makeScaleSettings());
+    double sink = 0.0;
+
+    auto blockNs = timeBlocks (signal.numSamples, config.blockSize, [&] (int start, int numSamples)
+    {
+        forEachHop (start, numSamples, [&] (int position)
+        {
+            sink += mapper.map (signal.f0[static_cast<size_t> (position)]).targetFrequency;
+        });
+    });
+
+    auto result = summarise ("scaleMapper", config, std::move (blockNs));
+    result.getDynamicObject()->setProperty ("checksum", sink);
+    return result;
+}
+
+juce::var benchmarkRetune (const Config& config, const VoiceSignal& signal)
+{
+    // Targets per hop, precomputed so only the retune engine is timed
+    ScaleMapper mapper;
+    mapper.setSettings (makeScaleSettings());
+    std::vector<float> targets (static_cast<size_t> (signal.numSamples / hopSize + 1));
+    for (size_t hop = 0; hop < targets.size(); ++hop)
+        targets[hop] = mapper.map (signal.f0[juce::jmin (hop * hopSize, signal.f0.size() - 1)]).targetFrequency;
+
+    RetuneEngine retune;
+    retune.prepare (config.sampleRate);
+    std::vector<float> ratios (static_cast<size_t> (config.blockSize));
+
+    // The engine's path: a target per hop, then the per-sample ratio curve
+    auto blockNs = timeBlocks (signal.numSamples, config.blockSize, [&] (int start, int numSamples)
+    {
+        forEachHop (start, numSamples, [&] (int position)
+        {
+            retune.setTarget (signal.f0[static_cast<size_t> (position)], targets[static_cast<size_t> (position / hopSize)]);
+        });
+
+        retune.renderRatios (ratios.data(), numSamples);
+    });
+
+    return summarise ("retune", config, std::move (blockNs));
+}
+
+juce::var benchmarkPsola (const Config& config, const VoiceSignal& signal)
+{
+    PitchDetector rangeSource;
+    rangeSource.setInputType (config.input->type);
+
+    PsolaShifter shifter;
+    shifter.prepare (config.sampleRate, config.blockSize, config.channels);
+    shifter.setFrequencyRange (rangeSource.getMinFrequency(), rangeSource.getMaxFrequency());
+
+    std::vector<float> ratios (static_cast<size_t> (config.blockSize), shiftRatio);
+    std::vector<std::vector<float>> outputs (static_cast<size_t> (config.channels),
+                                             std::vector<float> (static_cast<size_t> (config.blockSize)));
+    std::vector<const float*> inputPointers (static_cast<size_t> (config.channels));
+    std::vector<float*> outputPointers (static_cast<size_t> (config.channels));
+
+    for (int ch = 0; ch < config.channels; ++ch)
+        outputPointers[static_cast<size_t> (ch)] = outputs[static_cast<size_t> (ch)].data();
+
+    auto blockNs = timeBlocks (signal.numSamples, config.blockSize, [&] (int start, int numSamples)
+    {
+        for (int ch = 0; ch < config.channels; ++ch)
+            inputPointers[static_cast<size_t> (ch)] = signal.channels[static_cast<size_t> (ch)].data() + start;
+
+        float f0 = signal.f0[static_cast<size_t> (start)];
+        float period = f0 > 0.0f ? static_cast<float> (config.sampleRate / f0) : 0.0f;
+
+        shifter.process (inputPointers.data(), outputPointers.data(), config.channels, numSamples,
+                         ratios.data(), period, f0 > 0.0f ? 0.9f : 0.0f, inputPointers[0]);
+    });
+
+    return summarise ("psola", config, std::move (blockNs));
+}
+
+juce::var benchmarkEngine (const Config& config, const VoiceSignal& signal)
+{
+    PitchCorrectionEngine engine;
+    engine.prepare (config.sampleRate, config.blockSize, config.channels);
+
+    PitchCorrectionEngine::Parameters params;
+    params.inputType = config.input->type;
+    params.scale.type = PitchCorrectionEngine::Parameters::ScaleSettings::Type::Major;
+    engine.setParameters (params);
+
+    // Processed in place on a copy of the signal, one block-sized view at a time
+    juce::AudioBuffer<float> audio (config.channels, signal.numSamples);
+    for (int ch = 0; ch < config.channels; ++ch)
+        audio.copyFrom (ch, 0, signal.channels[static_cast<size_t> (ch)].data(), signal.numSamples);
+
+    auto blockNs = timeBlocks (signal.numSamples, config.blockSize, [&] (int start, int numSamples)
+    {
+        juce::AudioBuffer<float> block (audio.getArrayOfWritePointers(), config.channels, start, numSamples);
+        engine.process (block);
+    });
+
+    return summarise ("engine", config, std::move (blockNs));
+}
+
+Options parseOptions (int argc, char* argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String arg (argv[i]);
+
+        if (arg == "--quick")
+            options.quick = true;
+        else if (arg == "--seconds" && i + 1 < argc)
+            options.seconds = juce::jlimit (0.5, 600.0, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--out" && i + 1 < argc)
+            options.outputPath = argv[++i];
+        else
+            std::cerr << "Ignoring unknown argument: " << arg << std::endl;
+    }
+
+    return options;
+}
+
+juce::var makeEnvironment (const Options& options)
+{
+    auto* environment = new juce::DynamicObject();
+    environment->setProperty ("schemaVersion", schemaVersion);
+    environment->setProperty ("timestamp", juce::Time::getCurrentTime().toISO8601 (true));
+    environment->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    environment->setProperty ("cores", juce::SystemStats::getNumCpus());
+    environment->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+    environment->setProperty ("juce", juce::SystemStats::getJUCEVersion());
+    environment->setProperty ("periodKernel", PeriodKernels::getActiveKernelName());
+   #if JUCE_DEBUG
+    environment->setProperty ("build", "Debug");
+   #else
+    environment->setProperty ("build", "Release");
+   #endif
+   #if defined (__VERSION__)
+    environment->setProperty ("compiler", __VERSION__);
+   #elif defined (_MSC_FULL_VER)
+    environment->setProperty ("compiler", "MSVC " + juce::String (_MSC_FULL_VER));
+   #endif
+    environment->setProperty ("secondsPerRun", options.seconds);
+    environment->setProperty ("analysisHopSize", hopSize);
+    return environment;
+}
+}
+
+int main (int argc, char* argv[])
+{
+    auto options = parseOptions (argc, argv);
+
+    std::vector<double> sampleRates { 44100.0, 48000.0, 96000.0 };
+    std::vector<int> blockSizes { 64, 256, 1024 };
+    std::vector<int> channelCounts { 1, 2 };
+    std::vector<const InputTypeInfo*> inputs;
+    for (const auto& info : inputTypes)
+        inputs.push_back (&info);
+
+    if (options.quick)
+    {
+        sampleRates = { 44100.0 };
+        blockSizes = { 256 };
+        channelCounts = { 1 };
+        inputs = { &inputTypes[1] };
+    }
+
+    std::cerr << "=== ProTune Benchmark ===" << std::endl;
+    std::cerr << "\nStage\t    Rate\tBlock\tCh\tInput\t\tns/sample\tRTF\tp50 us\tp99 us\tmax us" << std::endl;
+    std::cerr << "-----\t    ----\t-----\t--\t-----\t\t---------\t---\t------\t------\t------" << std::endl;
+
+    juce::Array<juce::var> results;
+
+    for (auto sampleRate : sampleRates)
+    {
+        for (const auto* input : inputs)
+        {
+            auto signal = makeVoice (sampleRate, input->testFrequency, options.seconds);
+
+            for (auto blockSize : blockSizes)
+            {
+                Config config { sampleRate, blockSize, 1, input };
+
+                // The analysis stages work on the mono signal
+                results.add (benchmarkDetector (config, signal));
+                results.add (benchmarkScaleMapper (config, signal));
+                results.add (benchmarkRetune (config, signal));
+
+                for (auto channels : channelCounts)
+                {
+                    config.channels = channels;
+                    results.add (benchmarkPsola (config, signal));
+                    results.add (benchmarkEngine (config, signal));
+                }
+            }
+        }
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty ("benchmark", "ProTuneBench");
+    report->setProperty ("environment", makeEnvironment (options));
+    report->setProperty ("results", results);
+
+    auto json = juce::JSON::toString (juce::var (report));
+
+    if (options.outputPath.isNotEmpty())
+    {
+        juce::File outputFile (juce::File::getCurrentWorkingDirectory().getChildFile (options.outputPath));
+        if (! outputFile.replaceWithText (json))
+        {
+            std::cerr << "Failed to write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        std::cerr << "\nWrote " << outputFile.getFullPathName() << std::endl;
+    }
+    else
+    {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}